@@ -0,0 +1,52 @@
+#include "AdvertisePolicy.h"
+#include <esp_sleep.h>
+
+// Last advertisement, kept across deep sleep so the schedule spans wakes
+static RTC_DATA_ATTR uint32_t s_lastAdvertiseSec = 0;
+
+AdvertisePolicy& AdvertisePolicy::instance() { static AdvertisePolicy inst; return inst; }
+
+BleStartReason AdvertisePolicy::atBoot(uint8_t wakeCause) const {
+    if (!BLE_ON_DEMAND) return BLE_START_ALWAYS;
+    if (wakeCause == ESP_SLEEP_WAKEUP_UNDEFINED) return BLE_START_POWER_ON;
+    return BLE_START_NONE;
+}
+
+BleStartReason AdvertisePolicy::poll(const Inputs& in) {
+    if (in.buttonHigh) {
+        if (pressStartMs == 0) pressStartMs = in.nowMs ? in.nowMs : 1;
+        if (!pressHandled && in.nowMs - pressStartMs >= BLE_LONG_PRESS_MS) {
+            pressHandled = true;
+            return BLE_START_LONG_PRESS;
+        }
+    } else {
+        pressStartMs = 0;
+        pressHandled = false;
+    }
+    if (in.epochSec < EPOCH_VALID_AFTER_SEC) return BLE_START_NO_TIME;
+    if (BLE_UNSYNCED_PUFFS > 0 && in.unsyncedPuffs >= BLE_UNSYNCED_PUFFS) return BLE_START_UNSYNCED;
+    if (BLE_ADVERTISE_INTERVAL_SEC > 0 && in.epochSec - s_lastAdvertiseSec >= BLE_ADVERTISE_INTERVAL_SEC) return BLE_START_SCHEDULED;
+    return BLE_START_NONE;
+}
+
+void AdvertisePolicy::onAdvertise(uint32_t epochSec) {
+    s_lastAdvertiseSec = epochSec;
+}
+
+void AdvertisePolicy::reset() {
+    pressStartMs = 0;
+    pressHandled = false;
+    s_lastAdvertiseSec = 0;
+}
+
+const char* AdvertisePolicy::reasonName(BleStartReason reason) {
+    switch (reason) {
+        case BLE_START_ALWAYS:     return "always";
+        case BLE_START_POWER_ON:   return "power-on";
+        case BLE_START_NO_TIME:    return "no time";
+        case BLE_START_LONG_PRESS: return "long press";
+        case BLE_START_UNSYNCED:   return "unsynced puffs";
+        case BLE_START_SCHEDULED:  return "schedule";
+        default:                   return "none";
+    }
+}
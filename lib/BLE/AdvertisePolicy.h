@@ -0,0 +1,119 @@
+#pragma once
+
+/**
+ * @file AdvertisePolicy.h
+ * @brief Decides when a button wake brings up BLE, so a wake that only puffs keeps the radio off.
+ *
+ * BLE starts on the first boot after a reset, while the device has no time, on a long button
+ * press, once enough puffs are waiting for the client, or when the last advertisement is older
+ * than the schedule interval. BLE_ON_DEMAND=0 restores the start-on-every-wake behaviour.
+ *
+ * @author Vetra Firmware Team
+ * @copyright Copyright (c) 2025 Vetra
+ */
+
+// --- Standard Library Includes ---
+#include <Arduino.h>
+#include <cstdint>
+
+// -----------------------------------------------------------------------------
+// Advertise Policy Constants
+// -----------------------------------------------------------------------------
+
+/// @name Advertise Policy
+///@{
+// 1 = start BLE only when the policy asks for it; 0 = on every button wake
+#ifndef BLE_ON_DEMAND
+#define BLE_ON_DEMAND                     1
+#endif
+// Button hold that requests BLE
+#ifndef BLE_LONG_PRESS_MS
+#define BLE_LONG_PRESS_MS                 1500
+#endif
+// Unacknowledged puffs that request BLE (0 = never)
+#ifndef BLE_UNSYNCED_PUFFS
+#define BLE_UNSYNCED_PUFFS                32
+#endif
+// Seconds after the last advertisement before a wake advertises again (0 = never)
+#ifndef BLE_ADVERTISE_INTERVAL_SEC
+#define BLE_ADVERTISE_INTERVAL_SEC        21600
+#endif
+///@}
+
+/// @brief Epochs before this (2024-01-01) mean the clock was never set
+static constexpr uint32_t EPOCH_VALID_AFTER_SEC = 1704067200;
+
+/**
+ * @enum BleStartReason
+ * @brief Why BLE was started this wake (stored with the boot profile).
+ */
+enum BleStartReason : uint8_t {
+    BLE_START_NONE,        ///< BLE stays off
+    BLE_START_ALWAYS,      ///< On-demand policy disabled
+    BLE_START_POWER_ON,    ///< First boot after a reset
+    BLE_START_NO_TIME,     ///< Clock never set; the client has to set the time
+    BLE_START_LONG_PRESS,  ///< Button held for BLE_LONG_PRESS_MS
+    BLE_START_UNSYNCED,    ///< BLE_UNSYNCED_PUFFS or more puffs not acknowledged
+    BLE_START_SCHEDULED,   ///< BLE_ADVERTISE_INTERVAL_SEC since the last advertisement
+};
+
+// -----------------------------------------------------------------------------
+// AdvertisePolicy Class
+// -----------------------------------------------------------------------------
+
+/**
+ * @class AdvertisePolicy
+ * @brief Singleton evaluated at boot and on each loop iteration while BLE is off.
+ */
+class AdvertisePolicy {
+public:
+    /**
+     * @brief Inputs sampled by the application loop.
+     */
+    struct Inputs {
+        bool buttonHigh;         ///< BUTTON_PIN level
+        uint32_t nowMs;          ///< millis()
+        uint32_t unsyncedPuffs;  ///< Stored puffs the client has not acknowledged
+        uint32_t epochSec;       ///< Current epoch seconds
+    };
+
+    /**
+     * @brief Get singleton instance of AdvertisePolicy.
+     */
+    static AdvertisePolicy& instance();
+
+    /**
+     * @brief Decision available before persistence is loaded (lets BLE init overlap the restore).
+     * @param wakeCause esp_sleep_wakeup_cause_t of this boot.
+     */
+    BleStartReason atBoot(uint8_t wakeCause) const;
+
+    /**
+     * @brief Decision once state is restored; call every loop iteration while BLE is off.
+     * @return First reason that applies, or BLE_START_NONE; a long press is reported once per press.
+     */
+    BleStartReason poll(const Inputs& in);
+
+    /**
+     * @brief Record that BLE started advertising (restarts the schedule interval).
+     */
+    void onAdvertise(uint32_t epochSec);
+
+    /**
+     * @brief Forget the press in progress and the schedule (tests, power-on).
+     */
+    void reset();
+
+    /**
+     * @brief Short name of a reason for logs.
+     */
+    static const char* reasonName(BleStartReason reason);
+
+private:
+    AdvertisePolicy() = default;
+    AdvertisePolicy(const AdvertisePolicy&) = delete;
+    AdvertisePolicy& operator=(const AdvertisePolicy&) = delete;
+
+    uint32_t pressStartMs = 0;
+    bool pressHandled = false;
+};
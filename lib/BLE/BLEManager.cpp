@@ -1,19 +1,14 @@
 
-#include <memory>
-#include <utility>
-#if __cplusplus <= 201103L
-namespace std {
-    template <typename T, typename... Args>
-    std::unique_ptr<T> make_unique(Args&&... args) {
-        return std::unique_ptr<T>(new T(std::forward<Args>(args)...));
-    }
-}
-#endif
 #include "BLEManager.h"
 #include "Timer.h"
 #include "LogBuffer.h"
-#include <BLE2902.h>
+#include "BootProfiler.h"
+#include "Metrics.h"
+#include "PersistenceManager.h"
+#include "AllocTracker.h"
+#include "ClockDrift.h"
 #include <cstring>
+#include <new>
 #include <algorithm>
 
 // -----------------------------------------------------------------------------
@@ -22,19 +17,57 @@ namespace std {
 
 BLEManager& BLEManager::instance() { static BLEManager inst; return inst; }
 
-BLEManager::BLEManager() : pServer(nullptr), ntpChar(nullptr), puffsChar(nullptr), phasesChar(nullptr), loggerChar(nullptr), keepAliveChar(nullptr), bleEnabled(false) {}
+static constexpr EventBits_t STATE_READY_BIT = 0x01;
+static constexpr uint16_t BLE_NULL_HANDLE = 0xFFFF; // Attribute handle of a descriptor not yet registered
+
+// Radio-on totals across deep sleep (reset on power-on)
+struct RadioTotals {
+    uint32_t wakes;
+    uint32_t radioWakes;
+    uint32_t radioOnMs;
+};
+static RTC_DATA_ATTR RadioTotals s_radio;
+
+BLEManager::BLEManager() : pServer(nullptr), ntpChar(nullptr), puffsChar(nullptr), phasesChar(nullptr), loggerChar(nullptr), keepAliveChar(nullptr), metricsChar(nullptr), countersChar(nullptr), diagChar(nullptr), rollupsChar(nullptr), bleEnabled(false) {
+    stateReadyGroup = xEventGroupCreate();
+}
 BLEManager::~BLEManager() { cleanupService(); }
 
 // -----------------------------------------------------------------------------
 // BLE Service Lifecycle
 // -----------------------------------------------------------------------------
 
+BLE2902* BLEManager::CccdSlot::acquire(BLEDescriptorCallbacks* callbacks) {
+    // A registered descriptor refuses a second registration, so rebuild it after a stack restart
+    if (cccd && cccd->getHandle() != BLE_NULL_HANDLE) {
+        cccd->~BLE2902();
+        cccd = nullptr;
+    }
+    if (!cccd) cccd = new (storage) BLE2902();
+    cccd->setNotifications(false);
+    cccd->setIndications(false);
+    cccd->setCallbacks(callbacks);
+    return cccd;
+}
+
 void BLEManager::startService() {
     bleEnabled = true;
+    if (serviceStarted) {
+        // Service table already registered; only advertising needs to resume
+        BLEDevice::startAdvertising();
+        updateInteraction();
+        Logger::info("[BLEManager] BLE service already running; advertising resumed.");
+        return;
+    }
+    BootProfiler& prof = BootProfiler::instance();
+    radioOn = true;
+    radioOnStartUs = micros();
+    prof.stageBegin(BOOT_BLE_INIT);
     BLEDevice::init("Vetra");
+    prof.stageEnd(BOOT_BLE_INIT);
+    prof.stageBegin(BOOT_SERVICE_CREATE);
     pServer = BLEDevice::createServer();
-    serverCallbacks = std::make_unique<MyServerCallbacks>();
-    pServer->setCallbacks(serverCallbacks.get());
+    pServer->setCallbacks(&arena.server);
     BLEService* service = pServer->createService(SERVICE_UUID);
 
     // --- Characteristic Setup ---
@@ -43,86 +76,162 @@ void BLEManager::startService() {
         NTP_CHAR_UUID,
         BLECharacteristic::PROPERTY_WRITE
     );
-    ntpCallbacks = std::make_unique<NTPCallbacks>();
-    ntpChar->setCallbacks(ntpCallbacks.get());
+    ntpChar->setCallbacks(&arena.ntp);
 
     // Puffs characteristic: Write With Response + Notify + Indicate
     puffsChar = service->createCharacteristic(
         PUFFS_CHAR_UUID,
         BLECharacteristic::PROPERTY_WRITE | BLECharacteristic::PROPERTY_NOTIFY | BLECharacteristic::PROPERTY_INDICATE
     );
-    puffsCallbacks = std::make_unique<PuffsCallbacks>();
-    puffsChar->setCallbacks(puffsCallbacks.get());
-    auto puffsCccd = std::make_unique<BLE2902>();
-    puffsCccdCallbacks = std::make_unique<PuffsCccdCallbacks>();
-    puffsCccd->setCallbacks(puffsCccdCallbacks.get());
-    puffsChar->addDescriptor(puffsCccd.release());
+    puffsChar->setCallbacks(&arena.puffs);
+    puffsChar->addDescriptor(arena.puffsCccd.acquire(&arena.puffsCccdCallbacks));
 
     // Phases characteristic: Write With Response + Notify + Indicate
     phasesChar = service->createCharacteristic(
         PHASES_CHAR_UUID,
         BLECharacteristic::PROPERTY_WRITE | BLECharacteristic::PROPERTY_NOTIFY | BLECharacteristic::PROPERTY_INDICATE
     );
-    phasesCallbacks = std::make_unique<PhasesCallbacks>();
-    phasesChar->setCallbacks(phasesCallbacks.get());
-    auto phasesCccd = std::make_unique<BLE2902>();
-    phasesCccdCallbacks = std::make_unique<PhasesCccdCallbacks>();
-    phasesCccd->setCallbacks(phasesCccdCallbacks.get());
-    phasesChar->addDescriptor(phasesCccd.release());
+    phasesChar->setCallbacks(&arena.phases);
+    phasesChar->addDescriptor(arena.phasesCccd.acquire(&arena.phasesCccdCallbacks));
 
     // Logger characteristic: notify/indicate only (no READ)
     loggerChar = service->createCharacteristic(
         LOGGER_CHAR_UUID,
         BLECharacteristic::PROPERTY_NOTIFY | BLECharacteristic::PROPERTY_INDICATE
     );
-    auto loggerCccd = std::make_unique<BLE2902>();
-    loggerCccdCallbacks = std::make_unique<LoggerCccdCallbacks>();
-    loggerCccd->setCallbacks(loggerCccdCallbacks.get());
-    loggerChar->addDescriptor(loggerCccd.release());
+    loggerChar->addDescriptor(arena.loggerCccd.acquire(&arena.loggerCccdCallbacks));
 
     // KeepAlive characteristic: Read
     keepAliveChar = service->createCharacteristic(
         KEEPALIVE_CHAR_UUID,
         BLECharacteristic::PROPERTY_READ
     );
-    keepAliveCallbacks = std::make_unique<KeepAliveCallbacks>();
-    keepAliveChar->setCallbacks(keepAliveCallbacks.get());
+    keepAliveChar->setCallbacks(&arena.keepAlive);
+
+    // Metrics characteristic: Read (histogram snapshot) + Write (0x01 = reset)
+    metricsChar = service->createCharacteristic(
+        METRICS_CHAR_UUID,
+        BLECharacteristic::PROPERTY_READ | BLECharacteristic::PROPERTY_WRITE
+    );
+    metricsChar->setCallbacks(&arena.metrics);
+
+    // Counters characteristic: Read
+    countersChar = service->createCharacteristic(
+        COUNTERS_CHAR_UUID,
+        BLECharacteristic::PROPERTY_READ
+    );
+    countersChar->setCallbacks(&arena.counters);
+
+    // Diagnostics characteristic: Read (boot profiles)
+    diagChar = service->createCharacteristic(
+        DIAG_CHAR_UUID,
+        BLECharacteristic::PROPERTY_READ
+    );
+    diagChar->setCallbacks(&arena.diag);
+
+    // Rollups characteristic: Write (query) + Read (rollup frame)
+    rollupsChar = service->createCharacteristic(
+        ROLLUPS_CHAR_UUID,
+        BLECharacteristic::PROPERTY_READ | BLECharacteristic::PROPERTY_WRITE
+    );
+    arena.rollups.reset();
+    rollupsChar->setCallbacks(&arena.rollups);
 
     service->start();
+    serviceStarted = true;
+    prof.stageEnd(BOOT_SERVICE_CREATE);
+    prof.stageBegin(BOOT_FIRST_ADVERTISE);
     BLEAdvertising* pAdvertising = BLEDevice::getAdvertising();
     pAdvertising->addServiceUUID(SERVICE_UUID);
     pAdvertising->setScanResponse(false);
     pAdvertising->setMinPreferred(0x06);
     pAdvertising->setMinPreferred(0x12);
     BLEDevice::startAdvertising();
+    prof.stageEnd(BOOT_FIRST_ADVERTISE);
+    advertiseUs = micros();
+    updateInteraction();
+    Logger::infof("[BLEManager] BLE service started and advertising (iOS spec). Time-to-advertise: %u us", (unsigned)advertiseUs);
+}
+
+void BLEManager::startServiceTask(void* arg) {
+    static_cast<BLEManager*>(arg)->startService();
+    vTaskDelete(nullptr);
+}
+
+void BLEManager::startServiceAsync() {
+    // Mark enabled up front so the loop does not treat BLE as idle while the task runs
+    bleEnabled = true;
     updateInteraction();
-    Logger::info("[BLEManager] BLE service started and advertising (iOS spec).");
+    if (xTaskCreate(startServiceTask, "ble_start", BLE_START_TASK_STACK, this, BLE_START_TASK_PRIO, nullptr) != pdPASS) {
+        Logger::error("[BLEManager] BLE start task creation failed; starting inline.");
+        startService();
+    }
+}
+
+void BLEManager::markStateReady() {
+    if (stateReadyGroup) xEventGroupSetBits(stateReadyGroup, STATE_READY_BIT);
+}
+
+bool BLEManager::waitStateReady(uint32_t timeoutMs) {
+    if (!stateReadyGroup) return true;
+    EventBits_t bits = xEventGroupWaitBits(stateReadyGroup, STATE_READY_BIT, pdFALSE, pdTRUE, pdMS_TO_TICKS(timeoutMs));
+    if (!(bits & STATE_READY_BIT)) {
+        Logger::warning("[BLEManager] State not ready; request dropped.");
+        return false;
+    }
+    return true;
 }
 
 void BLEManager::cleanupService() {
     BLEAdvertising* pAdvertising = BLEDevice::getAdvertising();
     if (pAdvertising) pAdvertising->stop();
     BLEDevice::deinit();
+    if (radioOn) {
+        uint32_t onUs = micros() - radioOnStartUs;
+        radioOnUs += onUs;
+        BootProfiler::instance().accumulate(BOOT_RADIO_ON, radioOnStartUs, onUs);
+        radioOn = false;
+    }
     pServer = nullptr;
     ntpChar = nullptr;
     keepAliveChar = nullptr;
+    metricsChar = nullptr;
+    countersChar = nullptr;
+    diagChar = nullptr;
+    rollupsChar = nullptr;
     loggerChar = nullptr;
+    clientConnected = false;
     loggerSubscribed = false;
     loggerNotifyEnabled = false;
     loggerIndicateEnabled = false;
     puffsChar = nullptr;
     phasesChar = nullptr;
     bleEnabled = false;
-    // Smart pointers handle cleanup automatically
+    serviceStarted = false;
+    // Callbacks and descriptors stay in the arena for the next start
     Logger::info("[BLEManager] BLE service cleaned up.");
 }
 
+uint32_t BLEManager::radioOnMs() const {
+    uint32_t us = radioOnUs + (radioOn ? micros() - radioOnStartUs : 0);
+    return us / 1000;
+}
+
+void BLEManager::logRadioReport() {
+    uint32_t ms = radioOnMs();
+    s_radio.wakes++;
+    if (ms > 0) s_radio.radioWakes++;
+    s_radio.radioOnMs += ms;
+    Logger::infof("[BLEManager] Radio on %u ms this wake; %u ms over %u of %u wakes since power-on",
+                  (unsigned)ms, (unsigned)s_radio.radioOnMs, (unsigned)s_radio.radioWakes, (unsigned)s_radio.wakes);
+}
+
 // -----------------------------------------------------------------------------
 // BLE Connection/Timeout/Interaction
 // -----------------------------------------------------------------------------
 
-bool BLEManager::connectionTimeOut() const {
-    return (millis() - lastInteractionTime > BLE_TIMEOUT);
+bool BLEManager::hasPendingNotifications() const {
+    return loggerChar && loggerSubscribed && LogBuffer::instance().size() > 0;
 }
 
 void BLEManager::updateInteraction() {
@@ -136,11 +245,18 @@ void BLEManager::updateInteraction() {
 // --- Server Callbacks ---
 BLEManager::MyServerCallbacks::MyServerCallbacks() {}
 void BLEManager::MyServerCallbacks::onConnect(BLEServer* pServer) {
+    AllocTracker::Scope alloc(ALLOC_BLE);
+    BLEManager::instance().puffsWireV2 = false;
+    BLEManager::instance().phasesWireV2 = false;
+    BLEManager::instance().clientConnected = true;
     BLEManager::instance().updateInteraction();
     Logger::info("[BLEManager] BLE client connected.");
 }
 void BLEManager::MyServerCallbacks::onDisconnect(BLEServer* pServer) {
+    AllocTracker::Scope alloc(ALLOC_BLE);
     BLEManager::instance().setSubscriptionStatus(false);
+    BLEManager::instance().clientConnected = false;
+    BLEManager::instance().updateInteraction();
     BLEDevice::startAdvertising();
     Logger::info("[BLEManager] BLE client disconnected, advertising restarted.");
 }
@@ -148,14 +264,17 @@ void BLEManager::MyServerCallbacks::onDisconnect(BLEServer* pServer) {
 // --- NTP Characteristic Callbacks ---
 BLEManager::NTPCallbacks::NTPCallbacks() {}
 void BLEManager::NTPCallbacks::onWrite(BLECharacteristic* pCharacteristic) {
+    AllocTracker::Scope alloc(ALLOC_BLE);
     BLEManager::instance().updateInteraction();
-    std::string value = pCharacteristic->getValue();
-    if (value.size() != 4) {
-        Logger::warningf("[BLEManager] NTP write invalid length: %u", (unsigned)value.size());
+    if (!BLEManager::instance().waitStateReady()) return;
+    // Read the value in place (getValue() would copy it into a heap string)
+    const uint8_t* b = pCharacteristic->getData();
+    size_t len = pCharacteristic->getLength();
+    if (len != 4) {
+        Logger::warningf("[BLEManager] NTP write invalid length: %u", (unsigned)len);
         return;
     }
     // Interpret as little-endian epoch seconds
-    const uint8_t* b = reinterpret_cast<const uint8_t*>(value.data());
     uint32_t epoch = (uint32_t)b[0] | ((uint32_t)b[1] << 8) | ((uint32_t)b[2] << 16) | ((uint32_t)b[3] << 24);
     char ts[32];
     if (epochToTimestamp(epoch, ts, sizeof(ts))) {
@@ -163,6 +282,8 @@ void BLEManager::NTPCallbacks::onWrite(BLECharacteristic* pCharacteristic) {
     } else {
         Logger::infof("[BLEManager] NTP epoch received (LE): %u", epoch);
     }
+    // The error against the phone's time is the RTC drift since the previous sync
+    ClockDrift::instance().onSync(epochSeconds(), epoch);
     if (!updateSystemTime(epoch)) {
         Logger::error("[BLEManager] NTP update failed.");
     } else {
@@ -173,122 +294,199 @@ void BLEManager::NTPCallbacks::onWrite(BLECharacteristic* pCharacteristic) {
 // --- Puffs Characteristic Callbacks ---
 BLEManager::PuffsCallbacks::PuffsCallbacks() {}
 void BLEManager::PuffsCallbacks::onWrite(BLECharacteristic* pCharacteristic) {
+    AllocTracker::Scope alloc(ALLOC_BLE);
+    Metrics::Scope metric(METRIC_PUFFS_REQUEST);
     BLEManager::instance().updateInteraction();
-    std::string value = pCharacteristic->getValue();
-    if (value.size() != 4 || value[0] != 0x10) {
+    if (!BLEManager::instance().waitStateReady()) return;
+    const uint8_t* v = pCharacteristic->getData();
+    size_t len = pCharacteristic->getLength();
+    // 0x12: [puffNumber(4)] acknowledges that the client has stored every puff up to puffNumber
+    if (len == 5 && v[0] == 0x12) {
+        uint32_t acked = v[1] | (v[2] << 8) | (v[3] << 16) | ((uint32_t)v[4] << 24);
+        PersistenceManager::instance().acknowledgePuffs(acked);
+        return;
+    }
+    // v1: 0x10 [startAfter(2)][maxCount]; 0x11 [fromSec(4)][toSec(4)][startAfter(2)][maxCount]
+    // v2: 0x20 [startAfter(4)][maxCount]; 0x21 [fromSec(4)][toSec(4)][startAfter(4)][maxCount]
+    bool v2 = (len == 6 && v[0] == 0x20) || (len == 14 && v[0] == 0x21);
+    bool byTime = (len == 12 && v[0] == 0x11) || (len == 14 && v[0] == 0x21);
+    if (!v2 && !byTime && (len != 4 || v[0] != 0x10)) {
         Logger::info("[BLEManager] Invalid Puffs request format.");
         return;
     }
-    uint16_t startAfter = value[1] | (value[2] << 8);
-    uint8_t maxCount = value[3];
-    Logger::infof("[BLEManager] Puffs request: startAfter=%u, maxCount=%u", startAfter, maxCount);
+    BLEManager& mgr = BLEManager::instance();
+    mgr.puffsWireV2 = v2;
+    uint32_t fromSec = 0, toSec = 0;
+    if (byTime) {
+        fromSec = v[1] | (v[2] << 8) | (v[3] << 16) | ((uint32_t)v[4] << 24);
+        toSec = v[5] | (v[6] << 8) | (v[7] << 16) | ((uint32_t)v[8] << 24);
+    }
+    const uint8_t* tail = byTime ? &v[9] : &v[1];
+    uint32_t startAfter = tail[0] | (tail[1] << 8);
+    if (v2) startAfter |= (tail[2] << 16) | ((uint32_t)tail[3] << 24);
+    uint8_t maxCount = tail[v2 ? 4 : 2];
+    if (byTime) {
+        Logger::infof("[BLEManager] Puffs request: from=%u, to=%u, startAfter=%u, maxCount=%u", (unsigned)fromSec, (unsigned)toSec, (unsigned)startAfter, maxCount);
+    } else {
+        Logger::infof("[BLEManager] Puffs request: startAfter=%u, maxCount=%u", (unsigned)startAfter, maxCount);
+    }
     // Derive capacity from framing constants
-    const size_t CAPACITY = (BLEManager::PUFF_FRAME_MAX - BLEManager::PUFF_HEADER) / BLEManager::PUFF_ENTRY;
-    if (maxCount == 0 || maxCount > CAPACITY) maxCount = (uint8_t)CAPACITY; // 0 => full capacity
+    constexpr size_t CAPACITY = (BLEManager::PUFF_FRAME_MAX - BLEManager::PUFF_HEADER) / BLEManager::PUFF_ENTRY;
+    constexpr size_t CAPACITY_V2 = (BLEManager::PUFF_FRAME_MAX - BLEManager::PUFF_HEADER_V2) / BLEManager::PUFF_ENTRY_V2;
+    size_t capacity = v2 ? CAPACITY_V2 : CAPACITY;
+    if (maxCount == 0 || maxCount > capacity) maxCount = (uint8_t)capacity; // 0 => full capacity
 
     StateMachine& puff_counter_sm = StateMachine::instance();
-    std::vector<PuffModel> puffs = puff_counter_sm.getPuffs(startAfter, maxCount);
-    if (puffs.empty()) { BLEManager::sendDone(pCharacteristic, "Puffs"); return; }
-    uint16_t firstPuffNumber = puffs[0].puffNumber;
-    uint8_t payload[BLEManager::PUFF_FRAME_MAX - BLEManager::PUFF_HEADER] = {0};
-    size_t payloadIdx = 0; uint8_t encoded = 0;
-    for (auto &pf : puffs) {
-        if (encoded >= maxCount) break;
-        if (payloadIdx + BLEManager::PUFF_ENTRY > sizeof(payload)) break; // (redundant) guard
-        BLEManager::writeLE(&payload[payloadIdx], pf.puffNumber);
-        BLEManager::writeLE32(&payload[payloadIdx + 2], (uint32_t)pf.timestampSec);
-        // Puff duration is milliseconds; frame stores it as uint16 (will truncate above 65535ms)
-        BLEManager::writeLE(&payload[payloadIdx + 6], (uint16_t)pf.puffDuration);
-        payload[payloadIdx + 8] = (uint8_t)pf.phaseIndex;
-        payloadIdx += BLEManager::PUFF_ENTRY;
-        encoded++;
-    }
-    uint8_t frame[BLEManager::PUFF_FRAME_MAX] = {0};
-    frame[0] = 0x01;
-    BLEManager::writeLE(&frame[1], firstPuffNumber);
-    frame[3] = encoded;
-    memcpy(&frame[BLEManager::PUFF_HEADER], payload, payloadIdx);
-    size_t frameLen = BLEManager::PUFF_HEADER + payloadIdx;
+    PuffModel puffs[CAPACITY];
+    size_t count = byTime ? puff_counter_sm.getPuffsInRange(fromSec, toSec, startAfter, puffs, maxCount)
+                          : puff_counter_sm.getPuffs(startAfter, puffs, maxCount);
+    if (count == 0) { BLEManager::sendDone(pCharacteristic, "Puffs", CNT_PUFFS_NOTIFY); return; }
+    uint8_t frame[BLEManager::PUFF_FRAME_MAX];
+    size_t frameLen = BLEManager::encodePuffFrame(puffs, count, v2, frame, sizeof(frame));
     pCharacteristic->setValue(frame, frameLen);
-    if (BLEManager::instance().usePuffsIndicate()) pCharacteristic->indicate(); else pCharacteristic->notify();
-    BLEManager::instance().updateInteraction();
-    Logger::infof("[BLEManager] Sent Puffs batch: requested=%u encoded=%u", (unsigned)puffs.size(), encoded);
+    BLEManager::pushValue(pCharacteristic, mgr.usePuffsIndicate(), CNT_PUFFS_NOTIFY);
+    mgr.updateInteraction();
+    Logger::infof("[BLEManager] Sent Puffs batch: requested=%u encoded=%u", (unsigned)count, (unsigned)frame[v2 ? 5 : 3]);
 }
 
 // --- Phases Characteristic Callbacks ---
 BLEManager::PhasesCallbacks::PhasesCallbacks() {}
 void BLEManager::PhasesCallbacks::onWrite(BLECharacteristic* pCharacteristic) {
+    AllocTracker::Scope alloc(ALLOC_BLE);
+    Metrics::Scope metric(METRIC_PHASES_REQUEST);
     BLEManager::instance().updateInteraction();
-    std::string value = pCharacteristic->getValue();
-    if (value.size() != 4 || value[0] != 0x10) {
+    if (!BLEManager::instance().waitStateReady()) return;
+    const uint8_t* value = pCharacteristic->getData();
+    // v1: 0x10 [startAfter(2)][maxCount]; v2: 0x20, same request, 16-bit phase indices in the reply
+    if (pCharacteristic->getLength() != 4 || (value[0] != 0x10 && value[0] != 0x20)) {
         Logger::info("[BLEManager] Invalid Phases request format.");
         return;
     }
+    BLEManager& mgr = BLEManager::instance();
+    bool v2 = value[0] == 0x20;
+    mgr.phasesWireV2 = v2;
     uint16_t startAfter = value[1] | (value[2] << 8);
     uint8_t maxCount = value[3];
     Logger::infof("[BLEManager] Phases request: startAfter=%u, maxCount=%u", startAfter, maxCount);
-    const size_t CAPACITY = (BLEManager::PHASE_FRAME_MAX - BLEManager::PHASE_HEADER) / BLEManager::PHASE_ENTRY;
-    if (maxCount == 0 || maxCount > CAPACITY) maxCount = (uint8_t)CAPACITY; // 0 => full capacity
+    constexpr size_t CAPACITY = (BLEManager::PHASE_FRAME_MAX - BLEManager::PHASE_HEADER) / BLEManager::PHASE_ENTRY;
+    constexpr size_t CAPACITY_V2 = (BLEManager::PHASE_FRAME_MAX - BLEManager::PHASE_HEADER) / BLEManager::PHASE_ENTRY_V2;
+    size_t capacity = v2 ? CAPACITY_V2 : CAPACITY;
+    if (maxCount == 0 || maxCount > capacity) maxCount = (uint8_t)capacity; // 0 => full capacity
 
     // Fetch bounded set of phases
     StateMachine& puff_counter_sm = StateMachine::instance();
-    std::vector<PhaseModel> phases = puff_counter_sm.getPhases(startAfter, maxCount);
-    if (phases.empty()) { BLEManager::sendDone(pCharacteristic, "Phases"); return; }
-    uint16_t firstPhaseIndex = phases[0].phaseIndex;
-    uint8_t payload[BLEManager::PHASE_FRAME_MAX - BLEManager::PHASE_HEADER] = {0};
-    size_t payloadIdx = 0;
-    uint8_t encoded = 0;
-    for (auto &ph : phases) {
-        if (encoded >= maxCount) break;
-        if (payloadIdx + BLEManager::PHASE_ENTRY > sizeof(payload)) break; // (redundant) guard
-        payload[payloadIdx] = (uint8_t)ph.phaseIndex;
-        BLEManager::writeLE32(&payload[payloadIdx + 1], (uint32_t)ph.phaseStartSec);
-        payloadIdx += BLEManager::PHASE_ENTRY;
-        encoded++;
-    }
-    uint8_t frame[BLEManager::PHASE_FRAME_MAX] = {0};
-    frame[0] = 0x01;
-    BLEManager::writeLE(&frame[1], firstPhaseIndex);
-    frame[3] = encoded;
-    memcpy(&frame[4], payload, payloadIdx);
-    size_t frameLen = BLEManager::PHASE_HEADER + payloadIdx;
+    PhaseModel phases[CAPACITY];
+    size_t count = puff_counter_sm.getPhases(startAfter, phases, maxCount);
+    if (count == 0) { BLEManager::sendDone(pCharacteristic, "Phases", CNT_PHASES_NOTIFY); return; }
+    uint8_t frame[BLEManager::PHASE_FRAME_MAX];
+    size_t frameLen = BLEManager::encodePhaseFrame(phases, count, v2, frame, sizeof(frame));
     pCharacteristic->setValue(frame, frameLen);
-    if (BLEManager::instance().usePhasesIndicate()) pCharacteristic->indicate(); else pCharacteristic->notify();
-    Logger::infof("[BLEManager] Sent Phases batch: requested=%u encoded=%u", (unsigned)phases.size(), encoded);
+    BLEManager::pushValue(pCharacteristic, mgr.usePhasesIndicate(), CNT_PHASES_NOTIFY);
+    Logger::infof("[BLEManager] Sent Phases batch: requested=%u encoded=%u", (unsigned)count, (unsigned)frame[3]);
 }
 
 // --- KeepAlive Characteristic Callbacks ---
 BLEManager::KeepAliveCallbacks::KeepAliveCallbacks() {}
 void BLEManager::KeepAliveCallbacks::onRead(BLECharacteristic* pCharacteristic) {
+    AllocTracker::Scope alloc(ALLOC_BLE);
     BLEManager::instance().updateInteraction();
     Logger::info("[BLEManager] KeepAlive read request received.");
     uint8_t response[2] = {0x01, 0x00};
     pCharacteristic->setValue(response, sizeof(response));
 }
 
+// --- Metrics Characteristic Callbacks ---
+BLEManager::MetricsCallbacks::MetricsCallbacks() {}
+void BLEManager::MetricsCallbacks::onRead(BLECharacteristic* pCharacteristic) {
+    AllocTracker::Scope alloc(ALLOC_BLE);
+    BLEManager::instance().updateInteraction();
+    uint8_t buf[Metrics::serializedSize()];
+    size_t len = Metrics::instance().serialize(buf, sizeof(buf));
+    pCharacteristic->setValue(buf, len);
+    Logger::infof("[BLEManager] Metrics read: %u bytes.", (unsigned)len);
+}
+void BLEManager::MetricsCallbacks::onWrite(BLECharacteristic* pCharacteristic) {
+    AllocTracker::Scope alloc(ALLOC_BLE);
+    BLEManager::instance().updateInteraction();
+    const uint8_t* value = pCharacteristic->getData();
+    if (pCharacteristic->getLength() != 1 || value[0] != 0x01) {
+        Logger::info("[BLEManager] Invalid Metrics request format.");
+        return;
+    }
+    Metrics::instance().reset();
+    Logger::info("[BLEManager] Metrics reset.");
+}
+
+// --- Counters Characteristic Callbacks ---
+BLEManager::CountersCallbacks::CountersCallbacks() {}
+void BLEManager::CountersCallbacks::onRead(BLECharacteristic* pCharacteristic) {
+    AllocTracker::Scope alloc(ALLOC_BLE);
+    BLEManager::instance().updateInteraction();
+    uint8_t buf[Counters::serializedSize()];
+    size_t len = Counters::instance().serialize(buf, sizeof(buf));
+    pCharacteristic->setValue(buf, len);
+}
+
+// --- Rollups Characteristic Callbacks ---
+BLEManager::RollupsCallbacks::RollupsCallbacks() {}
+void BLEManager::RollupsCallbacks::onWrite(BLECharacteristic* pCharacteristic) {
+    AllocTracker::Scope alloc(ALLOC_BLE);
+    BLEManager::instance().updateInteraction();
+    const uint8_t* value = pCharacteristic->getData();
+    // [0x10][kind][fromKey(4)][maxCount]
+    if (pCharacteristic->getLength() != 7 || value[0] != 0x10 || value[1] >= ROLLUP_KIND_COUNT) {
+        Logger::info("[BLEManager] Invalid Rollups request format.");
+        return;
+    }
+    kind = value[1];
+    fromKey = (uint32_t)value[2] | ((uint32_t)value[3] << 8) | ((uint32_t)value[4] << 16) | ((uint32_t)value[5] << 24);
+    maxCount = value[6];
+    Logger::infof("[BLEManager] Rollups request: kind=%u, fromKey=%u, maxCount=%u", kind, (unsigned)fromKey, maxCount);
+}
+void BLEManager::RollupsCallbacks::onRead(BLECharacteristic* pCharacteristic) {
+    AllocTracker::Scope alloc(ALLOC_BLE);
+    BLEManager::instance().updateInteraction();
+    if (!BLEManager::instance().waitStateReady()) return;
+    constexpr size_t CAPACITY = (BLEManager::ROLLUP_FRAME_MAX - ROLLUP_HEADER) / ROLLUP_ENTRY;
+    size_t count = (maxCount == 0 || maxCount > CAPACITY) ? CAPACITY : maxCount; // 0 => full capacity
+    uint8_t frame[ROLLUP_HEADER + CAPACITY * ROLLUP_ENTRY];
+    size_t len = Rollups::instance().serialize((RollupKind)kind, fromKey, count, frame, sizeof(frame));
+    pCharacteristic->setValue(frame, len);
+    Logger::infof("[BLEManager] Rollups read: %u entries.", (unsigned)frame[1]);
+}
+
+// --- Diagnostics Characteristic Callbacks ---
+BLEManager::DiagCallbacks::DiagCallbacks() {}
+void BLEManager::DiagCallbacks::onRead(BLECharacteristic* pCharacteristic) {
+    AllocTracker::Scope alloc(ALLOC_BLE);
+    BLEManager::instance().updateInteraction();
+    uint8_t buf[BootProfiler::serializedMax()];
+    size_t len = BootProfiler::instance().serialize(buf, sizeof(buf));
+    pCharacteristic->setValue(buf, len);
+    Logger::infof("[BLEManager] Diagnostics read: %u bytes of boot profiles.", (unsigned)len);
+}
+
 // -----------------------------------------------------------------------------
 // Notification, Logging, and CCCD State
 // -----------------------------------------------------------------------------
 
 void BLEManager::pumpLogs() {
+    AllocTracker::Scope alloc(ALLOC_BLE);
     if (!loggerChar || !loggerSubscribed) return;
 #if LOG_LEVEL < 1
     return; // In release builds with LOG_LEVEL 0, skip pumping
 #endif
     const size_t maxPayload = maxNotifyPayload();
     int sent = 0;
-    std::string line;
-    while (sent < kBurst && LogBuffer::instance().pop(line)) {
+    char line[LogBuffer::lineCapacity()];
+    size_t len;
+    while (sent < kBurst && (len = LogBuffer::instance().pop(line, sizeof(line))) > 0) {
         updateInteraction();
         size_t offset = 0;
-        while (offset < line.size() && sent < kBurst) {
-            size_t chunk = std::min(maxPayload, line.size() - offset);
-            loggerChar->setValue((uint8_t*)line.data() + offset, chunk);
-            if (loggerIndicateEnabled) {
-                loggerChar->indicate();
-            } else {
-                loggerChar->notify();
-            }
+        while (offset < len && sent < kBurst) {
+            size_t chunk = std::min(maxPayload, len - offset);
+            loggerChar->setValue((uint8_t*)line + offset, chunk);
+            pushValue(loggerChar, loggerIndicateEnabled, CNT_LOGGER_NOTIFY);
             offset += chunk;
             sent++;
         }
@@ -301,6 +499,7 @@ void BLEManager::setSubscriptionStatus(bool subscribed) {
 
 // --- CCCD Callbacks ---
 void BLEManager::PuffsCccdCallbacks::onWrite(BLEDescriptor* pDescriptor) {
+    AllocTracker::Scope alloc(ALLOC_BLE);
     uint8_t* val = pDescriptor->getValue();
     bool notifyEn = false;
     bool indicateEn = false;
@@ -310,7 +509,7 @@ void BLEManager::PuffsCccdCallbacks::onWrite(BLEDescriptor* pDescriptor) {
     }
     Logger::infof("[BLEManager] Puffs CCCD updated: notify=%s indicate=%s", notifyEn ? "true" : "false", indicateEn ? "true" : "false");
     BLEManager::instance().setPuffsCccd(notifyEn, indicateEn);
-    if (notifyEn || indicateEn) {
+    if ((notifyEn || indicateEn) && BLEManager::instance().waitStateReady()) {
         StateMachine& sm = StateMachine::instance();
         if (sm.hasCurrentPuff()) {
             PuffModel p = sm.currentPuff();
@@ -321,6 +520,7 @@ void BLEManager::PuffsCccdCallbacks::onWrite(BLEDescriptor* pDescriptor) {
 }
 
 void BLEManager::PhasesCccdCallbacks::onWrite(BLEDescriptor* pDescriptor) {
+    AllocTracker::Scope alloc(ALLOC_BLE);
     uint8_t* val = pDescriptor->getValue();
     bool notifyEn = false;
     bool indicateEn = false;
@@ -330,7 +530,7 @@ void BLEManager::PhasesCccdCallbacks::onWrite(BLEDescriptor* pDescriptor) {
     }
     BLEManager::instance().setPhasesCccd(notifyEn, indicateEn);
     Logger::infof("[BLEManager] Phases CCCD updated: notify=%s indicate=%s", notifyEn?"true":"false", indicateEn?"true":"false");
-    if (notifyEn || indicateEn) {
+    if ((notifyEn || indicateEn) && BLEManager::instance().waitStateReady()) {
         StateMachine& sm = StateMachine::instance();
         if (sm.hasCurrentPhase()) {
             PhaseModel ph = sm.currentPhase();
@@ -341,6 +541,7 @@ void BLEManager::PhasesCccdCallbacks::onWrite(BLEDescriptor* pDescriptor) {
 }
 
 void BLEManager::LoggerCccdCallbacks::onWrite(BLEDescriptor* pDescriptor) {
+    AllocTracker::Scope alloc(ALLOC_BLE);
     uint8_t* val = pDescriptor->getValue();
     bool notifyEn = false;
     bool indicateEn = false;
@@ -358,37 +559,67 @@ void BLEManager::LoggerCccdCallbacks::onWrite(BLEDescriptor* pDescriptor) {
 // Notification Helpers
 // -----------------------------------------------------------------------------
 
+size_t BLEManager::encodePuffFrame(const PuffModel* puffs, size_t count, bool v2, uint8_t* frame, size_t cap) {
+    size_t header = v2 ? PUFF_HEADER_V2 : PUFF_HEADER;
+    size_t entry = v2 ? PUFF_ENTRY_V2 : PUFF_ENTRY;
+    if (cap < header) return 0;
+    if (count > (cap - header) / entry) count = (cap - header) / entry;
+    if (count > UINT8_MAX) count = UINT8_MAX;
+    uint32_t first = count ? (uint32_t)puffs[0].puffNumber : 0;
+    frame[0] = v2 ? 0x03 : 0x01;
+    if (v2) writeLE32(&frame[1], first); else writeLE(&frame[1], (uint16_t)first);
+    frame[header - 1] = (uint8_t)count;
+    uint8_t* e = &frame[header];
+    for (size_t i = 0; i < count; ++i, e += entry) {
+        const PuffModel& pf = puffs[i];
+        // v1 carries the low 16 bits of the puff number
+        if (v2) writeLE32(e, (uint32_t)pf.puffNumber); else writeLE(e, (uint16_t)pf.puffNumber);
+        uint8_t* rest = e + (v2 ? 4 : 2);
+        writeLE32(rest, (uint32_t)pf.timestampSec);
+        // Puff duration is milliseconds; frame stores it as uint16 (will truncate above 65535ms)
+        writeLE(rest + 4, (uint16_t)pf.puffDuration);
+        // v1 carries the low 8 bits of the phase index
+        if (v2) writeLE(rest + 6, (uint16_t)pf.phaseIndex); else rest[6] = (uint8_t)pf.phaseIndex;
+    }
+    return header + count * entry;
+}
+
+size_t BLEManager::encodePhaseFrame(const PhaseModel* phases, size_t count, bool v2, uint8_t* frame, size_t cap) {
+    size_t entry = v2 ? PHASE_ENTRY_V2 : PHASE_ENTRY;
+    if (cap < PHASE_HEADER) return 0;
+    if (count > (cap - PHASE_HEADER) / entry) count = (cap - PHASE_HEADER) / entry;
+    if (count > UINT8_MAX) count = UINT8_MAX;
+    frame[0] = v2 ? 0x03 : 0x01;
+    writeLE(&frame[1], count ? (uint16_t)phases[0].phaseIndex : 0);
+    frame[3] = (uint8_t)count;
+    uint8_t* e = &frame[PHASE_HEADER];
+    for (size_t i = 0; i < count; ++i, e += entry) {
+        // v1 carries the low 8 bits of the phase index
+        if (v2) writeLE(e, (uint16_t)phases[i].phaseIndex); else e[0] = (uint8_t)phases[i].phaseIndex;
+        writeLE32(e + (v2 ? 2 : 1), (uint32_t)phases[i].phaseStartSec);
+    }
+    return PHASE_HEADER + count * entry;
+}
+
 void BLEManager::notifyNewPuff(const PuffModel& puff) {
+    AllocTracker::Scope alloc(ALLOC_BLE);
     if (!puffsChar) return;
-    // Batch-of-one using standard batch framing:
-    // Header (4): [type=0x01][firstPuff(2)][count=1]
-    // Entry  (9): [puffNumber(2)][timestamp(4)][duration(2)][phaseIndex(1)]
-    uint8_t frame[BLEManager::PUFF_HEADER + BLEManager::PUFF_ENTRY] = {0};
-    frame[0] = 0x01;
-    BLEManager::writeLE(&frame[1], puff.puffNumber); // first puff number
-    frame[3] = 1; // count
-    BLEManager::writeLE(&frame[BLEManager::PUFF_HEADER + 0], puff.puffNumber);
-    BLEManager::writeLE32(&frame[BLEManager::PUFF_HEADER + 2], (uint32_t)puff.timestampSec);
-    BLEManager::writeLE(&frame[BLEManager::PUFF_HEADER + 6], (uint16_t)puff.puffDuration);
-    frame[BLEManager::PUFF_HEADER + 8] = (uint8_t)puff.phaseIndex;
-    puffsChar->setValue(frame, sizeof(frame));
-    if (usePuffsIndicate()) puffsChar->indicate(); else puffsChar->notify();
+    // Batch-of-one in the framing the client last requested (see encodePuffFrame)
+    uint8_t frame[BLEManager::PUFF_HEADER_V2 + BLEManager::PUFF_ENTRY_V2];
+    size_t frameLen = encodePuffFrame(&puff, 1, puffsWireV2, frame, sizeof(frame));
+    puffsChar->setValue(frame, frameLen);
+    pushValue(puffsChar, usePuffsIndicate(), CNT_PUFFS_NOTIFY);
     Logger::infof("[BLEManager] Live Puff notified (%d).", puff.puffNumber);
 }
 
 void BLEManager::notifyNewPhase(const PhaseModel& phase) {
+    AllocTracker::Scope alloc(ALLOC_BLE);
     if (!phasesChar) return;
-    // Batch-of-one using standard phases batch framing:
-    // Header (4): [type=0x01][firstPhase(2)][count=1]
-    // Entry  (5): [phaseIndex(1)][startSec(4)]
-    uint8_t frame[BLEManager::PHASE_HEADER + BLEManager::PHASE_ENTRY] = {0};
-    frame[0] = 0x01;
-    BLEManager::writeLE(&frame[1], (uint16_t)phase.phaseIndex);
-    frame[3] = 1; // count
-    frame[BLEManager::PHASE_HEADER + 0] = (uint8_t)phase.phaseIndex; // entry phase index
-    BLEManager::writeLE32(&frame[BLEManager::PHASE_HEADER + 1], (uint32_t)phase.phaseStartSec);
-    phasesChar->setValue(frame, sizeof(frame));
-    if (usePhasesIndicate()) phasesChar->indicate(); else phasesChar->notify();
+    // Batch-of-one in the framing the client last requested (see encodePhaseFrame)
+    uint8_t frame[BLEManager::PHASE_HEADER + BLEManager::PHASE_ENTRY_V2];
+    size_t frameLen = encodePhaseFrame(&phase, 1, phasesWireV2, frame, sizeof(frame));
+    phasesChar->setValue(frame, frameLen);
+    pushValue(phasesChar, usePhasesIndicate(), CNT_PHASES_NOTIFY);
     Logger::infof("[BLEManager] Live Phase %d notified.", phase.phaseIndex);
 }
 
@@ -13,7 +13,11 @@
 
 // --- Standard Library Includes ---
 #include <Arduino.h>
-#include <memory>
+
+// --- FreeRTOS Includes ---
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <freertos/event_groups.h>
 
 // --- ESP32 BLE Library Includes ---
 #include <BLEDevice.h>
@@ -21,10 +25,13 @@
 #include <BLECharacteristic.h>
 #include <BLEDescriptor.h>
 #include <BLEAdvertising.h>
+#include <BLE2902.h>
 
 // --- Project Includes ---
 #include "Logger.h"
 #include "StateMachine.h"
+#include "Counters.h"
+#include "Rollups.h"
 
 // -----------------------------------------------------------------------------
 // BLE Constants (UUIDs, MTU, Timeouts)
@@ -35,19 +42,27 @@
 #define SERVICE_UUID        "56a63ec7-0623-4242-9a66-f2ad8f9f270b"   ///< Main BLE service UUID
 #define NTP_CHAR_UUID       "c8646c82-aa4b-4ac8-b6d5-cb45677ebcaa" ///< NTP time sync characteristic UUID
 #define KEEPALIVE_CHAR_UUID "ac4678ba-8131-4a70-8ffd-a7c7f0ed23b0" ///< Keepalive characteristic UUID
+#define METRICS_CHAR_UUID   "bc8253f4-f49b-44ae-b605-adc855340271" ///< Latency histograms characteristic UUID (read snapshot / write 0x01 to reset)
+#define COUNTERS_CHAR_UUID  "8302ab91-73bb-45b9-a2d4-ec5c5687e4f0" ///< Device counters characteristic UUID (read)
+#define ROLLUPS_CHAR_UUID   "8a217bb2-478d-4498-9dd8-35dca3b728a0" ///< Per-phase/per-day rollups characteristic UUID (write query / read frame)
 #define PUFFS_CHAR_UUID     "cedf9ce5-2953-4d18-b38c-100a3a90f987" ///< Puff data characteristic UUID
 #define PHASES_CHAR_UUID    "9016b7fe-7192-40ce-8a83-451fc2ae5a97" ///< Phase data characteristic UUID
 #define LOGGER_CHAR_UUID    "332e04f5-7a8a-491d-a730-f4748a6116e2" ///< Logger characteristic UUID
+#define DIAG_CHAR_UUID      "a751fa09-63b7-4467-8dcc-421d3e5925f5" ///< Diagnostics (boot profiles) characteristic UUID
 ///@}
 
 #define PEER_MTU            185   ///< Default peer MTU size
 
-/// @brief Timeout in ms for BLE inactivity
-static constexpr uint32_t BLE_TIMEOUT = 60 * 1000UL;
-
 /// @brief Max number of log lines to send per pumpLogs() call
 #define kBurst 5
 
+/// @name Pipelined Boot
+///@{
+static constexpr uint32_t BLE_START_TASK_STACK = 8192;   ///< Stack for the BLE bring-up task
+static constexpr UBaseType_t BLE_START_TASK_PRIO = 1;    ///< Priority of the BLE bring-up task
+static constexpr uint32_t STATE_READY_TIMEOUT_MS = 2000; ///< Max wait in a handler for persisted state
+///@}
+
 // -----------------------------------------------------------------------------
 // BLEManager Class
 // -----------------------------------------------------------------------------
@@ -69,9 +84,13 @@ public:
     static constexpr size_t PUFF_FRAME_MAX  = PEER_MTU - 3; ///< Max puff frame payload
     static constexpr size_t PUFF_HEADER     = 4;            ///< Puff frame header size (type + firstPuff(2) + count)
     static constexpr size_t PUFF_ENTRY      = 9;            ///< Puff entry size (puffNumber(2) + timestamp(4) + duration(2) + phase(1))
+    static constexpr size_t PUFF_HEADER_V2  = 6;            ///< v2 puff frame header size (type + firstPuff(4) + count)
+    static constexpr size_t PUFF_ENTRY_V2   = 12;           ///< v2 puff entry size (puffNumber(4) + timestamp(4) + duration(2) + phase(2))
     static constexpr size_t PHASE_FRAME_MAX = PEER_MTU - 3; ///< Max phase frame payload
     static constexpr size_t PHASE_HEADER    = 4;            ///< Phase frame header size (type + firstPhase(2) + count)
     static constexpr size_t PHASE_ENTRY     = 5;            ///< Phase entry size (phaseIndex(1) + startSec(4))
+    static constexpr size_t PHASE_ENTRY_V2  = 6;            ///< v2 phase entry size (phaseIndex(2) + startSec(4))
+    static constexpr size_t ROLLUP_FRAME_MAX = PEER_MTU - 3; ///< Max rollup frame payload
     ///@}
 
     /**
@@ -109,15 +128,49 @@ public:
     void setSubscriptionStatus(bool subscribed);
 
     /**
-     * @brief Start BLE service and advertising.
+     * @brief Start BLE service and advertising. Idempotent: while the service is up this only
+     * resumes advertising.
      */
     void startService();
 
+    /**
+     * @brief Start BLE service and advertising on a separate task so it overlaps with
+     * persistence reconstruction. Handlers that touch state wait for markStateReady().
+     */
+    void startServiceAsync();
+
+    /**
+     * @brief Release characteristic handlers blocked on the state-ready barrier.
+     */
+    void markStateReady();
+
+    /**
+     * @brief Block until StateMachine/persistence are ready (or timeout).
+     * @return True if state is ready.
+     */
+    bool waitStateReady(uint32_t timeoutMs = STATE_READY_TIMEOUT_MS);
+
+    /**
+     * @brief Microseconds from reset until advertising started (0 if not yet).
+     */
+    uint32_t advertiseReadyUs() const { return advertiseUs; }
+
     /**
      * @brief Cleanup BLE service and release resources.
      */
     void cleanupService();
 
+    /**
+     * @brief Milliseconds the radio has been up this wake, including the current session.
+     */
+    uint32_t radioOnMs() const;
+
+    /**
+     * @brief Log radio-on time of this wake and the running totals kept across deep sleep.
+     * Call once per wake, before deep sleep.
+     */
+    void logRadioReport();
+
     /**
      * @brief Query if BLE is currently active.
      * @return True if BLE is enabled.
@@ -130,10 +183,19 @@ public:
     void updateInteraction();
 
     /**
-     * @brief Check if BLE connection has timed out.
-     * @return True if timeout has occurred.
+     * @brief millis() of the last BLE request or connection event.
      */
-    bool connectionTimeOut() const;
+    uint32_t lastInteractionMs() const { return lastInteractionTime; }
+
+    /**
+     * @brief Query whether a client is connected.
+     */
+    bool isConnected() const { return clientConnected; }
+
+    /**
+     * @brief True while log lines are queued for a subscribed logger client.
+     */
+    bool hasPendingNotifications() const;
 
     /**
      * @brief Get maximum payload available for a single notify/indicate (negotiated MTU minus ATT header).
@@ -169,8 +231,17 @@ private:
     BLECharacteristic* phasesChar;
     BLECharacteristic* loggerChar;
     BLECharacteristic* keepAliveChar;
+    BLECharacteristic* metricsChar;
+    BLECharacteristic* countersChar;
+    BLECharacteristic* diagChar;
+    BLECharacteristic* rollupsChar;
     bool bleEnabled;
-    unsigned long lastInteractionTime;
+    volatile unsigned long lastInteractionTime;
+    volatile bool clientConnected = false;
+    EventGroupHandle_t stateReadyGroup = nullptr;
+    volatile uint32_t advertiseUs = 0;
+
+    static void startServiceTask(void* arg);
     bool loggerSubscribed = false;
     bool loggerNotifyEnabled = false;
     bool loggerIndicateEnabled = false;
@@ -178,6 +249,22 @@ private:
     bool puffsIndicateEnabled = false;
     bool phasesNotifyEnabled = false;
     bool phasesIndicateEnabled = false;
+    bool puffsWireV2 = false; ///< Client sent a v2 puffs request (32-bit puff numbers) on this connection
+    bool phasesWireV2 = false; ///< Client sent a v2 phases request (16-bit phase indices) on this connection
+
+    /**
+     * @brief Encode puffs as one frame: v1 [0x01][firstPuff(2)][count] + 9-byte entries,
+     * v2 [0x03][firstPuff(4)][count] + 12-byte entries (little-endian).
+     * @return Frame length (entries that do not fit in cap are left out).
+     */
+    static size_t encodePuffFrame(const PuffModel* puffs, size_t count, bool v2, uint8_t* frame, size_t cap);
+
+    /**
+     * @brief Encode phases as one frame: v1 [0x01][firstPhase(2)][count] + 5-byte entries,
+     * v2 [0x03][firstPhase(2)][count] + 6-byte entries (little-endian).
+     * @return Frame length (entries that do not fit in cap are left out).
+     */
+    static size_t encodePhaseFrame(const PhaseModel* phases, size_t count, bool v2, uint8_t* frame, size_t cap);
 
     // Inline little-endian writers
     static inline void writeLE(uint8_t* buf, uint16_t val) {
@@ -186,12 +273,17 @@ private:
     static inline void writeLE32(uint8_t* buf, uint32_t val) {
         buf[0] = val & 0xFF; buf[1] = (val >> 8) & 0xFF; buf[2] = (val >> 16) & 0xFF; buf[3] = (val >> 24) & 0xFF;
     }
+    // Inline helper to notify or indicate the current value and count it (notifyCounter + 1 = indicate)
+    static inline void pushValue(BLECharacteristic* c, bool indicate, CounterId notifyCounter) {
+        if (indicate) c->indicate(); else c->notify();
+        Counters::instance().add(indicate ? (CounterId)(notifyCounter + 1) : notifyCounter);
+    }
     // Inline helper to send a standard one-byte done frame (0x02) with logging
-    static inline void sendDone(BLECharacteristic* c, const char* label) {
+    static inline void sendDone(BLECharacteristic* c, const char* label, CounterId notifyCounter) {
         if (!c) return;
         uint8_t doneFrame[1] = {0x02};
         c->setValue(doneFrame, 1);
-        c->notify();
+        pushValue(c, false, notifyCounter);
         Logger::infof("[BLEManager] Sent %s done frame.", label);
     }
 
@@ -222,6 +314,34 @@ private:
         KeepAliveCallbacks();
         void onRead(BLECharacteristic* pCharacteristic) override;
     };
+    class MetricsCallbacks : public BLECharacteristicCallbacks {
+    public:
+        MetricsCallbacks();
+        void onRead(BLECharacteristic* pCharacteristic) override;
+        void onWrite(BLECharacteristic* pCharacteristic) override;
+    };
+    class CountersCallbacks : public BLECharacteristicCallbacks {
+    public:
+        CountersCallbacks();
+        void onRead(BLECharacteristic* pCharacteristic) override;
+    };
+    class RollupsCallbacks : public BLECharacteristicCallbacks {
+    public:
+        RollupsCallbacks();
+        void onRead(BLECharacteristic* pCharacteristic) override;
+        void onWrite(BLECharacteristic* pCharacteristic) override;
+        void reset() { kind = ROLLUP_DAY; fromKey = 0; maxCount = 0; }
+    private:
+        // Query served by the next read; defaults to every stored day
+        volatile uint8_t kind = ROLLUP_DAY;
+        volatile uint32_t fromKey = 0;
+        volatile uint8_t maxCount = 0;
+    };
+    class DiagCallbacks : public BLECharacteristicCallbacks {
+    public:
+        DiagCallbacks();
+        void onRead(BLECharacteristic* pCharacteristic) override;
+    };
     // Descriptor callbacks for CCCD (0x2902)
     class LoggerCccdCallbacks : public BLEDescriptorCallbacks {
     public:
@@ -235,13 +355,43 @@ private:
     public:
         void onWrite(BLEDescriptor* pDescriptor) override;
     };
-    // Callback instances managed by smart pointers for automatic cleanup
-    std::unique_ptr<MyServerCallbacks> serverCallbacks;
-    std::unique_ptr<NTPCallbacks> ntpCallbacks;
-    std::unique_ptr<PuffsCallbacks> puffsCallbacks;
-    std::unique_ptr<PhasesCallbacks> phasesCallbacks;
-    std::unique_ptr<KeepAliveCallbacks> keepAliveCallbacks;
-    std::unique_ptr<LoggerCccdCallbacks> loggerCccdCallbacks;
-    std::unique_ptr<PuffsCccdCallbacks> puffsCccdCallbacks;
-    std::unique_ptr<PhasesCccdCallbacks> phasesCccdCallbacks;
+    /**
+     * @class CccdSlot
+     * @brief In-place CCCD descriptor. The stack keeps the attribute handle, so a descriptor is
+     * rebuilt (in the same storage) only when it is reused after cleanupService().
+     */
+    class CccdSlot {
+    public:
+        BLE2902* acquire(BLEDescriptorCallbacks* callbacks);
+    private:
+        alignas(BLE2902) uint8_t storage[sizeof(BLE2902)];
+        BLE2902* cccd = nullptr;
+    };
+
+    /**
+     * @brief Callbacks and descriptors handed to the BLE library, owned by the singleton and
+     * reused by every startService() instead of being allocated per start.
+     */
+    struct ServiceArena {
+        MyServerCallbacks server;
+        NTPCallbacks ntp;
+        PuffsCallbacks puffs;
+        PhasesCallbacks phases;
+        KeepAliveCallbacks keepAlive;
+        MetricsCallbacks metrics;
+        CountersCallbacks counters;
+        DiagCallbacks diag;
+        RollupsCallbacks rollups;
+        LoggerCccdCallbacks loggerCccdCallbacks;
+        PuffsCccdCallbacks puffsCccdCallbacks;
+        PhasesCccdCallbacks phasesCccdCallbacks;
+        CccdSlot puffsCccd;
+        CccdSlot phasesCccd;
+        CccdSlot loggerCccd;
+    };
+    ServiceArena arena;
+    bool serviceStarted = false; ///< GATT service built on the running stack (cleared by cleanupService)
+    bool radioOn = false;         ///< Controller initialized since the last cleanupService()
+    uint32_t radioOnStartUs = 0;  ///< micros() when the controller came up
+    uint32_t radioOnUs = 0;       ///< Completed radio-on time this wake
 };
\ No newline at end of file
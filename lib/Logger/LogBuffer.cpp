@@ -1,10 +1,10 @@
-
 /**
  * @file LogBuffer.cpp
  * @brief Implementation of LogBuffer circular buffer for log messages.
  */
 
 #include "LogBuffer.h"
+#include <cstring>
 
 // -----------------------------------------------------------------------------
 // LogBuffer Method Implementations
@@ -15,20 +15,43 @@ LogBuffer& LogBuffer::instance() {
     return inst;
 }
 
-void LogBuffer::push(const std::string& line) {
-    std::string s = line;
-    if (s.size() > kMaxLineLen) s.resize(kMaxLineLen);
-    if (q_.size() >= kCapacity) q_.pop_front();
-    q_.push_back(std::move(s));
+LogBuffer::LogBuffer() : mutex_(xSemaphoreCreateMutex()) {}
+
+void LogBuffer::push(const char* line) {
+    if (!line) return;
+    size_t len = strnlen(line, kMaxLineLen);
+    xSemaphoreTake(mutex_, portMAX_DELAY);
+    if (count_ >= kCapacity) {
+        head_ = (head_ + 1) % kCapacity;
+        count_--;
+        dropped_ = dropped_ + 1;
+    }
+    char* slot = lines_[(head_ + count_) % kCapacity];
+    memcpy(slot, line, len);
+    slot[len] = '\0';
+    count_++;
+    xSemaphoreGive(mutex_);
 }
 
-bool LogBuffer::pop(std::string& out) {
-    if (q_.empty()) return false;
-    out = std::move(q_.front());
-    q_.pop_front();
-    return true;
+size_t LogBuffer::pop(char* out, size_t cap) {
+    if (!out || cap == 0) return 0;
+    xSemaphoreTake(mutex_, portMAX_DELAY);
+    size_t len = 0;
+    if (count_ > 0) {
+        const char* slot = lines_[head_];
+        len = strnlen(slot, cap - 1);
+        memcpy(out, slot, len);
+        head_ = (head_ + 1) % kCapacity;
+        count_--;
+    }
+    out[len] = '\0';
+    xSemaphoreGive(mutex_);
+    return len;
 }
 
 size_t LogBuffer::size() const {
-    return q_.size();
+    xSemaphoreTake(mutex_, portMAX_DELAY);
+    size_t n = count_;
+    xSemaphoreGive(mutex_);
+    return n;
 }
@@ -5,15 +5,20 @@
  * @file LogBuffer.h
  * @brief Circular buffer for log messages (FIFO, thread-safe).
  *
- * Provides a bounded FIFO for log lines, with truncation and capacity management.
+ * Provides a bounded FIFO for log lines, with truncation and capacity management. Lines are
+ * copied into fixed slots, so logging never touches the heap.
  *
  * @author Vetra Firmware Team
  * @copyright Copyright (c) 2025 Vetra
  */
 
 // --- Standard Library Includes ---
-#include <string>
-#include <deque>
+#include <cstddef>
+#include <cstdint>
+
+// --- FreeRTOS Includes ---
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
 
 // -----------------------------------------------------------------------------
 // LogBuffer Class
@@ -34,16 +39,17 @@ public:
 
     /**
      * @brief Push a line into the buffer (truncated if needed).
-     * @param line Log line to push.
+     * @param line Null-terminated log line to push.
      */
-    void push(const std::string& line);
+    void push(const char* line);
 
     /**
      * @brief Pop a line if available.
-     * @param out Output string for the popped line.
-     * @return True if a line was returned.
+     * @param out Buffer for the popped line (null-terminated, truncated to cap - 1 characters).
+     * @param cap Size of out; lineCapacity() holds any line.
+     * @return Length of the line written to out, 0 if the buffer was empty.
      */
-    bool pop(std::string& out);
+    size_t pop(char* out, size_t cap);
 
     /**
      * @brief Number of queued lines.
@@ -55,9 +61,23 @@ public:
      */
     size_t capacity() const { return kCapacity; }
 
+    /**
+     * @brief Bytes needed to pop any line, terminator included.
+     */
+    static constexpr size_t lineCapacity() { return kMaxLineLen + 1; }
+
+    /**
+     * @brief Lines discarded because the buffer was full (since boot).
+     */
+    uint32_t dropped() const { return dropped_; }
+
 private:
-    LogBuffer() = default;
+    LogBuffer();
     static constexpr size_t kCapacity = 100;      ///< Max lines in buffer
-    static constexpr size_t kMaxLineLen = 512;    ///< Max line length (truncated)
-    std::deque<std::string> q_;
+    static constexpr size_t kMaxLineLen = 159;    ///< Max line length (truncated); Logger lines fit
+    char lines_[kCapacity][kMaxLineLen + 1];      ///< Ring of null-terminated lines
+    size_t head_ = 0;                             ///< Oldest line
+    size_t count_ = 0;                            ///< Queued lines
+    SemaphoreHandle_t mutex_;                     ///< Guards the ring (loop task, BLE task, boot task)
+    volatile uint32_t dropped_ = 0;               ///< Lines discarded because the ring was full
 };
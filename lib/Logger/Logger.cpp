@@ -8,6 +8,7 @@
 
 #include "Logger.h"
 #include "LogBuffer.h"
+#include "AllocTracker.h"
 #include <stdarg.h>
 
 // -----------------------------------------------------------------------------
@@ -21,9 +22,21 @@
  * @param args va_list of arguments.
  */
 static void vlogf_and_push(const char* level, const char* fmt, va_list args) {
-    char buf[128];
-    vsnprintf(buf, sizeof(buf), fmt, args);
-    std::string line = std::string(level) + ": " + buf;
+    // Formatted on the stack and copied into a LogBuffer slot; no heap
+    AllocTracker::Scope alloc(ALLOC_LOGGER);
+    char line[LogBuffer::lineCapacity()];
+    int n = snprintf(line, sizeof(line), "%s: ", level);
+    vsnprintf(line + n, sizeof(line) - n, fmt, args);
+    LogBuffer::instance().push(line);
+}
+
+/**
+ * @brief Push an unformatted message with a given level.
+ */
+static void log_and_push(const char* level, const char* msg) {
+    AllocTracker::Scope alloc(ALLOC_LOGGER);
+    char line[LogBuffer::lineCapacity()];
+    snprintf(line, sizeof(line), "%s: %s", level, msg);
     LogBuffer::instance().push(line);
 }
 
@@ -33,8 +46,7 @@ static void vlogf_and_push(const char* level, const char* fmt, va_list args) {
 
 void Logger::info(const char* msg) {
 #if LOG_LEVEL >= 2
-    std::string line = std::string("INFO: ") + msg;
-    LogBuffer::instance().push(line);
+    log_and_push("INFO", msg);
 #endif
 }
 
@@ -48,8 +60,7 @@ void Logger::infof(const char* fmt, ...) {
 
 void Logger::warning(const char* msg) {
 #if LOG_LEVEL >= 1
-    std::string line = std::string("WARNING: ") + msg;
-    LogBuffer::instance().push(line);
+    log_and_push("WARNING", msg);
 #endif
 }
 
@@ -62,8 +73,7 @@ void Logger::warningf(const char* fmt, ...) {
 }
 
 void Logger::error(const char* msg) {
-    std::string line = std::string("ERROR: ") + msg;
-    LogBuffer::instance().push(line);
+    log_and_push("ERROR", msg);
 }
 
 void Logger::errorf(const char* fmt, ...) {
@@ -0,0 +1,23 @@
+#include "PhaseSchedule.h"
+
+// -----------------------------------------------------------------------------
+// PhaseSchedule Method Implementations
+// -----------------------------------------------------------------------------
+
+const PhaseSchedule& PhaseSchedule::program() {
+    static const PhaseSchedule schedule(PHASE_DURATION_SECONDS, MAX_PUFFS, PHASE_PUFF_STEP, PHASE_MIN_PUFFS, NUM_PHASES);
+    return schedule;
+}
+
+PhaseModel PhaseSchedule::phaseAt(int32_t index) const {
+    PhaseModel phase{};
+    phase.phaseIndex = index;
+    phase.phaseDuration = durationSec_;
+    // 64-bit so long open-ended programs cannot wrap the taper
+    uint64_t taper = (uint64_t)puffStep_ * (uint32_t)(index < 0 ? 0 : index);
+    uint32_t floor = minPuffs_ < maxPuffs_ ? minPuffs_ : maxPuffs_;
+    phase.maxPuffs = (taper >= (uint64_t)(maxPuffs_ - floor)) ? (int)floor : (int)(maxPuffs_ - taper);
+    phase.phaseStartSec = 0;
+    phase.puffsTaken = 0;
+    return phase;
+}
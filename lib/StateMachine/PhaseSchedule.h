@@ -0,0 +1,81 @@
+#pragma once
+
+/**
+ * @file PhaseSchedule.h
+ * @brief Computed phase program: the parameters of phase n are derived on demand, never stored.
+ *
+ * Every phase lasts the same time; the puff allowance starts at the base and drops by a fixed
+ * step each phase down to a floor (step 0 = the same phase recurring). Only the current phase
+ * is held in RAM; past phases are read back from the persisted phase records.
+ *
+ * @author Vetra Firmware Team
+ * @copyright Copyright (c) 2025 Vetra
+ */
+
+// --- Standard Library Includes ---
+#include <Arduino.h>
+#include <cstdint>
+
+// --- Project Includes ---
+#include "StateMachine.h"
+
+// -----------------------------------------------------------------------------
+// Phase Schedule Constants
+// -----------------------------------------------------------------------------
+
+/// @name Phase Program
+///@{
+// Puffs removed from the allowance at each phase (0 = every phase allows MAX_PUFFS).
+#ifndef PHASE_PUFF_STEP
+#define PHASE_PUFF_STEP                   0
+#endif
+// Lowest allowance a tapering program reaches.
+#ifndef PHASE_MIN_PUFFS
+#define PHASE_MIN_PUFFS                   1
+#endif
+///@}
+
+/// @brief Highest phase index any program reaches (phase records store a 16-bit index)
+static constexpr uint32_t PHASE_INDEX_LIMIT = UINT16_MAX;
+
+// -----------------------------------------------------------------------------
+// PhaseSchedule Class
+// -----------------------------------------------------------------------------
+
+/**
+ * @class PhaseSchedule
+ * @brief Parameterized phase program; phases 0..lastPhase, or open-ended when lastPhase is 0.
+ */
+class PhaseSchedule {
+public:
+    constexpr PhaseSchedule(uint32_t durationSec, uint16_t maxPuffs, uint16_t puffStep, uint16_t minPuffs, uint32_t lastPhase)
+        : durationSec_(durationSec), maxPuffs_(maxPuffs), puffStep_(puffStep), minPuffs_(minPuffs),
+          lastPhase_((lastPhase == 0 || lastPhase > PHASE_INDEX_LIMIT) ? PHASE_INDEX_LIMIT : lastPhase) {}
+
+    /**
+     * @brief Program built from PHASE_DURATION_SECONDS, MAX_PUFFS, PHASE_PUFF_STEP, PHASE_MIN_PUFFS and NUM_PHASES.
+     */
+    static const PhaseSchedule& program();
+
+    /**
+     * @brief True if the program has a phase with this index.
+     */
+    bool hasPhase(int32_t index) const { return index >= 0 && (uint32_t)index <= lastPhase_; }
+
+    /**
+     * @brief Last phase index of the program.
+     */
+    uint32_t lastPhase() const { return lastPhase_; }
+
+    /**
+     * @brief Parameters of phase index, with no start time and no puffs taken.
+     */
+    PhaseModel phaseAt(int32_t index) const;
+
+private:
+    const uint32_t durationSec_;
+    const uint16_t maxPuffs_;
+    const uint16_t puffStep_;
+    const uint16_t minPuffs_;
+    const uint32_t lastPhase_;
+};
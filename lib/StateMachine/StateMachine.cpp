@@ -8,117 +8,166 @@
 #include <Arduino.h>
 #include <algorithm>
 #include <cstdint>
+#include <esp_sleep.h>
 #include "Logger.h"
 #include "BLEManager.h"
 #include "PersistenceManager.h"
 #include "Timer.h"
+#include "BootProfiler.h"
+#include "Metrics.h"
+#include "Counters.h"
+#include "Rollups.h"
+#include "PhaseSchedule.h"
+#include "AllocTracker.h"
 
 // -----------------------------------------------------------------------------
 // PuffTimer Implementation
 // -----------------------------------------------------------------------------
 
-StateMachine::PuffTimer::PuffTimer() : startTime(0), active(false) {}
+StateMachine::PuffTimer::PuffTimer() : startUs(0), active(false) {}
 
-void StateMachine::PuffTimer::start() {
+void StateMachine::PuffTimer::start(uint64_t monoUs) {
     if (active) return;
-    startTime = (unsigned long)epochMillis();
+    startUs = monoUs;
     active = true;
 }
 
-long StateMachine::PuffTimer::getDuration() const {
-    if (startTime == 0) {
+long StateMachine::PuffTimer::getDuration(uint64_t monoUs) const {
+    if (!active) {
         Logger::error("[PuffTimer] getDuration() called before start()");
         return -1;
     }
-    unsigned long now = (unsigned long)epochMillis();
-    if (now < startTime) {
-        Logger::warning("[PuffTimer] current epoch earlier than startTime; returning 0");
-        return 0;
-    }
-    // Return elapsed milliseconds.
-    return static_cast<long>(now - startTime);
+    // Monotonic clock: a time sync during the puff cannot shorten or stretch it
+    return static_cast<long>((monoUs - startUs) / 1000ULL);
 }
 
 void StateMachine::PuffTimer::reset() {
-    startTime = 0;
+    startUs = 0;
     active = false;
 }
 
+// -----------------------------------------------------------------------------
+// Resume Snapshot (RTC memory, survives deep sleep)
+// -----------------------------------------------------------------------------
+
+static constexpr uint32_t RESUME_MAGIC = 0x56525331; // 'VRS1'
+static constexpr uint16_t RESUME_VERSION = 3;
+
+struct ResumeSnapshot {
+    uint32_t magic;
+    uint16_t version;
+    uint8_t state;
+    uint8_t hasLastPuff;
+    int32_t phaseIndex;
+    uint32_t phaseStartSec;
+    int32_t maxPuffs;
+    int32_t puffsTaken;
+    int32_t lastPuffNumber;
+    uint32_t lastPuffSec;
+    uint32_t lastPuffDurationMs;
+    int32_t lastPuffPhaseIndex;
+    PersistenceManager::ChannelCursor cursors[CHANNEL_COUNT];
+    PersistenceManager::RollupState rollups;
+    uint32_t crc32;       // over everything except crc32
+} __attribute__((packed));
+
+static RTC_DATA_ATTR ResumeSnapshot s_resume;
+
 // -----------------------------------------------------------------------------
 // StateMachine Core Implementation
 // -----------------------------------------------------------------------------
 
 StateMachine& StateMachine::instance() { static StateMachine inst;  return inst; }
 
-StateMachine::StateMachine() {
-    phases.reserve(NUM_PHASES + 1);
-    for (int i = 0; i <= NUM_PHASES; i++) {
-        PhaseModel newPm;
-        newPm.phaseIndex = i;
-    newPm.phaseDuration = PHASE_DURATION_SECONDS;
-        newPm.maxPuffs = MAX_PUFFS;
-        newPm.puffsTaken = 0;
-        phases.push_back(newPm);
-    }
-    currPhase = &phases[0];
+StateMachine::StateMachine() { boot(); }
+
+void StateMachine::boot() {
+    // Everything a reset clears; App::setup() registers the listener again
+    stateListener = nullptr;
+    hasPendingPuff = false;
+    puffTimer.reset();
+    phase = PhaseSchedule::program().phaseAt(0);
+    currPhase = &phase;
     currPhase->phaseStartSec = epochSeconds();
-    puffs.clear();
+    lastPuff = PuffModel{};
     currPuff = nullptr;
     currentState = PUFF_COUNTING;
+    BootProfiler::Scope prof(BOOT_RECONSTRUCT);
+    if (restoreResumeSnapshot()) {
+        Logger::infof("[StateMachine] Fast resume from RTC snapshot. Current Phase: %d, Current Puff: %d", currPhase->phaseIndex, currPuff ? currPuff->puffNumber : 0);
+        return;
+    }
     Logger::info("[StateMachine] Base initialized. Reconstructing from storage...");
     reconstructFromStorage();
 }
 
 StateMachine::~StateMachine() {
-    puffs.clear();
-    phases.clear();
     currPhase = nullptr;
     currPuff = nullptr;
     Logger::info("[StateMachine] Destroyed.");
 }
 
 void StateMachine::requireCurrPhase() {
-    if (!currPhase || currPhase->phaseIndex > NUM_PHASES) {
+    if (!currPhase || !PhaseSchedule::program().hasPhase(currPhase->phaseIndex)) {
         Logger::error("[StateMachine] currPhase unexpectedly null or out-of-range. Resetting to phase[0].");
-        if (!phases.empty()) {
-            currPhase = &phases[0];
-        }
+        phase = PhaseSchedule::program().phaseAt(0);
+        currPhase = &phase;
     }
 }
 
 // --- State Machine Control ---
-void StateMachine::handle_state_rising() {
+void StateMachine::enterState(state_t next) {
+    if (next == currentState) return;
+    currentState = next;
+    if (stateListener) stateListener(next);
+}
+
+void StateMachine::setStateListener(StateListener listener) {
+    stateListener = listener;
+    if (stateListener) stateListener(currentState);
+}
+
+void StateMachine::handle_state_rising(const Timebase::Now& now) {
+    AllocTracker::Scope alloc(ALLOC_STATE);
     switch (currentState) {
         case PUFF_COUNTING:
             Logger::info("[StateMachine] Puff attempt detected.");
             requireCurrPhase();
             hasPendingPuff = true;
-            puffTimer.start();
+            puffTimer.start(now.monoUs);
             pendingPuff = PuffModel{};
             pendingPuff.phaseIndex = currPhase->phaseIndex;
-            pendingPuff.timestampSec = epochSeconds();
-            PersistenceManager::instance().recordEpoch(epochSeconds());
+            pendingPuff.timestampSec = now.epochSec;
+            PersistenceManager::instance().recordEpoch(now.epochSec);
             break;
         case LOCKDOWN:
             Logger::error("[StateMachine] CRITICAL - Rising edge on blocked gate.");
     }
 }
 
-void StateMachine::handle_state_falling() {
+void StateMachine::handle_state_falling(const Timebase::Now& now) {
+    Metrics::Scope metric(METRIC_PUFF_FALLING);
+    AllocTracker::Scope alloc(ALLOC_STATE);
     switch (currentState) {
         case PUFF_COUNTING: {
             if (!hasPendingPuff) {
                 Logger::warning("[StateMachine] Falling edge detected before rising edge.");
                 return;
             }
-            long duration = puffTimer.getDuration();
+            long duration = puffTimer.getDuration(now.monoUs);
             puffTimer.reset();
             if (duration != -1 && duration >= (MIN_PUFF_DURATION_MILLISECONDS)) {
                 pendingPuff.puffDuration = (unsigned long)duration;
                 pendingPuff.puffNumber = getPuffNumber();
-                puffs.push_back(pendingPuff);
-                currPuff = &puffs.back();
+                lastPuff = pendingPuff;
+                currPuff = &lastPuff;
+                // Lock on the puff edge itself, ahead of the persistence and notification work
+                if (currPhase) {
+                    currPhase->puffsTaken++;
+                    if (currPhase->puffsTaken >= currPhase->maxPuffs) enterState(LOCKDOWN);
+                }
                 PersistenceManager::instance().appendPuff(*currPuff);
+                Rollups::instance().onPuff(currPuff->timestampSec, (uint32_t)currPuff->puffDuration, (uint16_t)currPuff->phaseIndex);
                 char ts[32];
                 if (epochToTimestamp(currPuff->timestampSec, ts, sizeof(ts))) {
                     Logger::infof("[StateMachine] New Puff recorded (%d). Duration(ms): %lu ms at %s", currPuff->puffNumber, currPuff->puffDuration, ts);
@@ -127,20 +176,19 @@ void StateMachine::handle_state_falling() {
                 }
                 BLEManager::instance().notifyNewPuff(*currPuff);
                 if (currPhase) {
-                    currPhase->puffsTaken++;
                     PersistenceManager::instance().updateCurrentPhasePuffsTaken((uint16_t)currPhase->phaseIndex, (uint16_t)currPhase->puffsTaken);
                     if (currPhase->puffsTaken == currPhase->maxPuffs) {
-                        currentState = LOCKDOWN;
                         Logger::infof("[StateMachine] Max puffs %d reached, state changed to LOCKDOWN.", currPhase->maxPuffs);
                     }
                     else if (currPhase->puffsTaken > currPhase->maxPuffs)
                     {
-                        currentState = LOCKDOWN;
                         Logger::errorf("[StateMachine] Exceeded max puffs %d, malfunction detected.", currPhase->maxPuffs);
                     }
                 }
+                if (currPuff->puffNumber % CHECKPOINT_INTERVAL == 0) writeCheckpoint();
             } else {
                 Logger::infof("Invalid puff duration (%ld ms); ignoring.", duration);
+                Counters::instance().add(CNT_PUFFS_INVALID);
             }
             hasPendingPuff = false;
             pendingPuff = PuffModel{};
@@ -154,58 +202,84 @@ void StateMachine::handle_state_falling() {
 }
 
 // --- Puff/Phase Access ---
-std::vector<PuffModel> StateMachine::getPuffs(uint16_t startAfter, uint8_t maxCount) const {
-    std::vector<PuffModel> result;
-    if (puffs.empty()) return result;
-
-    // Use lower_bound to find the first puff with puffNumber > startAfter
-    auto it = std::lower_bound(
-        puffs.begin(), puffs.end(), static_cast<uint16_t>(startAfter + 1),
-        [](const PuffModel& puff, uint16_t val) {
-        return puff.puffNumber < val;
-        }
-    );
+static PuffModel puffFromRecord(const PersistenceManager::PuffRecord& rec) {
+    PuffModel pm;
+    pm.puffNumber = rec.puffNumber;
+    pm.phaseIndex = rec.phaseIndex;
+    pm.puffDuration = rec.durationMs;
+    pm.timestampSec = rec.tSec;
+    return pm;
+}
 
-    // Collect up to maxCount puffs
-    for (; it != puffs.end() && (!maxCount || result.size() < (size_t)maxCount); ++it) {
-        result.push_back(*it);
-    }
-    return result;
+size_t StateMachine::getPuffs(uint32_t startAfter, PuffModel* out, size_t maxCount) {
+    if (!out || maxCount == 0) return 0;
+    // Puff n is stored as record n-1, so the first candidate is record startAfter
+    size_t n = 0;
+    PersistenceManager::instance().forEachPuff([&](const PersistenceManager::PuffRecord& rec) {
+        if (rec.puffNumber <= startAfter) return true;
+        out[n++] = puffFromRecord(rec);
+        return n < maxCount;
+    }, startAfter);
+    return n;
 }
 
-std::vector<PhaseModel> StateMachine::getPhases(uint16_t startAfter, uint8_t maxCount) const {
-    std::vector<PhaseModel> result;
-    if (phases.empty()) return result;
+size_t StateMachine::getPuffsInRange(uint32_t fromSec, uint32_t toSec, uint32_t startAfter, PuffModel* out, size_t maxCount) {
+    if (!out || maxCount == 0 || fromSec >= toSec) return 0;
+    PersistenceManager& pm = PersistenceManager::instance();
+    uint32_t first = std::max(pm.findPuffAtOrAfter(fromSec), startAfter);
+    size_t n = 0;
+    pm.forEachPuff([&](const PersistenceManager::PuffRecord& rec) {
+        if (rec.tSec >= toSec) return false;
+        if (rec.puffNumber <= startAfter) return true;
+        out[n++] = puffFromRecord(rec);
+        return n < maxCount;
+    }, first);
+    return n;
+}
+
+size_t StateMachine::getPhases(uint16_t startAfter, PhaseModel* out, size_t maxCount) {
+    if (!out || maxCount == 0) return 0;
+    const PhaseSchedule& schedule = PhaseSchedule::program();
     int endPhaseIndex = currPhase ? currPhase->phaseIndex : 1;
-    for (const auto& phase : phases) {
-        if (phase.phaseIndex > startAfter && phase.phaseIndex <= endPhaseIndex) {
-            result.push_back(phase);
-            if (maxCount && result.size() >= maxCount) break;
-        }
-    }
-    return result;
+    // Every phase after phase 0 has a record; the newest one mirrors the current phase
+    size_t n = 0;
+    PersistenceManager::instance().forEachPhase([&](const PersistenceManager::PhaseRecord& rec) {
+        if (rec.phaseIndex <= startAfter) return true;
+        if (rec.phaseIndex > endPhaseIndex) return false;
+        PhaseModel& ph = out[n++];
+        ph = schedule.phaseAt(rec.phaseIndex);
+        ph.phaseStartSec = rec.startSec;
+        ph.maxPuffs = rec.maxPuffs;
+        ph.puffsTaken = rec.puffsTaken;
+        return n < maxCount;
+    });
+    return n;
 }
 
 // --- Phase Control ---
 static bool s_lastPhaseLogMuted = false;  // prevents log spam
 
-void StateMachine::incrementValidPhase() {
-    // WARNING: unsigned integer comparison (ensure epochSeconds() is always greater)
+void StateMachine::incrementValidPhase(const Timebase::Now& now) {
+    AllocTracker::Scope alloc(ALLOC_STATE);
     requireCurrPhase();
-    if ((epochSeconds() - currPhase->phaseStartSec) >= currPhase->phaseDuration) {
-        currentState = PUFF_COUNTING;
-        if (currPhase->phaseIndex < NUM_PHASES) {
-            Logger::infof("[StateMachine] Elapsed (%u) > Phase duration, incrementing from phase (%d).", (unsigned)(epochSeconds() - currPhase->phaseStartSec), currPhase->phaseIndex);
-            currPhase = &phases[currPhase->phaseIndex + 1];
-            currPhase->phaseStartSec = epochSeconds();
+    // A phase start ahead of the wall clock (time set backwards) waits instead of wrapping
+    if (now.epochSec >= currPhase->phaseStartSec && (now.epochSec - currPhase->phaseStartSec) >= currPhase->phaseDuration) {
+        enterState(PUFF_COUNTING);
+        const PhaseSchedule& schedule = PhaseSchedule::program();
+        if (schedule.hasPhase(currPhase->phaseIndex + 1)) {
+            Logger::infof("[StateMachine] Elapsed (%u) > Phase duration, incrementing from phase (%d).", (unsigned)(now.epochSec - currPhase->phaseStartSec), currPhase->phaseIndex);
+            phase = schedule.phaseAt(currPhase->phaseIndex + 1);
+            currPhase = &phase;
+            currPhase->phaseStartSec = now.epochSec;
             PersistenceManager::instance().appendPhaseStart(*currPhase);
+            writeCheckpoint();
             char ts[32];
             if (epochToTimestamp(currPhase->phaseStartSec, ts, sizeof(ts))) {
                 Logger::infof("[StateMachine] Phase incremented to (%d) at %s", currPhase->phaseIndex, ts);
             } else {
                 Logger::infof("[StateMachine] Phase incremented to (%d) at (%u)", currPhase->phaseIndex, currPhase->phaseStartSec);
             }
-            PersistenceManager::instance().recordEpoch(epochSeconds());
+            PersistenceManager::instance().recordEpoch(now.epochSec);
             BLEManager::instance().notifyNewPhase(*currPhase);
         } else {
             if (!s_lastPhaseLogMuted) {
@@ -216,37 +290,178 @@ void StateMachine::incrementValidPhase() {
     }
 }
 
-// --- Reconstruction from storage ---
-void StateMachine::reconstructFromStorage() {
-    // Rebuild phases data from storage (track if anything was loaded)
-    bool loadedAnyPhase = false;
-    PersistenceManager::instance().forEachPhase([this, &loadedAnyPhase](const PersistenceManager::PhaseRecord& rec){
-        if (rec.phaseIndex < phases.size()) {
-            phases[rec.phaseIndex].phaseStartSec = rec.startSec;
-            phases[rec.phaseIndex].maxPuffs = rec.maxPuffs;
-            phases[rec.phaseIndex].puffsTaken = rec.puffsTaken;
-            currPhase = &phases[rec.phaseIndex];
-            loadedAnyPhase = true;
-        }
-    });
+uint32_t StateMachine::secondsUntilNextPhase() const {
+    if (!currPhase || !PhaseSchedule::program().hasPhase(currPhase->phaseIndex + 1)) return UINT32_MAX;
+    uint32_t now = epochSeconds();
+    uint32_t deadline = currPhase->phaseStartSec + (uint32_t)currPhase->phaseDuration;
+    return (now >= deadline) ? 0 : (deadline - now);
+}
 
+// --- Fast resume ---
+void StateMachine::saveResumeSnapshot() {
     requireCurrPhase();
+    ResumeSnapshot snap;
+    memset(&snap, 0, sizeof(snap));
+    snap.magic = RESUME_MAGIC;
+    snap.version = RESUME_VERSION;
+    snap.state = (uint8_t)currentState;
+    snap.phaseIndex = currPhase->phaseIndex;
+    snap.phaseStartSec = currPhase->phaseStartSec;
+    snap.maxPuffs = currPhase->maxPuffs;
+    snap.puffsTaken = currPhase->puffsTaken;
+    if (currPuff) {
+        snap.hasLastPuff = 1;
+        snap.lastPuffNumber = currPuff->puffNumber;
+        snap.lastPuffSec = currPuff->timestampSec;
+        snap.lastPuffDurationMs = (uint32_t)currPuff->puffDuration;
+        snap.lastPuffPhaseIndex = currPuff->phaseIndex;
+    }
+    PersistenceManager& pm = PersistenceManager::instance();
+    for (uint8_t ch = 0; ch < CHANNEL_COUNT; ++ch) snap.cursors[ch] = pm.getCursor(ch);
+    snap.rollups = Rollups::instance().state();
+    snap.crc32 = pm.computeCrc(&snap, sizeof(snap) - sizeof(uint32_t));
+    s_resume = snap;
+    Logger::info("[StateMachine] Resume snapshot saved.");
+}
 
-    // Rebuild puff list from storage
-    puffs.clear();
-    PersistenceManager::instance().forEachPuff([this](const PersistenceManager::PuffRecord& rec){
-        PuffModel pm; pm.puffNumber = rec.puffNumber; pm.phaseIndex = rec.phaseIndex; pm.puffDuration = rec.durationMs; pm.timestampSec = rec.tSec; puffs.push_back(pm); });
-    if (!puffs.empty()) { currPuff = &puffs.back(); }
+bool StateMachine::restoreResumeSnapshot() {
+    // RTC memory only holds a meaningful snapshot after a deep-sleep wake
+    if (esp_sleep_get_wakeup_cause() == ESP_SLEEP_WAKEUP_UNDEFINED) return false;
+    ResumeSnapshot snap = s_resume;
+    s_resume.magic = 0; // single use; a fresh one is written before the next sleep
+    if (snap.magic != RESUME_MAGIC || snap.version != RESUME_VERSION) return false;
+    PersistenceManager& pm = PersistenceManager::instance();
+    if (pm.computeCrc(&snap, sizeof(snap) - sizeof(uint32_t)) != snap.crc32) {
+        Logger::warning("[StateMachine] Resume snapshot CRC mismatch; falling back to storage.");
+        return false;
+    }
+    if (!PhaseSchedule::program().hasPhase(snap.phaseIndex)) return false;
 
+    phase = PhaseSchedule::program().phaseAt(snap.phaseIndex);
+    currPhase = &phase;
+    currPhase->phaseStartSec = snap.phaseStartSec;
+    currPhase->maxPuffs = snap.maxPuffs;
+    currPhase->puffsTaken = snap.puffsTaken;
+    if (snap.hasLastPuff) {
+        lastPuff.puffNumber = snap.lastPuffNumber;
+        lastPuff.timestampSec = snap.lastPuffSec;
+        lastPuff.puffDuration = snap.lastPuffDurationMs;
+        lastPuff.phaseIndex = snap.lastPuffPhaseIndex;
+        currPuff = &lastPuff;
+    }
+    enterState((snap.state == LOCKDOWN) ? LOCKDOWN : PUFF_COUNTING);
+    pm.restoreCursors(snap.cursors);
+    Rollups::instance().restore(snap.rollups);
+    return true;
+}
+
+// --- Reconstruction from storage ---
+bool StateMachine::applyPhaseRecord(uint16_t phaseIndex, uint32_t startSec, uint16_t maxPuffs, uint16_t puffsTaken) {
+    const PhaseSchedule& schedule = PhaseSchedule::program();
+    if (!schedule.hasPhase(phaseIndex)) return false;
+    phase = schedule.phaseAt(phaseIndex);
+    phase.phaseStartSec = startSec;
+    phase.maxPuffs = maxPuffs;
+    phase.puffsTaken = puffsTaken;
+    currPhase = &phase;
+    return true;
+}
+
+void StateMachine::settleReconstructedState(bool loadedAny) {
     // If nothing was loaded at all, keep constructor-initialized defaults
-    if (!loadedAnyPhase && puffs.empty()) {
-        currentState = PUFF_COUNTING;
+    if (!loadedAny) {
+        enterState(PUFF_COUNTING);
         Logger::infof("[StateMachine] No persisted data. Using defaults. Current Phase: %d, Current Puff: %d", currPhase->phaseIndex, currPuff ? currPuff->puffNumber : 0);
         return;
     }
 
     // Determine current state
-    int idx = currPhase->phaseIndex;
-    currentState = (phases[idx].puffsTaken >= phases[idx].maxPuffs) ? LOCKDOWN : PUFF_COUNTING;
+    enterState((currPhase->puffsTaken >= currPhase->maxPuffs) ? LOCKDOWN : PUFF_COUNTING);
     Logger::infof("[StateMachine] Reconstruction complete. Current Phase: %d, Current Puff: %d", currPhase->phaseIndex, currPuff ? currPuff->puffNumber : 0);
-}
\ No newline at end of file
+}
+
+void StateMachine::reconstructFromStorage() {
+    PersistenceManager& pm = PersistenceManager::instance();
+    pm.init();
+    bool loadedAny = false;
+    uint32_t puffFrom = 0;
+    uint32_t phaseFrom = 0;
+    uint32_t rollupFrom = 0;
+    Rollups& rollups = Rollups::instance();
+    rollups.reset();
+
+    // Start from the last checkpoint so only the journal tail is replayed
+    PersistenceManager::CheckpointRecord cp;
+    if (pm.loadCheckpoint(cp) && applyPhaseRecord(cp.phaseIndex, cp.phaseStartSec, cp.maxPuffs, cp.puffsTaken)) {
+        currPuff = nullptr;
+        if (cp.hasLastPuff) {
+            lastPuff = puffFromRecord(cp.lastPuff);
+            currPuff = &lastPuff;
+        }
+        puffFrom = cp.puffRecordsCovered;
+        phaseFrom = cp.phaseRecordsCovered;
+        rollups.restore(cp.rollups);
+        rollupFrom = cp.rollupRecordsCovered;
+        loadedAny = true;
+        Logger::infof("[StateMachine] Checkpoint loaded (puffs=%u, phases=%u).", (unsigned)puffFrom, (unsigned)phaseFrom);
+    }
+
+    // The newest phase record is updated in place (puffsTaken), so always re-read it
+    uint32_t phaseTotal = pm.getCursor(PHASE_CH).totalRecords;
+    if (phaseTotal > 0 && phaseFrom >= phaseTotal) phaseFrom = phaseTotal - 1;
+    bool phaseFromRecord = false;
+    pm.forEachPhase([this, &loadedAny, &phaseFromRecord](const PersistenceManager::PhaseRecord& rec){
+        if (applyPhaseRecord(rec.phaseIndex, rec.startSec, rec.maxPuffs, rec.puffsTaken)) loadedAny = phaseFromRecord = true;
+    }, phaseFrom);
+
+    requireCurrPhase();
+
+    // Rollups closed after the checkpoint are already stored; replay must not close them again
+    rollups.syncClosed(rollupFrom);
+
+    // Only the newest puff is needed for the live state; history is served from storage
+    PuffModel last{};
+    bool haveTail = false;
+    int tailInPhase = 0;
+    const int phaseIdx = currPhase->phaseIndex;
+    pm.forEachPuff([&last, &haveTail, &tailInPhase, &rollups, phaseIdx](const PersistenceManager::PuffRecord& rec){
+        last = puffFromRecord(rec);
+        haveTail = true;
+        if (rec.phaseIndex == phaseIdx) tailInPhase++;
+        rollups.onPuff(rec.tSec, rec.durationMs, rec.phaseIndex, true);
+    }, puffFrom);
+    // A phase record carries its own puffsTaken; a phase known only from the checkpoint
+    // (phase 0 has no record) counts the puffs written after the checkpoint
+    if (!phaseFromRecord) currPhase->puffsTaken += tailInPhase;
+    if (haveTail) {
+        lastPuff = last;
+        currPuff = &lastPuff;
+        loadedAny = true;
+    }
+
+    settleReconstructedState(loadedAny);
+}
+
+void StateMachine::writeCheckpoint() {
+    requireCurrPhase();
+    PersistenceManager& pm = PersistenceManager::instance();
+    PersistenceManager::CheckpointRecord cp;
+    memset(&cp, 0, sizeof(cp));
+    cp.phaseIndex = (uint16_t)currPhase->phaseIndex;
+    cp.phaseStartSec = currPhase->phaseStartSec;
+    cp.maxPuffs = (uint16_t)currPhase->maxPuffs;
+    cp.puffsTaken = (uint16_t)currPhase->puffsTaken;
+    cp.state = (uint8_t)currentState;
+    if (currPuff) {
+        cp.hasLastPuff = 1;
+        cp.lastPuff.tSec = currPuff->timestampSec;
+        cp.lastPuff.durationMs = (uint32_t)currPuff->puffDuration;
+        cp.lastPuff.puffNumber = (uint32_t)currPuff->puffNumber;
+        cp.lastPuff.phaseIndex = (uint16_t)currPuff->phaseIndex;
+    }
+    cp.puffRecordsCovered = pm.getCursor(PUFF_CH).totalRecords;
+    cp.phaseRecordsCovered = pm.getCursor(PHASE_CH).totalRecords;
+    cp.rollups = Rollups::instance().state();
+    cp.rollupRecordsCovered = pm.getCursor(ROLLUP_CH).totalRecords;
+    pm.saveCheckpoint(cp);
+}
@@ -13,7 +13,9 @@
 // --- Standard Library Includes ---
 #include <Arduino.h>
 #include <cstdint>
-#include <vector>
+
+// --- Project Includes ---
+#include "Timebase.h"
 
 // -----------------------------------------------------------------------------
 // State Machine Constants
@@ -25,7 +27,7 @@
 #define MAX_PUFFS                         20            ///< Maximum puffs per phase
 #endif
 #ifndef NUM_PHASES
-#define NUM_PHASES                        5             ///< Number of phases
+#define NUM_PHASES                        5             ///< Last phase index (0 = open-ended program, see PhaseSchedule)
 #endif
 // Minimum puff duration (in milliseconds). Set to 0 for tests; recommended >= 1000 in production.
 #ifndef MIN_PUFF_DURATION_MILLISECONDS
@@ -73,6 +75,11 @@ struct PhaseModel {
     int puffsTaken;             ///< Puffs taken in phase
 };
 
+/**
+ * @brief Called from inside the transition that changes the state, before any persistence.
+ */
+using StateListener = void (*)(state_t state);
+
 // -----------------------------------------------------------------------------
 // StateMachine Class
 // -----------------------------------------------------------------------------
@@ -86,24 +93,69 @@ public:
     // Singleton
     static StateMachine& instance();
 
-    // State transitions
-    void handle_state_rising();
-    void handle_state_falling();
-    void incrementValidPhase();
+    // State transitions; now is the loop iteration's Timebase sample
+    void handle_state_rising(const Timebase::Now& now);
+    void handle_state_falling(const Timebase::Now& now);
+    void incrementValidPhase(const Timebase::Now& now);
 
     // Puff/Phase Access
-    const PuffModel* getAllPuffs() const { return puffs.data(); }
-    const PhaseModel* getAllPhases() const { return phases.data(); }
-    size_t getPuffsCount() const { return puffs.size(); }
-    size_t getPhasesCount() const { return phases.size(); }
     state_t getCurrentState() const { return currentState; }
 
+    /**
+     * @brief Register the output driven by the state (the coil); called once now with the current state.
+     */
+    void setStateListener(StateListener listener);
+
+    /**
+     * @brief Seconds remaining until the current phase may advance.
+     * @return 0 if the boundary has already passed, UINT32_MAX if no further phase exists.
+     */
+    uint32_t secondsUntilNextPhase() const;
+
+    /**
+     * @brief True between a rising edge and the falling edge that persists the puff.
+     */
+    bool puffInProgress() const { return hasPendingPuff; }
+
     // Reconstruction
+    /**
+     * @brief Initialize the live state as after a reset: fast resume from the RTC snapshot on a
+     * deep-sleep wake, else defaults plus reconstructFromStorage(). Run by the constructor; the
+     * host simulator runs it again for each simulated reset.
+     */
+    void boot();
+
+    /**
+     * @brief Rebuild the live state (current phase, last puff, state) from the last
+     * checkpoint plus the journal records written after it.
+     */
     void reconstructFromStorage();
 
-    // BLEManager API helpers
-    std::vector<PuffModel> getPuffs(uint16_t startAfter, uint8_t maxCount) const;
-    std::vector<PhaseModel> getPhases(uint16_t startAfter, uint8_t maxCount) const;
+    // Fast resume across deep sleep
+    /**
+     * @brief Store current phase, last puff, state and persistence cursors in RTC memory.
+     * Call immediately before esp_deep_sleep_start().
+     */
+    void saveResumeSnapshot();
+
+    // BLEManager API helpers (history is read into caller buffers; nothing is allocated)
+    /**
+     * @brief Copy up to maxCount puffs with puffNumber > startAfter from storage into out.
+     * @return Number of puffs copied.
+     */
+    size_t getPuffs(uint32_t startAfter, PuffModel* out, size_t maxCount);
+    /**
+     * @brief Copy up to maxCount puffs with fromSec <= timestamp < toSec and puffNumber > startAfter into out.
+     * The first match is found by binary search, so only the requested range is read.
+     * @return Number of puffs copied.
+     */
+    size_t getPuffsInRange(uint32_t fromSec, uint32_t toSec, uint32_t startAfter, PuffModel* out, size_t maxCount);
+    /**
+     * @brief Copy up to maxCount phases with startAfter < phaseIndex <= current into out.
+     * Past phases are read from the persisted phase records; durations come from the PhaseSchedule.
+     * @return Number of phases copied.
+     */
+    size_t getPhases(uint16_t startAfter, PhaseModel* out, size_t maxCount);
     bool hasCurrentPuff() const { return currPuff != nullptr; }
     PuffModel currentPuff() const { return currPuff ? *currPuff : PuffModel{}; }
     bool hasCurrentPhase() const { return currPhase != nullptr; }
@@ -114,13 +166,13 @@ private:
     class PuffTimer {
     public:
         PuffTimer();
-        void start();
-        // Returns elapsed seconds since start. If not started returns -1.
-        long getDuration() const;
+        void start(uint64_t monoUs);
+        // Returns elapsed milliseconds on the monotonic clock. If not started returns -1.
+        long getDuration(uint64_t monoUs) const;
         void reset();
 
     private:
-        unsigned long startTime;
+        uint64_t startUs;
         bool active;
     };
     PuffTimer puffTimer;
@@ -128,10 +180,11 @@ private:
     // Internal state
     StateMachine();
     ~StateMachine();
-    std::vector<PhaseModel> phases;
-    std::vector<PuffModel> puffs;
-    int getPuffNumber() const { return static_cast<int>(puffs.size()) + 1; }
+    PhaseModel phase;           // current phase, materialized from the PhaseSchedule; currPhase points here
+    PuffModel lastPuff;         // newest puff; currPuff points here once one exists
+    int getPuffNumber() const { return (currPuff ? currPuff->puffNumber : 0) + 1; }
     state_t currentState;
+    StateListener stateListener = nullptr;
     // Internal current pointers (not exposed directly)
     PuffModel* currPuff;
     PhaseModel* currPhase;
@@ -139,4 +192,9 @@ private:
     bool hasPendingPuff = false;
 
     void requireCurrPhase();
+    void enterState(state_t next);
+    bool restoreResumeSnapshot();
+    void writeCheckpoint();
+    void settleReconstructedState(bool loadedAny);
+    bool applyPhaseRecord(uint16_t phaseIndex, uint32_t startSec, uint16_t maxPuffs, uint16_t puffsTaken);
 };
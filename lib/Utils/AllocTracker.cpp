@@ -0,0 +1,116 @@
+#include "AllocTracker.h"
+#include "Logger.h"
+#include <freertos/FreeRTOS.h>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+
+// Counters live at file scope so the allocator wrappers never run a static initializer
+static AllocTracker::Stats s_allocStats[ALLOC_MODULE_COUNT];
+static portMUX_TYPE s_allocMux = portMUX_INITIALIZER_UNLOCKED;
+
+#if ALLOC_TRACKING
+// Module of the innermost Scope on the calling task
+static __thread uint8_t s_allocModule = ALLOC_OTHER;
+
+static void alloc_count(size_t bytes) {
+    portENTER_CRITICAL(&s_allocMux);
+    AllocTracker::Stats& s = s_allocStats[s_allocModule];
+    s.allocs++;
+    s.bytes += (uint32_t)bytes;
+    portEXIT_CRITICAL(&s_allocMux);
+}
+
+static void free_count() {
+    portENTER_CRITICAL(&s_allocMux);
+    s_allocStats[s_allocModule].frees++;
+    portEXIT_CRITICAL(&s_allocMux);
+}
+
+// -----------------------------------------------------------------------------
+// Allocator Wrappers (-Wl,--wrap=...)
+// -----------------------------------------------------------------------------
+
+extern "C" {
+void* __real_malloc(size_t size);
+void __real_free(void* ptr);
+void* __real_calloc(size_t n, size_t size);
+void* __real_realloc(void* ptr, size_t size);
+
+void* __wrap_malloc(size_t size) {
+    alloc_count(size);
+    return __real_malloc(size);
+}
+
+void __wrap_free(void* ptr) {
+    if (ptr) free_count();
+    __real_free(ptr);
+}
+
+void* __wrap_calloc(size_t n, size_t size) {
+    alloc_count(n * size);
+    return __real_calloc(n, size);
+}
+
+void* __wrap_realloc(void* ptr, size_t size) {
+    alloc_count(size);
+    return __real_realloc(ptr, size);
+}
+}
+
+// operator new lives in the prebuilt C++ runtime, which --wrap does not reach; route it through malloc
+void* operator new(size_t size) {
+    void* p = malloc(size ? size : 1);
+    if (!p) abort();
+    return p;
+}
+void* operator new[](size_t size) { return operator new(size); }
+void* operator new(size_t size, const std::nothrow_t&) noexcept { return malloc(size ? size : 1); }
+void* operator new[](size_t size, const std::nothrow_t&) noexcept { return malloc(size ? size : 1); }
+void operator delete(void* p) noexcept { free(p); }
+void operator delete[](void* p) noexcept { free(p); }
+void operator delete(void* p, size_t) noexcept { free(p); }
+void operator delete[](void* p, size_t) noexcept { free(p); }
+
+AllocTracker::Scope::Scope(AllocModule m) : prev(s_allocModule) { s_allocModule = m; }
+AllocTracker::Scope::~Scope() { s_allocModule = prev; }
+#endif
+
+// -----------------------------------------------------------------------------
+// AllocTracker Method Implementations
+// -----------------------------------------------------------------------------
+
+AllocTracker& AllocTracker::instance() { static AllocTracker inst; return inst; }
+
+AllocTracker::Stats AllocTracker::stats(AllocModule m) const {
+    Stats s{};
+    if (m >= ALLOC_MODULE_COUNT) return s;
+    portENTER_CRITICAL(&s_allocMux);
+    s = s_allocStats[m];
+    portEXIT_CRITICAL(&s_allocMux);
+    return s;
+}
+
+uint32_t AllocTracker::totalAllocs() const {
+    uint32_t total = 0;
+    for (uint8_t m = 0; m < ALLOC_MODULE_COUNT; ++m) {
+        if (m != ALLOC_HOST) total += stats((AllocModule)m).allocs;
+    }
+    return total;
+}
+
+void AllocTracker::reset() {
+    portENTER_CRITICAL(&s_allocMux);
+    memset(s_allocStats, 0, sizeof(s_allocStats));
+    portEXIT_CRITICAL(&s_allocMux);
+}
+
+void AllocTracker::logReport() const {
+    if (!enabled()) return;
+    static const char* const names[ALLOC_MODULE_COUNT] = { "other", "app", "state", "persistence", "logger", "ble", "host" };
+    for (uint8_t m = 0; m < ALLOC_MODULE_COUNT; ++m) {
+        Stats s = stats((AllocModule)m);
+        if (s.allocs == 0 && s.frees == 0) continue;
+        Logger::infof("[Alloc] %s: %u allocs, %u frees, %u bytes", names[m], (unsigned)s.allocs, (unsigned)s.frees, (unsigned)s.bytes);
+    }
+}
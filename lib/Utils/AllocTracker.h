@@ -0,0 +1,108 @@
+#pragma once
+
+/**
+ * @file AllocTracker.h
+ * @brief Optional per-module heap allocation counters (build with ALLOC_TRACKING=1).
+ *
+ * The tracking build links with -Wl,--wrap=malloc,--wrap=free,--wrap=calloc,--wrap=realloc
+ * (see [env:vetra-alloc]) and replaces operator new/delete, so every allocation made by
+ * firmware code is counted against the module of the innermost AllocTracker::Scope. Without
+ * ALLOC_TRACKING the scopes compile to nothing and no allocator is wrapped.
+ *
+ * @author Vetra Firmware Team
+ * @copyright Copyright (c) 2025 Vetra
+ */
+
+// --- Standard Library Includes ---
+#include <Arduino.h>
+#include <cstdint>
+
+// -----------------------------------------------------------------------------
+// Allocation Tracking Constants
+// -----------------------------------------------------------------------------
+
+#ifndef ALLOC_TRACKING
+#define ALLOC_TRACKING                    0
+#endif
+
+/**
+ * @enum AllocModule
+ * @brief Modules allocations are attributed to.
+ */
+enum AllocModule : uint8_t {
+    ALLOC_OTHER,         ///< Outside any scope (framework, BLE stack tasks, boot)
+    ALLOC_APP,           ///< App::loop
+    ALLOC_STATE,         ///< State machine handlers
+    ALLOC_PERSISTENCE,   ///< PersistenceManager and record channels
+    ALLOC_LOGGER,        ///< Logger and LogBuffer
+    ALLOC_BLE,           ///< BLE characteristic callbacks and notifications
+    ALLOC_HOST,          ///< Host models (NVS simulation); never counted against the firmware
+    ALLOC_MODULE_COUNT
+};
+
+// -----------------------------------------------------------------------------
+// AllocTracker Class
+// -----------------------------------------------------------------------------
+
+/**
+ * @class AllocTracker
+ * @brief Singleton reporting the allocation counters; all zero unless ALLOC_TRACKING is set.
+ */
+class AllocTracker {
+public:
+    struct Stats {
+        uint32_t allocs;     ///< malloc/calloc/realloc/new calls
+        uint32_t frees;      ///< free/delete calls with a non-null pointer
+        uint32_t bytes;      ///< Bytes requested (cumulative)
+    };
+
+    /**
+     * @brief Get singleton instance of AllocTracker.
+     */
+    static AllocTracker& instance();
+
+    /**
+     * @brief True if this build counts allocations.
+     */
+    static constexpr bool enabled() { return ALLOC_TRACKING != 0; }
+
+    /**
+     * @brief Counters of one module since boot or the last reset().
+     */
+    Stats stats(AllocModule m) const;
+
+    /**
+     * @brief Allocations across all modules except ALLOC_HOST.
+     */
+    uint32_t totalAllocs() const;
+
+    /**
+     * @brief Zero all counters.
+     */
+    void reset();
+
+    /**
+     * @brief Log one line per module with allocations (no-op when disabled).
+     */
+    void logReport() const;
+
+    /**
+     * @brief RAII helper attributing allocations in a scope to a module (nests; per task).
+     */
+    class Scope {
+    public:
+#if ALLOC_TRACKING
+        explicit Scope(AllocModule m);
+        ~Scope();
+    private:
+        uint8_t prev;
+#else
+        explicit Scope(AllocModule) {}
+#endif
+    };
+
+private:
+    AllocTracker() = default;
+    AllocTracker(const AllocTracker&) = delete;
+    AllocTracker& operator=(const AllocTracker&) = delete;
+};
@@ -0,0 +1,116 @@
+#include "BootProfiler.h"
+#include <esp_timer.h>
+
+// -----------------------------------------------------------------------------
+// RTC-Retained Profile Ring
+// -----------------------------------------------------------------------------
+
+static constexpr uint32_t STAGE_UNSET = 0xFFFFFFFF;
+static constexpr uint32_t PROFILE_RING_MAGIC = 0x42505246; // 'BPRF'
+
+struct BootProfileEntry {
+    uint16_t seq;
+    uint16_t fwVersion;
+    uint8_t wakeCause;
+    uint8_t bleReason;
+    uint32_t startUs[BOOT_STAGE_COUNT];
+    uint32_t durationUs[BOOT_STAGE_COUNT];
+};
+
+struct BootProfileRing {
+    uint32_t magic;
+    uint16_t nextSeq;
+    uint8_t head;   // slot of the current profile
+    uint8_t count;  // valid slots
+    BootProfileEntry entries[BOOT_PROFILE_HISTORY];
+};
+
+static RTC_DATA_ATTR BootProfileRing s_ring;
+static bool s_open = false;
+
+static inline uint32_t nowUs() { return (uint32_t)esp_timer_get_time(); }
+
+static inline void putLE16(uint8_t* b, uint16_t v) { b[0] = v & 0xFF; b[1] = (v >> 8) & 0xFF; }
+static inline void putLE32(uint8_t* b, uint32_t v) { b[0] = v & 0xFF; b[1] = (v >> 8) & 0xFF; b[2] = (v >> 16) & 0xFF; b[3] = (v >> 24) & 0xFF; }
+
+// -----------------------------------------------------------------------------
+// BootProfiler Method Implementations
+// -----------------------------------------------------------------------------
+
+BootProfiler& BootProfiler::instance() { static BootProfiler inst; return inst; }
+
+void BootProfiler::begin(uint8_t wakeCause) {
+    if (s_ring.magic != PROFILE_RING_MAGIC) {
+        memset(&s_ring, 0, sizeof(s_ring));
+        s_ring.magic = PROFILE_RING_MAGIC;
+        s_ring.head = BOOT_PROFILE_HISTORY - 1;
+    }
+    s_ring.head = (uint8_t)((s_ring.head + 1) % BOOT_PROFILE_HISTORY);
+    if (s_ring.count < BOOT_PROFILE_HISTORY) s_ring.count++;
+    BootProfileEntry& e = s_ring.entries[s_ring.head];
+    e.seq = s_ring.nextSeq++;
+    e.fwVersion = FIRMWARE_VERSION;
+    e.wakeCause = wakeCause;
+    e.bleReason = 0;
+    for (uint8_t i = 0; i < BOOT_STAGE_COUNT; ++i) { e.startUs[i] = STAGE_UNSET; e.durationUs[i] = 0; }
+    s_open = true;
+}
+
+void BootProfiler::stageBegin(BootStage stage) {
+    if (!s_open || stage >= BOOT_STAGE_COUNT) return;
+    BootProfileEntry& e = s_ring.entries[s_ring.head];
+    if (e.startUs[stage] != STAGE_UNSET) return; // first occurrence wins
+    e.startUs[stage] = nowUs();
+}
+
+void BootProfiler::stageEnd(BootStage stage) {
+    if (!s_open || stage >= BOOT_STAGE_COUNT) return;
+    BootProfileEntry& e = s_ring.entries[s_ring.head];
+    if (e.startUs[stage] == STAGE_UNSET || e.durationUs[stage] != 0) return;
+    uint32_t d = nowUs() - e.startUs[stage];
+    e.durationUs[stage] = d ? d : 1;
+}
+
+void BootProfiler::mark(BootStage stage) {
+    if (!s_open || stage >= BOOT_STAGE_COUNT) return;
+    BootProfileEntry& e = s_ring.entries[s_ring.head];
+    if (e.startUs[stage] == STAGE_UNSET) e.startUs[stage] = nowUs();
+}
+
+void BootProfiler::accumulate(BootStage stage, uint32_t startUs, uint32_t durationUs) {
+    if (!s_open || stage >= BOOT_STAGE_COUNT) return;
+    BootProfileEntry& e = s_ring.entries[s_ring.head];
+    if (e.startUs[stage] == STAGE_UNSET) e.startUs[stage] = startUs;
+    e.durationUs[stage] += durationUs;
+}
+
+void BootProfiler::setBleReason(uint8_t reason) {
+    if (!s_open) return;
+    s_ring.entries[s_ring.head].bleReason = reason;
+}
+
+size_t BootProfiler::serialize(uint8_t* out, size_t cap) const {
+    uint8_t count = (s_ring.magic == PROFILE_RING_MAGIC) ? s_ring.count : 0;
+    size_t need = 3 + (size_t)count * (6 + BOOT_STAGE_COUNT * 8);
+    if (!out || cap < need) return 0;
+    out[0] = BOOT_PROFILE_FORMAT_VERSION;
+    out[1] = BOOT_STAGE_COUNT;
+    out[2] = count;
+    size_t idx = 3;
+    for (uint8_t n = 0; n < count; ++n) {
+        // Oldest first: walk forward from the slot after head
+        uint8_t slot = (uint8_t)((s_ring.head + BOOT_PROFILE_HISTORY - count + 1 + n) % BOOT_PROFILE_HISTORY);
+        const BootProfileEntry& e = s_ring.entries[slot];
+        putLE16(&out[idx], e.seq);
+        putLE16(&out[idx + 2], e.fwVersion);
+        out[idx + 4] = e.wakeCause;
+        out[idx + 5] = e.bleReason;
+        idx += 6;
+        for (uint8_t i = 0; i < BOOT_STAGE_COUNT; ++i) {
+            putLE32(&out[idx], e.startUs[i]);
+            putLE32(&out[idx + 4], e.durationUs[i]);
+            idx += 8;
+        }
+    }
+    return idx;
+}
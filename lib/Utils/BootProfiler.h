@@ -0,0 +1,129 @@
+#pragma once
+
+/**
+ * @file BootProfiler.h
+ * @brief Microsecond timing of boot/wake stages, retained across deep sleep.
+ *
+ * Keeps the last BOOT_PROFILE_HISTORY profiles in RTC memory and serializes them for the
+ * BLE diagnostics characteristic (decode with tools/boot_profile.py).
+ *
+ * @author Vetra Firmware Team
+ * @copyright Copyright (c) 2025 Vetra
+ */
+
+// --- Standard Library Includes ---
+#include <Arduino.h>
+#include <cstdint>
+
+// -----------------------------------------------------------------------------
+// Boot Profiler Constants
+// -----------------------------------------------------------------------------
+
+/// @name Boot Profiler Constants
+///@{
+#ifndef FIRMWARE_VERSION
+#define FIRMWARE_VERSION 0x0100       ///< Firmware version tag stored with each profile (major.minor)
+#endif
+static constexpr uint8_t BOOT_PROFILE_HISTORY = 4;        ///< Profiles retained in RTC memory
+static constexpr uint8_t BOOT_PROFILE_FORMAT_VERSION = 2; ///< Wire format version of serialize()
+///@}
+
+/**
+ * @enum BootStage
+ * @brief Timed stages of setup/wake, in wire order.
+ */
+enum BootStage : uint8_t {
+    BOOT_NVS_INIT,          ///< nvs_flash_init
+    BOOT_LOAD_META,         ///< PersistenceManager::loadMeta
+    BOOT_FIRST_WRITE_LOAD,  ///< First active-block load (ChannelStore::loadActive), on the first write of the
+                            ///< wake; after an RTC resume this is usually well after BOOT_COIL_READY
+    BOOT_RECONSTRUCT,       ///< StateMachine snapshot restore / reconstructFromStorage
+    BOOT_BLE_INIT,          ///< BLEDevice::init
+    BOOT_SERVICE_CREATE,    ///< Server, service and characteristic creation
+    BOOT_FIRST_ADVERTISE,   ///< BLEDevice::startAdvertising
+    BOOT_COIL_READY,        ///< Coil state applied (point event)
+    BOOT_RADIO_ON,          ///< BLE radio up: first start, total on-time this wake (accumulated)
+    BOOT_STAGE_COUNT
+};
+
+// -----------------------------------------------------------------------------
+// BootProfiler Class
+// -----------------------------------------------------------------------------
+
+/**
+ * @class BootProfiler
+ * @brief Singleton recording per-stage start offset and duration (microseconds since reset).
+ *
+ * Each stage is recorded once per boot (first occurrence wins).
+ */
+class BootProfiler {
+public:
+    /**
+     * @brief Get singleton instance of BootProfiler.
+     */
+    static BootProfiler& instance();
+
+    /**
+     * @brief Open a new profile in the RTC ring (call first thing in setup).
+     * @param wakeCause esp_sleep_wakeup_cause_t of this boot.
+     */
+    void begin(uint8_t wakeCause);
+
+    /**
+     * @brief Mark the start of a stage.
+     */
+    void stageBegin(BootStage stage);
+
+    /**
+     * @brief Mark the end of a stage.
+     */
+    void stageEnd(BootStage stage);
+
+    /**
+     * @brief Record a zero-length stage at the current time.
+     */
+    void mark(BootStage stage);
+
+    /**
+     * @brief Add one interval to a recurring stage (start stays at the first interval).
+     */
+    void accumulate(BootStage stage, uint32_t startUs, uint32_t durationUs);
+
+    /**
+     * @brief Store why BLE was started this wake (BleStartReason, 0 = not started).
+     */
+    void setBleReason(uint8_t reason);
+
+    /**
+     * @brief Serialize retained profiles (oldest first, little-endian).
+     *
+     * Layout: [format(1)][stageCount(1)][profileCount(1)] then per profile
+     * [seq(2)][fwVersion(2)][wakeCause(1)][bleReason(1)] + stageCount x [startUs(4)][durationUs(4)].
+     * A stage never reached has startUs = 0xFFFFFFFF.
+     * @return Bytes written (0 if out is too small).
+     */
+    size_t serialize(uint8_t* out, size_t cap) const;
+
+    /**
+     * @brief Size in bytes of a full serialize() output.
+     */
+    static constexpr size_t serializedMax() {
+        return 3 + BOOT_PROFILE_HISTORY * (6 + BOOT_STAGE_COUNT * 8);
+    }
+
+    /**
+     * @brief RAII helper timing a stage over a scope.
+     */
+    class Scope {
+    public:
+        explicit Scope(BootStage s) : stage(s) { BootProfiler::instance().stageBegin(stage); }
+        ~Scope() { BootProfiler::instance().stageEnd(stage); }
+    private:
+        BootStage stage;
+    };
+
+private:
+    BootProfiler() = default;
+    BootProfiler(const BootProfiler&) = delete;
+    BootProfiler& operator=(const BootProfiler&) = delete;
+};
@@ -0,0 +1,82 @@
+#include "ClockDrift.h"
+#include "Logger.h"
+#include "PersistenceManager.h"
+
+static constexpr uint32_t DRIFT_RTC_MAGIC = 0x44524654; // 'DRFT'
+
+// Sleep readings since the last sync; lost on power-on, when the RTC time is lost too
+struct DriftReadings {
+    uint32_t magic;          ///< Set at a sync; absent until the first sync after power-on
+    uint32_t sleepEpoch;     ///< RTC-derived time at the last deep sleep entry (0 = none pending)
+    uint32_t sleptSec;       ///< Deep sleep accumulated since the last sync
+};
+static RTC_DATA_ATTR DriftReadings s_readings;
+
+ClockDrift& ClockDrift::instance() { static ClockDrift inst; return inst; }
+
+void ClockDrift::begin() {
+    PersistenceManager::ClockState st;
+    if (!PersistenceManager::instance().loadClockState(st)) return;
+    driftPpm = st.driftPpm;
+    samples = st.samples;
+}
+
+int32_t ClockDrift::correctionSec(uint32_t sleptSec, int32_t ppm) {
+    int64_t scaled = (int64_t)sleptSec * ppm;
+    return (int32_t)((scaled + (scaled >= 0 ? 500000 : -500000)) / 1000000);
+}
+
+bool ClockDrift::usableSample(int32_t errorSec, uint32_t sleptSec) {
+    if (sleptSec < DRIFT_MIN_SLEEP_SEC) return false;
+    int64_t residual = (int64_t)errorSec * 1000000 / sleptSec;
+    return residual <= DRIFT_MAX_PPM && residual >= -DRIFT_MAX_PPM;
+}
+
+int32_t ClockDrift::updatedPpm(int32_t ppm, uint16_t samples, int32_t errorSec, uint32_t sleptSec) {
+    if (sleptSec == 0) return ppm;
+    int64_t residual = (int64_t)errorSec * 1000000 / sleptSec;
+    // The residual is what the current estimate missed; later samples move it halfway
+    int64_t next = ppm + (samples == 0 ? residual : residual / 2);
+    if (next > DRIFT_MAX_PPM) next = DRIFT_MAX_PPM;
+    if (next < -DRIFT_MAX_PPM) next = -DRIFT_MAX_PPM;
+    return (int32_t)next;
+}
+
+void ClockDrift::onSleep(uint32_t rtcEpoch) {
+    if (s_readings.magic != DRIFT_RTC_MAGIC) return;
+    s_readings.sleepEpoch = rtcEpoch;
+}
+
+int32_t ClockDrift::onWake(uint32_t rtcEpoch) {
+    if (s_readings.magic != DRIFT_RTC_MAGIC || s_readings.sleepEpoch == 0) return 0;
+    uint32_t slept = rtcEpoch > s_readings.sleepEpoch ? rtcEpoch - s_readings.sleepEpoch : 0;
+    s_readings.sleepEpoch = 0;
+    s_readings.sleptSec += slept;
+    int32_t correction = correctionSec(slept, driftPpm);
+    if (correction != 0) {
+        Logger::infof("[ClockDrift] Slept %u s; correcting %d s at %d ppm", (unsigned)slept, (int)correction, (int)driftPpm);
+    }
+    return correction;
+}
+
+void ClockDrift::onSync(uint32_t rtcEpoch, uint32_t syncedEpoch) {
+    int32_t errorSec = (int32_t)(syncedEpoch - rtcEpoch);
+    // Readings from before a power-on describe a clock that was lost, not drift
+    uint32_t slept = (s_readings.magic == DRIFT_RTC_MAGIC) ? s_readings.sleptSec : 0;
+    if (usableSample(errorSec, slept)) {
+        driftPpm = updatedPpm(driftPpm, samples, errorSec, slept);
+        if (samples < UINT16_MAX) samples++;
+        PersistenceManager::ClockState st{};
+        st.driftPpm = driftPpm;
+        st.samples = samples;
+        st.syncEpoch = syncedEpoch;
+        st.errorSec = errorSec;
+        st.sleptSec = slept;
+        PersistenceManager::instance().saveClockState(st);
+        Logger::infof("[ClockDrift] Error %d s over %u s asleep; estimate %d ppm (%u samples)",
+                      (int)errorSec, (unsigned)slept, (int)driftPpm, (unsigned)samples);
+    }
+    s_readings.magic = DRIFT_RTC_MAGIC;
+    s_readings.sleepEpoch = 0;
+    s_readings.sleptSec = 0;
+}
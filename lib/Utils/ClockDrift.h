@@ -0,0 +1,102 @@
+#pragma once
+
+/**
+ * @file ClockDrift.h
+ * @brief Estimates the RTC rate error across deep sleep and corrects the restored time on wake.
+ *
+ * While awake the wall clock runs on the crystal; in deep sleep it runs on the RTC slow clock,
+ * which drifts. Each deep sleep adds (wake reading - sleep reading) to the sleep time since the
+ * last time sync. When the phone writes the time, the error it reveals divided by that sleep
+ * time is the residual drift rate, folded into the persisted estimate. Every deep-sleep wake then
+ * adds slept x rate to the RTC-derived time before anything reads it.
+ *
+ * @author Vetra Firmware Team
+ * @copyright Copyright (c) 2025 Vetra
+ */
+
+// --- Standard Library Includes ---
+#include <Arduino.h>
+#include <cstdint>
+
+// -----------------------------------------------------------------------------
+// Clock Drift Constants
+// -----------------------------------------------------------------------------
+
+/// @name Drift Estimation
+///@{
+// Deep sleep since the last sync needed before a correction counts as a drift sample
+#ifndef DRIFT_MIN_SLEEP_SEC
+#define DRIFT_MIN_SLEEP_SEC               3600
+#endif
+// Largest plausible rate error; larger samples (clock set by hand, lost RTC) are ignored
+#ifndef DRIFT_MAX_PPM
+#define DRIFT_MAX_PPM                     50000
+#endif
+///@}
+
+// -----------------------------------------------------------------------------
+// ClockDrift Class
+// -----------------------------------------------------------------------------
+
+/**
+ * @class ClockDrift
+ * @brief Singleton keeping the sleep readings in RTC memory and the rate estimate in NVS.
+ */
+class ClockDrift {
+public:
+    /**
+     * @brief Get singleton instance of ClockDrift.
+     */
+    static ClockDrift& instance();
+
+    /**
+     * @brief Load the persisted estimate (after PersistenceManager::init()).
+     */
+    void begin();
+
+    /**
+     * @brief Record the RTC-derived time at deep sleep entry.
+     */
+    void onSleep(uint32_t rtcEpoch);
+
+    /**
+     * @brief Account the sleep that just ended.
+     * @return Seconds to add to the RTC-derived time (0 after a power-on or without an estimate).
+     */
+    int32_t onWake(uint32_t rtcEpoch);
+
+    /**
+     * @brief A time sync: sample the drift since the previous one and restart the sleep count.
+     * @param rtcEpoch Wall clock before the sync (RTC-derived, already corrected on wake).
+     * @param syncedEpoch Time written by the client.
+     */
+    void onSync(uint32_t rtcEpoch, uint32_t syncedEpoch);
+
+    /**
+     * @brief Current rate estimate (positive = RTC runs slow).
+     */
+    int32_t ppm() const { return driftPpm; }
+
+    /**
+     * @brief Correction for sleptSec of deep sleep at rate ppm, rounded to the nearest second.
+     */
+    static int32_t correctionSec(uint32_t sleptSec, int32_t ppm);
+
+    /**
+     * @brief True if an error observed over sleptSec of deep sleep is long enough and plausible.
+     */
+    static bool usableSample(int32_t errorSec, uint32_t sleptSec);
+
+    /**
+     * @brief Fold a usable residual error observed over sleptSec into the estimate.
+     */
+    static int32_t updatedPpm(int32_t ppm, uint16_t samples, int32_t errorSec, uint32_t sleptSec);
+
+private:
+    ClockDrift() = default;
+    ClockDrift(const ClockDrift&) = delete;
+    ClockDrift& operator=(const ClockDrift&) = delete;
+
+    int32_t driftPpm = 0;
+    uint16_t samples = 0;
+};
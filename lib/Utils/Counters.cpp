@@ -0,0 +1,44 @@
+#include "Counters.h"
+#include "LogBuffer.h"
+#include <esp_system.h>
+#include <freertos/FreeRTOS.h>
+
+static portMUX_TYPE s_countersMux = portMUX_INITIALIZER_UNLOCKED;
+// File scope (zeroed .bss) so the ISR path never runs the flash-resident instance() guard
+static volatile uint32_t s_values[CNT_STORED_COUNT];
+
+static inline void putLE32(uint8_t* b, uint32_t v) { b[0] = v & 0xFF; b[1] = (v >> 8) & 0xFF; b[2] = (v >> 16) & 0xFF; b[3] = (v >> 24) & 0xFF; }
+
+Counters& Counters::instance() { static Counters inst; return inst; }
+
+Counters::Counters() = default;
+
+void Counters::add(CounterId id, uint32_t n) {
+    if (id >= CNT_STORED_COUNT) return;
+    portENTER_CRITICAL(&s_countersMux);
+    s_values[id] += n;
+    portEXIT_CRITICAL(&s_countersMux);
+}
+
+void IRAM_ATTR Counters::addFromIsr(CounterId id, uint32_t n) {
+    if (id >= CNT_STORED_COUNT) return;
+    portENTER_CRITICAL_ISR(&s_countersMux);
+    s_values[id] += n;
+    portEXIT_CRITICAL_ISR(&s_countersMux);
+}
+
+uint32_t Counters::get(CounterId id) const {
+    return (id < CNT_STORED_COUNT) ? s_values[id] : 0;
+}
+
+size_t Counters::serialize(uint8_t* out, size_t cap) const {
+    if (!out || cap < serializedSize()) return 0;
+    out[0] = COUNTERS_FORMAT_VERSION;
+    out[1] = CNT_STORED_COUNT + COUNTERS_DERIVED;
+    size_t idx = 2;
+    for (uint8_t i = 0; i < CNT_STORED_COUNT; ++i, idx += 4) putLE32(&out[idx], s_values[i]);
+    putLE32(&out[idx], LogBuffer::instance().dropped()); idx += 4;
+    putLE32(&out[idx], esp_get_free_heap_size()); idx += 4;
+    putLE32(&out[idx], esp_get_minimum_free_heap_size()); idx += 4;
+    return idx;
+}
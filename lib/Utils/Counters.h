@@ -0,0 +1,100 @@
+#pragma once
+
+/**
+ * @file Counters.h
+ * @brief Always-on device counters (flash writes, notifications, drops, edges, heap).
+ *
+ * Served as one fixed-size frame by the BLE counters characteristic (COUNTERS_CHAR_UUID).
+ *
+ * @author Vetra Firmware Team
+ * @copyright Copyright (c) 2025 Vetra
+ */
+
+// --- Standard Library Includes ---
+#include <Arduino.h>
+#include <cstdint>
+
+// -----------------------------------------------------------------------------
+// Counter Identifiers
+// -----------------------------------------------------------------------------
+
+/// @brief Wire format version of Counters::serialize()
+static constexpr uint8_t COUNTERS_FORMAT_VERSION = 1;
+
+/**
+ * @enum CounterId
+ * @brief Counters in wire order. Each *_NOTIFY id is immediately followed by its *_INDICATE id.
+ */
+enum CounterId : uint8_t {
+    CNT_NVS_BYTES_PUFF,      ///< Bytes handed to nvs_set_blob for the puff channel
+    CNT_NVS_BYTES_PHASE,     ///< Bytes handed to nvs_set_blob for the phase channel
+    CNT_NVS_BYTES_META,      ///< Bytes for meta, checkpoint and epoch keys
+    CNT_NVS_COMMITS,         ///< nvs_commit calls
+    CNT_BLOCK_ROTATIONS,     ///< Persistence block rotations
+    CNT_PUFFS_NOTIFY,        ///< Puffs characteristic notifications
+    CNT_PUFFS_INDICATE,      ///< Puffs characteristic indications
+    CNT_PHASES_NOTIFY,       ///< Phases characteristic notifications
+    CNT_PHASES_INDICATE,     ///< Phases characteristic indications
+    CNT_LOGGER_NOTIFY,       ///< Logger characteristic notifications
+    CNT_LOGGER_INDICATE,     ///< Logger characteristic indications
+    CNT_EDGES_RAW,           ///< HEAT_PIN interrupts (before debounce)
+    CNT_EDGES_DEBOUNCED,     ///< Rising/falling events delivered to the state machine
+    CNT_PUFFS_INVALID,       ///< Puffs rejected for duration
+    CNT_NVS_BYTES_ROLLUP,    ///< Bytes handed to nvs_set_blob for the rollup channel
+    CNT_BLOCKS_RECYCLED,     ///< Stored blocks overwritten by the ring before compaction reclaimed them
+    CNT_PUFFS_UNSYNCED_LOST, ///< Puffs the client never acknowledged, overwritten by the ring
+    CNT_STORED_COUNT,        ///< Number of stored counters (derived values follow on the wire)
+};
+
+/// @brief Values appended after the stored counters in serialize(): log drops, heap free, heap min-free
+static constexpr uint8_t COUNTERS_DERIVED = 3;
+
+// -----------------------------------------------------------------------------
+// Counters Class
+// -----------------------------------------------------------------------------
+
+/**
+ * @class Counters
+ * @brief Singleton of monotonically increasing 32-bit counters (wrap on overflow).
+ */
+class Counters {
+public:
+    /**
+     * @brief Get singleton instance of Counters.
+     */
+    static Counters& instance();
+
+    /**
+     * @brief Add to a counter from task context.
+     */
+    void add(CounterId id, uint32_t n = 1);
+
+    /**
+     * @brief Add to a counter from an ISR (IRAM-safe; does not go through instance()).
+     */
+    static void addFromIsr(CounterId id, uint32_t n = 1);
+
+    /**
+     * @brief Current value of a stored counter.
+     */
+    uint32_t get(CounterId id) const;
+
+    /**
+     * @brief Serialize counters (little-endian).
+     *
+     * Layout: [format(1)][valueCount(1)] + valueCount x [u32]: the stored counters in CounterId
+     * order, then log lines dropped, heap free bytes, heap minimum-free bytes.
+     * @return Bytes written (0 if out is too small).
+     */
+    size_t serialize(uint8_t* out, size_t cap) const;
+
+    /**
+     * @brief Size in bytes of serialize() output.
+     */
+    static constexpr size_t serializedSize() { return 2 + (CNT_STORED_COUNT + COUNTERS_DERIVED) * 4; }
+
+private:
+    Counters();
+    Counters(const Counters&) = delete;
+    Counters& operator=(const Counters&) = delete;
+};
@@ -0,0 +1,62 @@
+#include "EnergyModel.h"
+#include "Logger.h"
+#include <esp_timer.h>
+
+// Estimated charge across deep sleep (reset on power-on)
+struct EnergyTotals {
+    uint32_t wakes;
+    uint32_t awakeMs;
+    uint64_t chargeUc;
+};
+static RTC_DATA_ATTR EnergyTotals s_energy;
+
+EnergyModel& EnergyModel::instance() { static EnergyModel inst; return inst; }
+
+void EnergyModel::addWait(uint32_t us) {
+    waitUs += us;
+}
+
+void EnergyModel::addLightSleep(uint32_t us) {
+    lightSleepUs += us;
+}
+
+void EnergyModel::reset() {
+    waitUs = 0;
+    lightSleepUs = 0;
+}
+
+uint32_t EnergyModel::chargeUc(uint32_t activeMs, uint32_t idleMs, uint32_t lightSleepMs, uint32_t radioMs) {
+    uint64_t uaMs = (uint64_t)activeMs * ENERGY_ACTIVE_UA + (uint64_t)idleMs * ENERGY_IDLE_UA
+                  + (uint64_t)lightSleepMs * ENERGY_LIGHT_SLEEP_UA + (uint64_t)radioMs * ENERGY_RADIO_UA;
+    uint64_t uc = uaMs / 1000;
+    return uc > UINT32_MAX ? UINT32_MAX : (uint32_t)uc;
+}
+
+EnergyModel::Estimate EnergyModel::estimate(uint32_t awakeMs, uint32_t radioMs) const {
+    Estimate e{};
+    e.awakeMs = awakeMs;
+    uint32_t blockedMs = (uint32_t)(waitUs / 1000);
+    uint32_t sleptMs = (uint32_t)(lightSleepUs / 1000);
+    // Clamp so rounding never makes the split exceed the wake
+    if (sleptMs > awakeMs) sleptMs = awakeMs;
+    if (blockedMs > awakeMs - sleptMs) blockedMs = awakeMs - sleptMs;
+    e.lightSleepMs = sleptMs + (autoLightSleep ? blockedMs : 0);
+    e.idleMs = autoLightSleep ? 0 : blockedMs;
+    e.activeMs = awakeMs - sleptMs - blockedMs;
+    e.radioMs = radioMs < awakeMs ? radioMs : awakeMs;
+    e.chargeUc = chargeUc(e.activeMs, e.idleMs, e.lightSleepMs, e.radioMs);
+    e.averageUa = awakeMs ? (uint32_t)((uint64_t)e.chargeUc * 1000 / awakeMs) : 0;
+    return e;
+}
+
+void EnergyModel::logReport(uint32_t radioMs) {
+    Estimate e = estimate((uint32_t)(esp_timer_get_time() / 1000), radioMs);
+    s_energy.wakes++;
+    s_energy.awakeMs += e.awakeMs;
+    s_energy.chargeUc += e.chargeUc;
+    Logger::infof("[Energy] Wake %u ms: active %u, idle %u, light sleep %u, radio %u ms; ~%u uC, avg %u uA (auto light sleep %s)",
+                  (unsigned)e.awakeMs, (unsigned)e.activeMs, (unsigned)e.idleMs, (unsigned)e.lightSleepMs, (unsigned)e.radioMs,
+                  (unsigned)e.chargeUc, (unsigned)e.averageUa, autoLightSleep ? "on" : "off");
+    Logger::infof("[Energy] ~%u mC over %u wakes (%u s awake) since power-on",
+                  (unsigned)(s_energy.chargeUc / 1000), (unsigned)s_energy.wakes, (unsigned)(s_energy.awakeMs / 1000));
+}
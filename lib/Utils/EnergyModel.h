@@ -0,0 +1,115 @@
+#pragma once
+
+/**
+ * @file EnergyModel.h
+ * @brief Per-wake charge estimate from the time spent in each power state.
+ *
+ * The loop reports how long it blocked waiting for events and how long it light slept; the rest
+ * of the wake counts as CPU active. Blocked time costs light-sleep current when esp_pm automatic
+ * light sleep is running and idle current otherwise; radio-on time adds an average BLE current.
+ * The currents are datasheet-level figures, good for comparing builds rather than for billing.
+ *
+ * @author Vetra Firmware Team
+ * @copyright Copyright (c) 2025 Vetra
+ */
+
+// --- Standard Library Includes ---
+#include <Arduino.h>
+#include <cstdint>
+
+// -----------------------------------------------------------------------------
+// Energy Model Constants
+// -----------------------------------------------------------------------------
+
+/// @name Supply Currents (uA)
+///@{
+// CPU running at full clock, radio off
+#ifndef ENERGY_ACTIVE_UA
+#define ENERGY_ACTIVE_UA                  23000
+#endif
+// CPU idle in the FreeRTOS idle task at the low clock (no light sleep)
+#ifndef ENERGY_IDLE_UA
+#define ENERGY_IDLE_UA                    8000
+#endif
+// Light sleep with the main XTAL kept as the BLE sleep clock
+#ifndef ENERGY_LIGHT_SLEEP_UA
+#define ENERGY_LIGHT_SLEEP_UA             300
+#endif
+// Average added while the BLE controller is up (advertising or connection events)
+#ifndef ENERGY_RADIO_UA
+#define ENERGY_RADIO_UA                   2500
+#endif
+///@}
+
+// -----------------------------------------------------------------------------
+// EnergyModel Class
+// -----------------------------------------------------------------------------
+
+/**
+ * @class EnergyModel
+ * @brief Singleton accumulating blocked and light-sleep time for the current wake.
+ */
+class EnergyModel {
+public:
+    /**
+     * @brief Time split of one wake and its estimated charge.
+     */
+    struct Estimate {
+        uint32_t awakeMs;            ///< Boot to now
+        uint32_t activeMs;           ///< CPU running
+        uint32_t idleMs;             ///< Blocked without light sleep
+        uint32_t lightSleepMs;       ///< Blocked under automatic light sleep plus explicit light sleep
+        uint32_t radioMs;            ///< BLE controller up
+        uint32_t chargeUc;           ///< Estimated charge drawn (uC = uA x s)
+        uint32_t averageUa;          ///< chargeUc / awake time
+    };
+
+    /**
+     * @brief Get singleton instance of EnergyModel.
+     */
+    static EnergyModel& instance();
+
+    /**
+     * @brief Whether blocked time is spent in automatic light sleep (esp_pm configured for it).
+     */
+    void setAutoLightSleep(bool enabled) { autoLightSleep = enabled; }
+
+    /**
+     * @brief Account time the loop blocked waiting for an event or timeout.
+     */
+    void addWait(uint32_t us);
+
+    /**
+     * @brief Account an explicit esp_light_sleep_start().
+     */
+    void addLightSleep(uint32_t us);
+
+    /**
+     * @brief Estimate for a wake of awakeMs with the radio up for radioMs.
+     */
+    Estimate estimate(uint32_t awakeMs, uint32_t radioMs) const;
+
+    /**
+     * @brief Estimate from the state currents alone (no accumulated time), for tests and tools.
+     */
+    static uint32_t chargeUc(uint32_t activeMs, uint32_t idleMs, uint32_t lightSleepMs, uint32_t radioMs);
+
+    /**
+     * @brief Log the estimate of this wake and the running totals kept across deep sleep.
+     */
+    void logReport(uint32_t radioMs);
+
+    /**
+     * @brief Forget the time accumulated this wake.
+     */
+    void reset();
+
+private:
+    EnergyModel() = default;
+    EnergyModel(const EnergyModel&) = delete;
+    EnergyModel& operator=(const EnergyModel&) = delete;
+
+    bool autoLightSleep = false;
+    uint64_t waitUs = 0;
+    uint64_t lightSleepUs = 0;
+};
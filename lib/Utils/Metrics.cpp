@@ -0,0 +1,88 @@
+#include "Metrics.h"
+#include <freertos/FreeRTOS.h>
+
+static portMUX_TYPE s_metricsMux = portMUX_INITIALIZER_UNLOCKED;
+
+static inline void putLE32(uint8_t* b, uint32_t v) { b[0] = v & 0xFF; b[1] = (v >> 8) & 0xFF; b[2] = (v >> 16) & 0xFF; b[3] = (v >> 24) & 0xFF; }
+
+Metrics& Metrics::instance() { static Metrics inst; return inst; }
+
+Metrics::Metrics() { memset(hist, 0, sizeof(hist)); }
+
+uint8_t Metrics::bucketFor(uint32_t us) {
+    if (us < (1u << METRIC_FIRST_BUCKET_LOG2)) return 0;
+    uint8_t log2 = (uint8_t)(31 - __builtin_clz(us));
+    uint8_t b = (uint8_t)(log2 - METRIC_FIRST_BUCKET_LOG2 + 1);
+    return (b >= METRIC_BUCKETS) ? (METRIC_BUCKETS - 1) : b;
+}
+
+uint32_t Metrics::bucketUpperUs(uint8_t bucket) {
+    if (bucket >= METRIC_BUCKETS - 1) return UINT32_MAX;
+    return 1u << (bucket + METRIC_FIRST_BUCKET_LOG2);
+}
+
+void Metrics::record(MetricId id, uint32_t us) {
+    if (id >= METRIC_COUNT) return;
+    uint8_t b = bucketFor(us);
+    portENTER_CRITICAL(&s_metricsMux);
+    Histogram& h = hist[id];
+    h.count++;
+    if (us > h.maxUs) h.maxUs = us;
+    h.buckets[b]++;
+    portEXIT_CRITICAL(&s_metricsMux);
+}
+
+void Metrics::reset() {
+    portENTER_CRITICAL(&s_metricsMux);
+    memset(hist, 0, sizeof(hist));
+    portEXIT_CRITICAL(&s_metricsMux);
+}
+
+uint32_t Metrics::percentileUs(MetricId id, uint8_t pct) const {
+    if (id >= METRIC_COUNT) return 0;
+    Histogram h;
+    portENTER_CRITICAL(&s_metricsMux);
+    h = hist[id];
+    portEXIT_CRITICAL(&s_metricsMux);
+    return percentileOf(h, pct);
+}
+
+uint32_t Metrics::percentileOf(const Histogram& h, uint8_t pct) {
+    if (h.count == 0) return 0;
+    // Rank of the sample at this percentile (ceil), 1-based
+    uint32_t rank = (uint32_t)(((uint64_t)h.count * pct + 99) / 100);
+    if (rank == 0) rank = 1;
+    uint32_t seen = 0;
+    for (uint8_t b = 0; b < METRIC_BUCKETS; ++b) {
+        seen += h.buckets[b];
+        if (seen >= rank) {
+            uint32_t upper = bucketUpperUs(b);
+            return (upper < h.maxUs) ? upper : h.maxUs;
+        }
+    }
+    return h.maxUs;
+}
+
+size_t Metrics::serialize(uint8_t* out, size_t cap) const {
+    if (!out || cap < serializedSize()) return 0;
+    Histogram copy[METRIC_COUNT];
+    portENTER_CRITICAL(&s_metricsMux);
+    memcpy(copy, hist, sizeof(copy));
+    portEXIT_CRITICAL(&s_metricsMux);
+    out[0] = METRICS_FORMAT_VERSION;
+    out[1] = METRIC_COUNT;
+    out[2] = METRIC_BUCKETS;
+    size_t idx = 3;
+    for (uint8_t m = 0; m < METRIC_COUNT; ++m) {
+        putLE32(&out[idx], copy[m].count);
+        putLE32(&out[idx + 4], copy[m].maxUs);
+        putLE32(&out[idx + 8], percentileOf(copy[m], 50));
+        putLE32(&out[idx + 12], percentileOf(copy[m], 99));
+        idx += 16;
+        for (uint8_t b = 0; b < METRIC_BUCKETS; ++b) {
+            putLE32(&out[idx], copy[m].buckets[b]);
+            idx += 4;
+        }
+    }
+    return idx;
+}
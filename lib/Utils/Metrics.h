@@ -0,0 +1,126 @@
+#pragma once
+
+/**
+ * @file Metrics.h
+ * @brief Fixed-bucket latency histograms for hot paths (no heap).
+ *
+ * Each metric keeps a log2 histogram of microsecond samples plus count and max. Snapshots are
+ * served over BLE (METRICS_CHAR_UUID) and decoded with tools/metrics.py.
+ *
+ * @author Vetra Firmware Team
+ * @copyright Copyright (c) 2025 Vetra
+ */
+
+// --- Standard Library Includes ---
+#include <Arduino.h>
+#include <cstdint>
+
+// --- ESP32 Includes ---
+#include <esp_timer.h>
+
+// -----------------------------------------------------------------------------
+// Metrics Constants
+// -----------------------------------------------------------------------------
+
+/// @name Histogram Layout
+///@{
+static constexpr uint8_t METRIC_BUCKETS = 16;          ///< Buckets per histogram
+static constexpr uint8_t METRIC_FIRST_BUCKET_LOG2 = 3; ///< Bucket 0 is [0, 8) us; bucket i is [2^(i+2), 2^(i+3)) us; last is open-ended
+static constexpr uint8_t METRICS_FORMAT_VERSION = 1;   ///< Wire format version of serialize()
+///@}
+
+/**
+ * @enum MetricId
+ * @brief Measured paths, in wire order.
+ */
+enum MetricId : uint8_t {
+    METRIC_ISR_TO_HANDLER,   ///< HEAT_PIN rising ISR to handle_state_rising
+    METRIC_PUFF_FALLING,     ///< handle_state_falling including persistence
+    METRIC_NVS_COMMIT,       ///< Each nvs_commit
+    METRIC_LOOP_ITERATION,   ///< App::loop work (excluding the idle delay)
+    METRIC_PUFFS_REQUEST,    ///< Puffs request write to notify/indicate
+    METRIC_PHASES_REQUEST,   ///< Phases request write to notify/indicate
+    METRIC_COUNT
+};
+
+// -----------------------------------------------------------------------------
+// Metrics Class
+// -----------------------------------------------------------------------------
+
+/**
+ * @class Metrics
+ * @brief Singleton holding one histogram per MetricId. Safe to record from any task.
+ */
+class Metrics {
+public:
+    /**
+     * @brief Get singleton instance of Metrics.
+     */
+    static Metrics& instance();
+
+    /**
+     * @brief Current time for latency measurements (microseconds since boot).
+     */
+    static inline uint32_t nowUs() { return (uint32_t)esp_timer_get_time(); }
+
+    /**
+     * @brief Record one sample.
+     * @param id Metric to update.
+     * @param us Sample in microseconds.
+     */
+    void record(MetricId id, uint32_t us);
+
+    /**
+     * @brief Clear all histograms.
+     */
+    void reset();
+
+    /**
+     * @brief Upper bound (us) of the bucket holding the given percentile.
+     * @param pct Percentile 1..100.
+     * @return 0 if no samples.
+     */
+    uint32_t percentileUs(MetricId id, uint8_t pct) const;
+
+    /**
+     * @brief Serialize all histograms (little-endian).
+     *
+     * Layout: [format(1)][metricCount(1)][bucketCount(1)] then per metric
+     * [count(4)][maxUs(4)][p50Us(4)][p99Us(4)] + bucketCount x [bucket(4)].
+     * @return Bytes written (0 if out is too small).
+     */
+    size_t serialize(uint8_t* out, size_t cap) const;
+
+    /**
+     * @brief Size in bytes of serialize() output.
+     */
+    static constexpr size_t serializedSize() { return 3 + METRIC_COUNT * (16 + METRIC_BUCKETS * 4); }
+
+    /**
+     * @brief RAII helper recording the duration of a scope.
+     */
+    class Scope {
+    public:
+        explicit Scope(MetricId m) : id(m), startUs(Metrics::nowUs()) {}
+        ~Scope() { Metrics::instance().record(id, Metrics::nowUs() - startUs); }
+    private:
+        MetricId id;
+        uint32_t startUs;
+    };
+
+private:
+    Metrics();
+    Metrics(const Metrics&) = delete;
+    Metrics& operator=(const Metrics&) = delete;
+
+    struct Histogram {
+        uint32_t count;
+        uint32_t maxUs;
+        uint32_t buckets[METRIC_BUCKETS];
+    };
+    Histogram hist[METRIC_COUNT];
+
+    static uint8_t bucketFor(uint32_t us);
+    static uint32_t bucketUpperUs(uint8_t bucket);
+    static uint32_t percentileOf(const Histogram& h, uint8_t pct);
+};
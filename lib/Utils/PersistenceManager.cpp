@@ -1,6 +1,14 @@
 // PersistenceManager.cpp
 #include "PersistenceManager.h"
 #include "Timer.h"
+#include "BootProfiler.h"
+#include "Metrics.h"
+#include "Counters.h"
+#include "AllocTracker.h"
+#include <cstddef>
+#include <cstring>
+#include <algorithm>
+#include <new>
 
 static uint32_t pm_crc32_update(uint32_t crc, const uint8_t* data, size_t len) {
     crc = ~crc;
@@ -14,208 +22,521 @@ static uint32_t pm_crc32_update(uint32_t crc, const uint8_t* data, size_t len) {
     return ~crc;
 }
 
+// -----------------------------------------------------------------------------
+// Wear Accounting
+// -----------------------------------------------------------------------------
+
+static constexpr uint32_t WEAR_MAGIC = 0x57454152; // 'WEAR'
+static RTC_DATA_ATTR uint32_t s_wearMagic;
+static RTC_DATA_ATTR PersistenceManager::WearStats s_wear;
+
+// A blob is one data chunk (header entry + payload entries) plus one blob-index entry.
+static inline uint32_t pm_blob_entries(size_t len) { return 2 + (uint32_t)((len + NVS_ENTRY_BYTES - 1) / NVS_ENTRY_BYTES); }
+
+static void pm_account_nvs(size_t len, uint32_t entries) {
+    s_wear.nvsBytes += (uint32_t)len;
+    s_wear.entriesWritten += entries;
+}
+
+static nvs_handle_t s_nvsHandle;
+static bool s_nvsOpen = false;
+
+bool pm_nvs(nvs_handle_t* out) {
+    if (!s_nvsOpen) s_nvsOpen = nvs_open(NAMESPACE, NVS_READWRITE, &s_nvsHandle) == ESP_OK;
+    *out = s_nvsHandle;
+    return s_nvsOpen;
+}
+
+esp_err_t pm_commit(nvs_handle_t h) {
+    Metrics::Scope m(METRIC_NVS_COMMIT);
+    Counters::instance().add(CNT_NVS_COMMITS);
+    return nvs_commit(h);
+}
+
+esp_err_t pm_set_blob(nvs_handle_t h, const char* key, const void* data, size_t len, CounterId bytesCounter) {
+    Counters::instance().add(bytesCounter, (uint32_t)len);
+    pm_account_nvs(len, pm_blob_entries(len));
+    return nvs_set_blob(h, key, data, len);
+}
+
+// -----------------------------------------------------------------------------
+// Storage v1 Layouts (16-bit block and puff numbers; read once, when migrating)
+// -----------------------------------------------------------------------------
+
+static constexpr uint32_t CHANNEL_META_MAGIC_V1 = 0x504D4348; // 'PMCH'
+static constexpr uint16_t CHANNEL_COUNT_V1 = 2;               // Puff and phase channels
+static constexpr uint32_t SYNC_MAGIC = 0x50535932;            // 'PSY2'
+static constexpr uint32_t CLOCK_MAGIC = 0x50434C4B;           // 'PCLK'
+
+struct ChannelMetaV1 {
+    uint32_t magic;
+    uint16_t recordSize;
+    uint16_t blockCapacity;
+    uint16_t activeBlockIndex;
+    uint16_t activeCount;
+    uint32_t totalRecords;
+} __attribute__((packed));
+
+struct PuffRecordV1 {
+    uint32_t tSec;
+    uint32_t durationMs;
+    uint16_t puffNumber;
+    uint16_t phaseIndex;
+} __attribute__((packed));
+
+// Puff n is record n-1, so the record index restores the high bits v1 dropped
+static void pm_convert_puff_v1(const uint8_t* legacy, uint8_t* out, uint32_t recordIndex) {
+    PuffRecordV1 v1;
+    memcpy(&v1, legacy, sizeof(v1));
+    PersistenceManager::PuffRecord r;
+    r.tSec = v1.tSec;
+    r.durationMs = v1.durationMs;
+    r.puffNumber = ((recordIndex + 1) & 0xFFFF0000u) | v1.puffNumber;
+    r.phaseIndex = v1.phaseIndex;
+    memcpy(out, &r, sizeof(r));
+}
+
+// Blobs end with a CRC-32 over everything before it
+static bool pm_blob_crc_ok(const uint8_t* raw, size_t sz) {
+    uint32_t stored;
+    memcpy(&stored, raw + sz - sizeof(uint32_t), sizeof(stored));
+    return pm_crc32_update(0, raw, sz - sizeof(uint32_t)) == stored;
+}
+
 PersistenceManager& PersistenceManager::instance() { static PersistenceManager inst; return inst; }
 
-PersistenceManager::PersistenceManager(): metaLoaded(false), puffBlockLoaded(false), phaseBlockLoaded(false) {
+PersistenceManager::PersistenceManager()
+    : metaLoaded(false), nvsReady(false), syncLoaded(false), puffCh(CNT_NVS_BYTES_PUFF), phaseCh(CNT_NVS_BYTES_PHASE),
+      rollupCh(CNT_NVS_BYTES_ROLLUP), channels{&puffCh, &phaseCh, &rollupCh} {
     memset(&meta, 0, sizeof(meta));
-    memset(puffBlock, 0, sizeof(puffBlock));
-    memset(phaseBlock, 0, sizeof(phaseBlock));
+    for (uint8_t ch = 0; ch < CHANNEL_COUNT; ++ch) channels[ch]->bind(&meta.channels[ch]);
+    puffCh.setLegacyFormat(sizeof(PuffRecordV1), pm_convert_puff_v1);
+    if (s_wearMagic != WEAR_MAGIC) resetWearStats();
+}
+
+#ifdef HOST_SIM
+void PersistenceManager::hostReset() {
+    PersistenceManager& pm = instance();
+    pm.~PersistenceManager();
+    new (&pm) PersistenceManager();
+    s_nvsOpen = false;
 }
+#endif
 
 void PersistenceManager::init() { ensureInit(); }
 
 uint32_t PersistenceManager::computeCrc(const void* d, size_t len) const { return pm_crc32_update(0, (const uint8_t*)d, len); }
 
-void PersistenceManager::ensureInit() {
-    if (metaLoaded) return;
+void PersistenceManager::ensureNvs() {
+    if (nvsReady) return;
+    BootProfiler::Scope prof(BOOT_NVS_INIT);
     esp_err_t err = nvs_flash_init();
     if (err == ESP_ERR_NVS_NO_FREE_PAGES || err == ESP_ERR_NVS_NEW_VERSION_FOUND) {
         Logger::info("[Persistence] Erasing NVS for re-init");
         nvs_flash_erase();
         nvs_flash_init();
     }
-    loadMeta();
-    loadActiveBlock(PUFF_CH);
-    loadActiveBlock(PHASE_CH);
+    nvsReady = true;
+}
+
+void PersistenceManager::ensureInit() {
+    if (nvsReady && metaLoaded && syncLoaded) return;
+    ensureNvs();
+    if (!metaLoaded) {
+        BootProfiler::Scope prof(BOOT_LOAD_META);
+        loadMeta();
+    }
+    if (!syncLoaded) loadSync();
+}
+
+void PersistenceManager::ensureActiveBlock(ChannelStore& ch) {
+    if (!ch.isLoaded()) ch.loadActive();
+}
+
+void PersistenceManager::rotateIfFull(ChannelStore& ch) {
+    if (!ch.isFull()) return;
+    // Recording never stops for a client that is behind: the oldest puff block goes, and the puffs in it
+    // that were never acknowledged are counted and reported through the logger characteristic
+    uint32_t recycled = (&ch == &puffCh) ? ch.blockRecycledByRotate() : UINT32_MAX;
+    if (recycled != UINT32_MAX && sync.ackedPuffs < (recycled + 1) * PUFF_BLOCK_CAP) {
+        uint32_t lost = (recycled + 1) * PUFF_BLOCK_CAP - std::max<uint32_t>(sync.ackedPuffs, recycled * PUFF_BLOCK_CAP);
+        Counters::instance().add(CNT_PUFFS_UNSYNCED_LOST, lost);
+        Logger::warningf("[Persistence] Puff ring full; %u unacknowledged puffs in block %u overwritten",
+                         (unsigned)lost, (unsigned)recycled);
+    }
+    ch.rotate();
+    saveMeta();
+}
+
+PersistenceManager::ChannelCursor PersistenceManager::getCursor(uint8_t ch) const {
+    const ChannelMeta& cm = channels[ch]->meta();
+    return ChannelCursor{cm.activeBlockIndex, cm.activeCount, cm.totalRecords};
+}
+
+void PersistenceManager::restoreCursors(const ChannelCursor* cursors) {
+    // Meta read from NVS is saved on every append, so it is at least as current as the snapshot
+    if (metaLoaded) {
+        Logger::info("[Persistence] Meta already loaded; snapshot cursors ignored");
+        return;
+    }
+    initDefaultMeta();
+    for (uint8_t ch = 0; ch < CHANNEL_COUNT; ++ch) {
+        ChannelMeta& cm = channels[ch]->meta();
+        cm.activeBlockIndex = cursors[ch].activeBlockIndex;
+        cm.activeCount = cursors[ch].activeCount;
+        cm.totalRecords = cursors[ch].totalRecords;
+        channels[ch]->invalidate();
+    }
+    // The compaction cursor and kept v1 range are not part of the snapshot; keep them if the sync blob is already read
+    if (syncLoaded) {
+        puffCh.setFirstBlock(sync.puffFirstBlock);
+        puffCh.setLegacyEnd(sync.puffLegacyEnd);
+    }
+    meta.crc32 = computeCrc(&meta, sizeof(meta) - sizeof(uint32_t));
+    metaLoaded = true;
+    Logger::info("[Persistence] Cursors restored from snapshot");
+}
+
+void PersistenceManager::initDefaultMeta() {
+    memset(&meta, 0, sizeof(meta));
+    meta.magic = 0x504D5441; // 'PMTA'
+    meta.version = 2;
+    meta.channelCount = CHANNEL_COUNT;
+    for (uint8_t ch = 0; ch < CHANNEL_COUNT; ++ch) channels[ch]->resetMeta();
 }
 
 void PersistenceManager::loadMeta() {
-    nvs_handle_t h; if (nvs_open(NAMESPACE, NVS_READWRITE, &h) != ESP_OK) { return; }
-    size_t sz = sizeof(meta);
-    esp_err_t err = nvs_get_blob(h, "meta", &meta, &sz);
-    bool reinit = (err != ESP_OK || sz != sizeof(meta) || meta.magic != 0x504D5441 /* 'PMTA' */ || meta.channelCount != CHANNEL_COUNT);
-    if (!reinit) {
-        uint32_t crc = computeCrc(&meta, sizeof(meta) - sizeof(uint32_t));
-        if (crc != meta.crc32) reinit = true;
+    nvs_handle_t h; if (!pm_nvs(&h)) { return; }
+    // Read through a raw buffer: v1 meta is shorter
+    uint8_t raw[sizeof(GlobalMeta)];
+    size_t sz = sizeof(raw);
+    esp_err_t err = nvs_get_blob(h, "meta", raw, &sz);
+    memcpy(&meta, raw, sizeof(meta));
+    bool reinit = (err != ESP_OK || meta.magic != 0x504D5441 /* 'PMTA' */);
+    bool migrated = false;
+    if (!reinit && meta.version == 1) {
+        reinit = !migrateV1(h, raw, sz);
+        migrated = !reinit;
+    } else if (!reinit) {
+        reinit = (meta.version != 2 || meta.channelCount != CHANNEL_COUNT || sz != sizeof(meta)
+                  || meta.crc32 != computeCrc(&meta, sizeof(meta) - sizeof(uint32_t)));
+    }
+    // Active blocks live in fixed-size buffers; a layout change invalidates the stored channels
+    for (uint8_t ch = 0; !reinit && ch < CHANNEL_COUNT; ++ch) {
+        if (!channels[ch]->metaMatches()) reinit = true;
     }
-    if (reinit) {
-        memset(&meta, 0, sizeof(meta));
-        meta.magic = 0x504D5441; // 'PMTA'
-        meta.version = 1;
-        meta.channelCount = CHANNEL_COUNT;
-        // Channel 0 puffs
-        meta.channels[PUFF_CH].magic = 0x504D4348; // 'PMCH'
-        meta.channels[PUFF_CH].recordSize = sizeof(PuffRecord);
-        meta.channels[PUFF_CH].blockCapacity = PUFF_BLOCK_CAP;
-        meta.channels[PUFF_CH].activeBlockIndex = 0;
-        meta.channels[PUFF_CH].activeCount = 0;
-        meta.channels[PUFF_CH].totalRecords = 0;
-        // Channel 1 phases
-        meta.channels[PHASE_CH].magic = 0x504D4348;
-        meta.channels[PHASE_CH].recordSize = sizeof(PhaseRecord);
-        meta.channels[PHASE_CH].blockCapacity = PHASE_BLOCK_CAP;
-        meta.channels[PHASE_CH].activeBlockIndex = 0;
-        meta.channels[PHASE_CH].activeCount = 0;
-        meta.channels[PHASE_CH].totalRecords = 0;
+    if (reinit || migrated) {
+        if (reinit) initDefaultMeta();
         meta.crc32 = computeCrc(&meta, sizeof(meta) - sizeof(uint32_t));
-        nvs_set_blob(h, "meta", &meta, sizeof(meta));
-        nvs_commit(h);
-        Logger::info("[Persistence] Meta initialized");
+        pm_set_blob(h, "meta", &meta, sizeof(meta), CNT_NVS_BYTES_META);
+        pm_commit(h);
+        Logger::info(reinit ? "[Persistence] Meta initialized" : "[Persistence] Storage migrated from v1");
     } else {
         Logger::info("[Persistence] Meta loaded");
     }
-    nvs_close(h);
     metaLoaded = true;
 }
 
+bool PersistenceManager::migrateV1(nvs_handle_t h, const uint8_t* raw, size_t sz) {
+    uint16_t storedChannels;
+    memcpy(&storedChannels, raw + offsetof(GlobalMeta, channelCount), sizeof(storedChannels));
+    if (storedChannels != CHANNEL_COUNT_V1
+        || sz != offsetof(GlobalMeta, channels) + CHANNEL_COUNT_V1 * sizeof(ChannelMetaV1) + sizeof(uint32_t)) return false;
+    if (!pm_blob_crc_ok(raw, sz)) return false;
+
+    initDefaultMeta();
+    for (uint8_t ch = 0; ch < CHANNEL_COUNT_V1; ++ch) {
+        ChannelMetaV1 lm;
+        memcpy(&lm, raw + offsetof(GlobalMeta, channels) + ch * sizeof(ChannelMetaV1), sizeof(lm));
+        ChannelStore& store = *channels[ch];
+        uint16_t legacySize = (ch == PUFF_CH) ? sizeof(PuffRecordV1) : store.recordSize();
+        if (lm.magic != CHANNEL_META_MAGIC_V1 || lm.recordSize != legacySize || lm.blockCapacity != store.blockCapacity()
+            || lm.activeCount > lm.blockCapacity) {
+            Logger::warningf("[Persistence] Channel %u layout changed; not migrated", (unsigned)ch);
+            continue;
+        }
+        ChannelMeta& cm = store.meta();
+        cm.activeBlockIndex = lm.activeBlockIndex;
+        cm.activeCount = lm.activeCount;
+        cm.totalRecords = lm.totalRecords;
+        // The ring window moves to its slots; keys already moved by an interrupted pass are missing and skipped.
+        // Older puff blocks may not have reached the client yet, so they stay under their v1 keys until
+        // compaction reclaims them. Older phase blocks are dropped as the ring would have dropped them.
+        uint32_t ringStart = store.ringStart();
+        if (ch == PUFF_CH) store.setLegacyEnd(ringStart);
+        for (uint32_t bi = 0; bi <= lm.activeBlockIndex; ++bi) {
+            if (bi >= ringStart) {
+                store.migrateBlock(h, bi);
+            } else if (ch != PUFF_CH) {
+                char key[NVS_KEY_SIZE]; store.legacyKey(bi, key, sizeof(key));
+                nvs_erase_key(h, key);
+            }
+        }
+        store.invalidate();
+    }
+    pm_commit(h);
+    // The sync blob records the kept range; v1 had no sync blob, so nothing is acknowledged yet
+    memset(&sync, 0, sizeof(sync));
+    saveSync();
+    if (puffCh.legacyEnd()) {
+        Logger::infof("[Persistence] %u v1 puff blocks kept until acknowledged", (unsigned)puffCh.legacyEnd());
+    }
+    return true;
+}
+
 void PersistenceManager::saveMeta() {
-    nvs_handle_t h; if (nvs_open(NAMESPACE, NVS_READWRITE, &h) != ESP_OK) return;
+    nvs_handle_t h; if (!pm_nvs(&h)) return;
     meta.crc32 = computeCrc(&meta, sizeof(meta) - sizeof(uint32_t));
-    nvs_set_blob(h, "meta", &meta, sizeof(meta));
-    nvs_commit(h);
-    nvs_close(h);
-}
-
-void PersistenceManager::loadActiveBlock(uint8_t ch) {
-    ChannelMeta& cm = chMeta(ch);
-    size_t expected = cm.blockCapacity * cm.recordSize;
-    if (expected == 0) return;
-    nvs_handle_t h; if (nvs_open(NAMESPACE, NVS_READWRITE, &h) != ESP_OK) return;
-    char key[10]; snprintf(key, sizeof(key), "c%ub%02u", ch, cm.activeBlockIndex);
-    uint8_t* blockPtr = getBlockPtr(ch);
-    size_t sz = expected;
-    esp_err_t err = nvs_get_blob(h, key, blockPtr, &sz);
-    if (err != ESP_OK || sz != expected) {
-        memset(blockPtr, 0, expected);
-        nvs_set_blob(h, key, blockPtr, expected);
-        nvs_commit(h);
-    }
-    nvs_close(h);
-    if (ch==PUFF_CH) puffBlockLoaded = true; else phaseBlockLoaded = true;
-}
-
-void PersistenceManager::saveActiveBlock(uint8_t ch) {
-    ChannelMeta& cm = chMeta(ch);
-    size_t expected = cm.blockCapacity * cm.recordSize;
-    nvs_handle_t h; if (nvs_open(NAMESPACE, NVS_READWRITE, &h) != ESP_OK) return;
-    char key[10]; snprintf(key, sizeof(key), "c%ub%02u", ch, cm.activeBlockIndex);
-    nvs_set_blob(h, key, getBlockPtr(ch), expected);
-    nvs_commit(h);
-    nvs_close(h);
-}
-
-void PersistenceManager::rotateBlock(uint8_t ch) {
-    ChannelMeta& cm = chMeta(ch);
-    cm.activeBlockIndex++;
-    cm.activeCount = 0;
-    memset(getBlockPtr(ch), 0, cm.blockCapacity * cm.recordSize);
-    saveActiveBlock(ch);
-    saveMeta();
+    pm_set_blob(h, "meta", &meta, sizeof(meta), CNT_NVS_BYTES_META);
+    pm_commit(h);
+}
+
+void PersistenceManager::loadSync() {
+    syncLoaded = true;
+    memset(&sync, 0, sizeof(sync));
+    nvs_handle_t h; if (!pm_nvs(&h)) return;
+    uint8_t raw[sizeof(SyncState)];
+    size_t sz = sizeof(raw);
+    esp_err_t err = nvs_get_blob(h, KEY_SYNC, raw, &sz);
+    if (err != ESP_OK || sz != sizeof(raw) || !pm_blob_crc_ok(raw, sz)) return;
+    SyncState stored;
+    memcpy(&stored, raw, sizeof(stored));
+    if (stored.magic != SYNC_MAGIC) return;
+    // A cursor ahead of the channel belongs to history that has since been reinitialized
+    if (stored.ackedPuffs > puffCh.meta().totalRecords || stored.puffFirstBlock > puffCh.meta().activeBlockIndex
+        || stored.puffLegacyEnd > puffCh.meta().activeBlockIndex) return;
+    sync = stored;
+    puffCh.setFirstBlock(sync.puffFirstBlock);
+    puffCh.setLegacyEnd(sync.puffLegacyEnd);
+}
+
+bool PersistenceManager::saveSync() {
+    sync.magic = SYNC_MAGIC;
+    sync.puffFirstBlock = puffCh.firstBlock();
+    sync.puffLegacyEnd = puffCh.legacyEnd();
+    sync.crc32 = computeCrc(&sync, sizeof(sync) - sizeof(uint32_t));
+    nvs_handle_t h; if (!pm_nvs(&h)) return false;
+    esp_err_t err = pm_set_blob(h, KEY_SYNC, &sync, sizeof(sync), CNT_NVS_BYTES_META);
+    if (err == ESP_OK) err = pm_commit(h);
+    return err == ESP_OK;
+}
+
+bool PersistenceManager::acknowledgePuffs(uint32_t puffNumber) {
+    AllocTracker::Scope alloc(ALLOC_PERSISTENCE);
+    ensureInit();
+    // Puff n is record n-1, so the client cannot acknowledge more puffs than are stored
+    if (puffNumber > puffCh.meta().totalRecords) puffNumber = puffCh.meta().totalRecords;
+    if (puffNumber <= sync.ackedPuffs) return false;
+    sync.ackedPuffs = puffNumber;
+    bool ok = saveSync();
+    Logger::infof("[Persistence] Sync acknowledged up to puff %u", (unsigned)puffNumber);
+    return ok;
+}
+
+uint32_t PersistenceManager::ackedPuffs() {
+    ensureInit();
+    return sync.ackedPuffs;
+}
+
+uint32_t PersistenceManager::unsyncedPuffs() {
+    ensureInit();
+    return puffCh.meta().totalRecords - sync.ackedPuffs;
+}
+
+uint32_t PersistenceManager::compact() {
+    AllocTracker::Scope alloc(ALLOC_PERSISTENCE);
+    ensureInit();
+    // Only puffs the client has and the checkpoint (with its rollups) already covers may go
+    CheckpointRecord cp;
+    if (!loadCheckpoint(cp)) return 0;
+    uint32_t reclaimable = std::min(sync.ackedPuffs, cp.puffRecordsCovered);
+    uint32_t endBlock = std::min<uint32_t>(reclaimable / PUFF_BLOCK_CAP, puffCh.meta().activeBlockIndex);
+    if (endBlock <= puffCh.firstBlock()) return 0;
+    // Erase first: if power is lost before the cursor is saved, the next pass finds the keys already gone
+    uint32_t erased = puffCh.dropBlocksBefore(endBlock);
+    saveSync();
+    Logger::infof("[Persistence] Compacted %u puff blocks (stored from block %u)", (unsigned)erased, (unsigned)endBlock);
+    return erased;
 }
 
 void PersistenceManager::appendPuff(const PuffModel& puff) {
+    AllocTracker::Scope alloc(ALLOC_PERSISTENCE);
     ensureInit();
-    ChannelMeta& cm = chMeta(PUFF_CH);
-    if (cm.activeCount >= cm.blockCapacity) rotateBlock(PUFF_CH);
-    PuffRecord* recs = reinterpret_cast<PuffRecord*>(getBlockPtr(PUFF_CH));
-    PuffRecord& r = recs[cm.activeCount];
+    ensureActiveBlock(puffCh);
+    rotateIfFull(puffCh);
+    PuffRecord& r = puffCh.nextSlot();
     r.tSec = puff.timestampSec;
     r.durationMs = puff.puffDuration;
     r.puffNumber = puff.puffNumber;
     r.phaseIndex = puff.phaseIndex;
-    cm.activeCount++;
-    cm.totalRecords++;
-    saveActiveBlock(PUFF_CH);
+    s_wear.logicalBytes += sizeof(PuffRecord);
+    if (s_wear.puffs++ == 0) s_wear.firstPuffSec = r.tSec;
+    s_wear.lastPuffSec = r.tSec;
+    puffCh.commitSlot();
     saveMeta();
     Logger::info("[Persistence] Puff appended");
 }
 
 void PersistenceManager::appendPhaseStart(const PhaseModel& phase) {
+    AllocTracker::Scope alloc(ALLOC_PERSISTENCE);
     ensureInit();
-    ChannelMeta& cm = chMeta(PHASE_CH);
-    if (cm.activeCount >= cm.blockCapacity) rotateBlock(PHASE_CH);
-    PhaseRecord* recs = reinterpret_cast<PhaseRecord*>(getBlockPtr(PHASE_CH));
-    PhaseRecord& r = recs[cm.activeCount];
+    ensureActiveBlock(phaseCh);
+    rotateIfFull(phaseCh);
+    PhaseRecord& r = phaseCh.nextSlot();
     r.startSec = phase.phaseStartSec;
     r.phaseIndex = phase.phaseIndex;
     r.maxPuffs = phase.maxPuffs;
     r.puffsTaken = phase.puffsTaken;
-    cm.activeCount++;
-    cm.totalRecords++;
-    saveActiveBlock(PHASE_CH);
+    s_wear.logicalBytes += sizeof(PhaseRecord);
+    phaseCh.commitSlot();
     saveMeta();
     Logger::info("[Persistence] Phase start appended");
 }
 
+uint32_t PersistenceManager::findPuffAtOrAfter(uint32_t tSec) {
+    ensureInit();
+    return puffCh.lowerBound([](const PuffRecord& r) { return r.tSec; }, tSec);
+}
+
+void PersistenceManager::appendRollup(const RollupRecord& rollup) {
+    AllocTracker::Scope alloc(ALLOC_PERSISTENCE);
+    ensureInit();
+    ensureActiveBlock(rollupCh);
+    rotateIfFull(rollupCh);
+    rollupCh.nextSlot() = rollup;
+    rollupCh.commitSlot();
+    saveMeta();
+    Logger::info("[Persistence] Rollup appended");
+}
+
 void PersistenceManager::updateCurrentPhasePuffsTaken(uint16_t phaseIndex, uint16_t puffsTaken) {
+    AllocTracker::Scope alloc(ALLOC_PERSISTENCE);
     ensureInit();
-    ChannelMeta& cm = chMeta(PHASE_CH);
-    if (cm.activeCount == 0) return; // nothing to update
+    ensureActiveBlock(phaseCh);
     // Update the last record in the active block if it matches the phase index
-    PhaseRecord* recs = reinterpret_cast<PhaseRecord*>(getBlockPtr(PHASE_CH));
-    PhaseRecord& r = recs[cm.activeCount - 1];
-    if (r.phaseIndex != phaseIndex) return; // not the same phase; skip
-    r.puffsTaken = puffsTaken;
-    saveActiveBlock(PHASE_CH);
+    PhaseRecord* r = phaseCh.lastInBlock();
+    if (!r) return; // nothing to update
+    if (r->phaseIndex != phaseIndex) return; // not the same phase; skip
+    r->puffsTaken = puffsTaken;
+    s_wear.logicalBytes += sizeof(r->puffsTaken);
+    phaseCh.saveActive();
     Logger::info("[Persistence] Phase puffs taken updated");
 }
 
 bool PersistenceManager::recordEpoch(uint32_t epochSec) {
+    AllocTracker::Scope alloc(ALLOC_PERSISTENCE);
     ensureInit();
-    nvs_handle_t h; if (nvs_open(NAMESPACE, NVS_READWRITE, &h) != ESP_OK) return false;
+    nvs_handle_t h; if (!pm_nvs(&h)) return false;
+    Counters::instance().add(CNT_NVS_BYTES_META, sizeof(epochSec));
+    s_wear.logicalBytes += sizeof(epochSec);
+    pm_account_nvs(sizeof(epochSec), 1);
     esp_err_t err = nvs_set_u32(h, KEY_SLEEP_EPOCH, epochSec);
-    if (err == ESP_OK) err = nvs_commit(h);
-    nvs_close(h);
+    if (err == ESP_OK) err = pm_commit(h);
     if (err == ESP_OK) Logger::info("[Persistence] Epoch stored"); else Logger::error("[Persistence] Epoch store failed");
     return err == ESP_OK;
 }
 
 uint32_t PersistenceManager::getLastEpoch(uint32_t fallback) {
     ensureInit();
-    nvs_handle_t h; if (nvs_open(NAMESPACE, NVS_READONLY, &h) != ESP_OK) return fallback;
-    uint32_t val = fallback; nvs_get_u32(h, KEY_SLEEP_EPOCH, &val); nvs_close(h); return val;
+    nvs_handle_t h; if (!pm_nvs(&h)) return fallback;
+    uint32_t val = fallback; nvs_get_u32(h, KEY_SLEEP_EPOCH, &val); return val;
 }
 
-void PersistenceManager::forEachPuff(const std::function<void(const PuffRecord&)>& cb) {
-    ensureInit();
-    ChannelMeta& cm = chMeta(PUFF_CH);
-    nvs_handle_t handle; if (nvs_open(NAMESPACE, NVS_READONLY, &handle) != ESP_OK) return;
-    for (uint16_t bi = 0; bi <= cm.activeBlockIndex; ++bi) {
-        char key[10]; snprintf(key, sizeof(key), "c%ub%02u", PUFF_CH, bi);
-        size_t expected = cm.blockCapacity * cm.recordSize;
-        std::unique_ptr<uint8_t[]> buf(new uint8_t[expected]);
-        size_t sz = expected;
-        if (nvs_get_blob(handle, key, buf.get(), &sz) != ESP_OK || sz != expected) continue;
-        uint16_t limit = (bi == cm.activeBlockIndex) ? cm.activeCount : cm.blockCapacity;
-        PuffRecord* recs = reinterpret_cast<PuffRecord*>(buf.get());
-        for (uint16_t i=0;i<limit;++i) cb(recs[i]);
+bool PersistenceManager::saveClockState(ClockState& st) {
+    AllocTracker::Scope alloc(ALLOC_PERSISTENCE);
+    ensureNvs();
+    st.magic = CLOCK_MAGIC;
+    st.reserved = 0;
+    st.crc32 = computeCrc(&st, sizeof(st) - sizeof(uint32_t));
+    nvs_handle_t h; if (!pm_nvs(&h)) return false;
+    esp_err_t err = pm_set_blob(h, KEY_CLOCK, &st, sizeof(st), CNT_NVS_BYTES_META);
+    if (err == ESP_OK) err = pm_commit(h);
+    if (err != ESP_OK) Logger::error("[Persistence] Clock state store failed");
+    return err == ESP_OK;
+}
+
+bool PersistenceManager::loadClockState(ClockState& out) {
+    // Read before the state machine restores the cursors, so only NVS itself may be brought up
+    ensureNvs();
+    nvs_handle_t h; if (!pm_nvs(&h)) return false;
+    uint8_t raw[sizeof(ClockState)];
+    size_t sz = sizeof(raw);
+    esp_err_t err = nvs_get_blob(h, KEY_CLOCK, raw, &sz);
+    if (err != ESP_OK || sz != sizeof(raw) || !pm_blob_crc_ok(raw, sz)) return false;
+    memcpy(&out, raw, sizeof(out));
+    return out.magic == CLOCK_MAGIC;
+}
+
+PersistenceManager::WearStats PersistenceManager::getWearStats() const {
+    WearStats out = s_wear;
+    out.pageErasesEst = out.entriesWritten / NVS_ENTRIES_PER_PAGE;
+    nvs_stats_t st;
+    if (nvsReady && nvs_get_stats(nullptr, &st) == ESP_OK) {
+        out.usedEntries = (uint32_t)st.used_entries;
+        out.totalEntries = (uint32_t)st.total_entries;
     }
-    nvs_close(handle);
+    return out;
 }
 
-void PersistenceManager::forEachPhase(const std::function<void(const PhaseRecord&)>& cb) {
+void PersistenceManager::resetWearStats() {
+    memset(&s_wear, 0, sizeof(s_wear));
+    s_wearMagic = WEAR_MAGIC;
+}
+
+uint32_t PersistenceManager::projectLifetimeDays() const {
+    if (s_wear.puffs == 0 || s_wear.entriesWritten == 0) return 0;
+    uint32_t spanSec = s_wear.lastPuffSec - s_wear.firstPuffSec;
+    if (spanSec < 3600) return 0;
+    // NVS rotates through every page, and each erase frees one page worth of entries
+    double capacityEntries = (double)FLASH_ENDURANCE_CYCLES * NVS_PARTITION_PAGES * NVS_ENTRIES_PER_PAGE;
+    double entriesPerDay = (double)s_wear.entriesWritten * 86400.0 / spanSec;
+    double days = capacityEntries / entriesPerDay;
+    return days > 4e9 ? UINT32_MAX : (uint32_t)days;
+}
+
+void PersistenceManager::logWearReport() const {
+    WearStats w = getWearStats();
+    uint32_t waX100 = w.logicalBytes ? (uint32_t)((uint64_t)w.nvsBytes * 100 / w.logicalBytes) : 0;
+    uint32_t entriesPerPuffX100 = w.puffs ? (uint32_t)((uint64_t)w.entriesWritten * 100 / w.puffs) : 0;
+    Logger::infof("[Persistence] Wear: %u logical B, %u nvs B (WA %u.%02ux), %u entries, ~%u erases",
+                  (unsigned)w.logicalBytes, (unsigned)w.nvsBytes, (unsigned)(waX100 / 100), (unsigned)(waX100 % 100),
+                  (unsigned)w.entriesWritten, (unsigned)w.pageErasesEst);
+    Logger::infof("[Persistence] Wear: %u puffs, %u.%02u entries/puff, lifetime ~%u days",
+                  (unsigned)w.puffs, (unsigned)(entriesPerPuffX100 / 100), (unsigned)(entriesPerPuffX100 % 100),
+                  (unsigned)projectLifetimeDays());
+}
+
+bool PersistenceManager::saveCheckpoint(CheckpointRecord& cp) {
+    AllocTracker::Scope alloc(ALLOC_PERSISTENCE);
     ensureInit();
-    ChannelMeta& cm = chMeta(PHASE_CH);
-    nvs_handle_t handle; if (nvs_open(NAMESPACE, NVS_READONLY, &handle) != ESP_OK) return;
-    for (uint16_t bi = 0; bi <= cm.activeBlockIndex; ++bi) {
-        char key[10]; snprintf(key, sizeof(key), "c%ub%02u", PHASE_CH, bi);
-        size_t expected = cm.blockCapacity * cm.recordSize;
-        std::unique_ptr<uint8_t[]> buf(new uint8_t[expected]);
-        size_t sz = expected;
-        if (nvs_get_blob(handle, key, buf.get(), &sz) != ESP_OK || sz != expected) continue;
-        uint16_t limit = (bi == cm.activeBlockIndex) ? cm.activeCount : cm.blockCapacity;
-        PhaseRecord* recs = reinterpret_cast<PhaseRecord*>(buf.get());
-        for (uint16_t i=0;i<limit;++i) cb(recs[i]);
+    cp.magic = 0x504D434B; // 'PMCK'
+    cp.version = 3;
+    cp.crc32 = computeCrc(&cp, sizeof(cp) - sizeof(uint32_t));
+    nvs_handle_t h; if (!pm_nvs(&h)) return false;
+    esp_err_t err = pm_set_blob(h, KEY_CHECKPOINT, &cp, sizeof(cp), CNT_NVS_BYTES_META);
+    if (err == ESP_OK) err = pm_commit(h);
+    if (err == ESP_OK) Logger::info("[Persistence] Checkpoint stored"); else Logger::error("[Persistence] Checkpoint store failed");
+    return err == ESP_OK;
+}
+
+bool PersistenceManager::loadCheckpoint(CheckpointRecord& out) {
+    ensureInit();
+    nvs_handle_t h; if (!pm_nvs(&h)) return false;
+    uint8_t raw[sizeof(CheckpointRecord)];
+    size_t sz = sizeof(raw);
+    esp_err_t err = nvs_get_blob(h, KEY_CHECKPOINT, raw, &sz);
+    if (err != ESP_OK || sz != sizeof(out)) return false;
+    if (!pm_blob_crc_ok(raw, sz)) {
+        Logger::warning("[Persistence] Checkpoint CRC mismatch; ignoring");
+        return false;
+    }
+    memcpy(&out, raw, sz);
+    if (out.magic != 0x504D434B || out.version != 3) return false;
+    // A checkpoint ahead of the journal belongs to storage that was since re-initialized
+    if (out.puffRecordsCovered > puffCh.meta().totalRecords || out.phaseRecordsCovered > phaseCh.meta().totalRecords
+        || out.rollupRecordsCovered > rollupCh.meta().totalRecords) {
+        Logger::warning("[Persistence] Checkpoint ahead of journal; ignoring");
+        return false;
     }
-    nvs_close(handle);
-}
\ No newline at end of file
+    return true;
+}
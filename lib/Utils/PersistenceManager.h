@@ -13,8 +13,6 @@
 
 // --- Standard Library Includes ---
 #include <Arduino.h>
-#include <functional>
-#include <memory>
 #include <utility>
 
 // --- ESP32 NVS Includes ---
@@ -25,6 +23,7 @@
 // --- Project Includes ---
 #include "Logger.h"
 #include "StateMachine.h"
+#include "RecordChannel.h"
 
 // -----------------------------------------------------------------------------
 // Persistence Constants (CRC, NVS, Channels, Block Sizes)
@@ -38,17 +37,61 @@ constexpr uint32_t CRC_POLY = 0xEDB88320;    ///< CRC-32 polynomial
 
 /// @name NVS Keys and Channels
 ///@{
-static constexpr const char* NAMESPACE = "persist";           ///< NVS namespace for persistence
 static constexpr const char* KEY_SLEEP_EPOCH = "sleep_epoch"; ///< Key for storing last sleep epoch
+static constexpr const char* KEY_CHECKPOINT = "ckpt";         ///< Key for the derived-state checkpoint
+static constexpr const char* KEY_SYNC = "sync";               ///< Key for the acknowledged-sync cursor
+static constexpr const char* KEY_CLOCK = "clock";             ///< Key for the RTC drift estimate
 static constexpr uint8_t PUFF_CH = 0;                         ///< Puff channel index
 static constexpr uint8_t PHASE_CH = 1;                        ///< Phase channel index
-static constexpr uint8_t CHANNEL_COUNT = 2;                   ///< Number of channels
+static constexpr uint8_t ROLLUP_CH = 2;                       ///< Rollup channel index
+static constexpr uint8_t CHANNEL_COUNT = 3;                   ///< Number of channels
 ///@}
 
 /// @name Block Capacities
 ///@{
 static constexpr uint16_t PUFF_BLOCK_CAP = 32;  ///< Puffs per block
 static constexpr uint16_t PHASE_BLOCK_CAP = 16; ///< Phases per block
+static constexpr uint16_t ROLLUP_BLOCK_CAP = 16; ///< Closed rollups per block
+///@}
+
+/// @name Ring Sizes (blocks kept per channel before the oldest slot is reused)
+///@{
+#ifndef PUFF_RING_BLOCKS
+#define PUFF_RING_BLOCKS                  16            ///< 512 puffs
+#endif
+#ifndef PHASE_RING_BLOCKS
+#define PHASE_RING_BLOCKS                 4             ///< 64 phases
+#endif
+#ifndef ROLLUP_RING_BLOCKS
+#define ROLLUP_RING_BLOCKS                4             ///< 64 closed rollups
+#endif
+///@}
+
+/// @name Rollups
+///@{
+/// @brief Rollup bucket kinds (also the index into RollupState arrays)
+enum RollupKind : uint8_t {
+    ROLLUP_PHASE = 0,       ///< Keyed by phase index
+    ROLLUP_DAY = 1,         ///< Keyed by UTC day (epoch seconds / 86400)
+    ROLLUP_KIND_COUNT = 2,
+};
+///@}
+
+/// @name Checkpoints
+///@{
+static constexpr uint16_t CHECKPOINT_INTERVAL = PUFF_BLOCK_CAP; ///< Puffs between checkpoints (bounds boot replay)
+///@}
+
+/// @name Flash Wear Model (ESP-IDF NVS item layout)
+///@{
+#ifndef NVS_PARTITION_PAGES
+#define NVS_PARTITION_PAGES               5             ///< 4 KiB pages in the nvs partition (default table: 0x5000)
+#endif
+#ifndef FLASH_ENDURANCE_CYCLES
+#define FLASH_ENDURANCE_CYCLES            100000        ///< Rated erase cycles per flash sector
+#endif
+static constexpr uint16_t NVS_ENTRY_BYTES = 32;       ///< Size of one NVS entry
+static constexpr uint16_t NVS_ENTRIES_PER_PAGE = 126; ///< Data entries per 4 KiB NVS page
 ///@}
 
 /**
@@ -64,6 +107,13 @@ public:
      */
     static PersistenceManager& instance();
 
+#ifdef HOST_SIM
+    /**
+     * @brief Host simulation only: rebuild the singleton as a reset does (RAM state lost, NVS kept).
+     */
+    static void hostReset();
+#endif
+
     /**
      * @brief Initialize NVS and internal state.
      */
@@ -75,7 +125,7 @@ public:
     struct PuffRecord {
         uint32_t tSec;         ///< Puff timestamp (epoch seconds)
         uint32_t durationMs;   ///< Puff duration (milliseconds)
-        uint16_t puffNumber;   ///< Puff sequence number
+        uint32_t puffNumber;   ///< Puff sequence number (record index + 1)
         uint16_t phaseIndex;   ///< Phase index
     } __attribute__((packed));
 
@@ -89,6 +139,161 @@ public:
         uint16_t puffsTaken;
     } __attribute__((packed));
 
+    /**
+     * @brief Aggregate of the puffs in one phase or one day (packed).
+     */
+    struct RollupRecord {
+        uint8_t kind;           ///< RollupKind
+        uint8_t reserved;
+        uint16_t count;         ///< Puffs in the bucket (0 = empty)
+        uint32_t key;           ///< Phase index or UTC day number
+        uint32_t sumDurationMs; ///< Total puff duration
+        uint32_t minDurationMs; ///< Shortest puff
+        uint32_t maxDurationMs; ///< Longest puff
+        uint32_t firstSec;      ///< First puff timestamp
+        uint32_t lastSec;       ///< Last puff timestamp
+    } __attribute__((packed));
+
+    /**
+     * @brief Open (still accumulating) rollups and the next key each kind may close (packed).
+     */
+    struct RollupState {
+        RollupRecord open[ROLLUP_KIND_COUNT];
+        uint32_t nextKey[ROLLUP_KIND_COUNT]; ///< Closed rollups with a lower key are already persisted
+    } __attribute__((packed));
+
+    /**
+     * @brief Derived state checkpoint (packed). Boot replays only records past the covered counts.
+     */
+    struct CheckpointRecord {
+        uint32_t magic;               ///< 'PMCK'
+        uint16_t version;             ///< 3
+        uint16_t phaseIndex;          ///< Current phase index
+        uint32_t phaseStartSec;       ///< Current phase start (epoch seconds)
+        uint16_t maxPuffs;            ///< Current phase max puffs
+        uint16_t puffsTaken;          ///< Current phase puffs taken
+        uint8_t state;                ///< state_t at checkpoint time
+        uint8_t hasLastPuff;          ///< 1 if lastPuff is valid
+        PuffRecord lastPuff;          ///< Most recent puff
+        uint32_t puffRecordsCovered;  ///< Puff channel totalRecords included in this checkpoint
+        uint32_t phaseRecordsCovered; ///< Phase channel totalRecords included in this checkpoint
+        RollupState rollups;          ///< Rollup state at checkpoint time
+        uint32_t rollupRecordsCovered;///< Rollup channel totalRecords included in this checkpoint
+        uint32_t crc32;               ///< Over everything except crc32
+    } __attribute__((packed));
+
+    /**
+     * @brief Persist a checkpoint (magic, version and CRC are filled in).
+     * @return True if successful.
+     */
+    bool saveCheckpoint(CheckpointRecord& cp);
+
+    /**
+     * @brief Load the last checkpoint if present, intact and consistent with the channel cursors.
+     * @return True if out holds a valid checkpoint.
+     */
+    bool loadCheckpoint(CheckpointRecord& out);
+
+    /**
+     * @brief Acknowledged-sync cursor and compaction progress (packed). Written only on ack and compaction.
+     */
+    struct SyncState {
+        uint32_t magic;          ///< 'PSY2'
+        uint32_t ackedPuffs;     ///< Client confirmed puffs 1..ackedPuffs
+        uint32_t puffFirstBlock; ///< First puff block not yet reclaimed
+        uint32_t puffLegacyEnd;  ///< Puff blocks below this, kept from v1 storage, are still under their v1 keys
+        uint32_t crc32;          ///< Over everything except crc32
+    } __attribute__((packed));
+
+    /**
+     * @brief Record that the client has stored every puff up to puffNumber. The cursor only moves forward.
+     * @return True if the cursor advanced and was persisted.
+     */
+    bool acknowledgePuffs(uint32_t puffNumber);
+
+    /**
+     * @brief Highest puff number the client has acknowledged.
+     */
+    uint32_t ackedPuffs();
+
+    /**
+     * @brief Stored puffs the client has not acknowledged yet.
+     */
+    uint32_t unsyncedPuffs();
+
+    /**
+     * @brief Erase puff blocks that are fully acknowledged and covered by the checkpoint.
+     *
+     * Covered puffs are already folded into the checkpoint and the rollups, so boot replay and
+     * summaries never need them again. Phase, rollup and checkpoint data are kept. Blocks the ring
+     * recycles first are gone either way; compaction frees their entries early.
+     * @return Number of blocks reclaimed.
+     */
+    uint32_t compact();
+
+    /**
+     * @brief Write position of one channel (mirrors the cursor fields of the channel meta).
+     */
+    struct ChannelCursor {
+        uint32_t activeBlockIndex; ///< Current block number
+        uint16_t activeCount;      ///< Records used in active block
+        uint32_t totalRecords;     ///< Total records persisted
+    } __attribute__((packed));
+
+    /**
+     * @brief Current write position of a channel.
+     */
+    ChannelCursor getCursor(uint8_t ch) const;
+
+    /**
+     * @brief Adopt channel cursors from a trusted snapshot instead of reading meta from NVS.
+     * Must be called before init(); active blocks are then loaded on first write. Ignored once
+     * meta has been loaded, which already holds the cursors.
+     * @param cursors Array of CHANNEL_COUNT cursors.
+     */
+    void restoreCursors(const ChannelCursor* cursors);
+
+    /**
+     * @brief CRC-32 over a buffer (same polynomial as the persisted meta).
+     */
+    uint32_t computeCrc(const void* d, size_t len) const;
+
+    /**
+     * @brief Physical cost of persistence writes, accumulated across deep sleep (reset on power loss).
+     */
+    struct WearStats {
+        uint32_t logicalBytes;   ///< Record bytes the data model asked to store (puffs, phases, puffsTaken, epoch)
+        uint32_t nvsBytes;       ///< Bytes handed to nvs_set_* (whole blocks, meta, checkpoints)
+        uint32_t entriesWritten; ///< 32-byte NVS entries consumed, from the ESP-IDF item layout
+        uint32_t pageErasesEst;  ///< entriesWritten / NVS_ENTRIES_PER_PAGE (excludes GC relocation)
+        uint32_t puffs;          ///< Puffs appended
+        uint32_t firstPuffSec;   ///< Timestamp of the first puff counted
+        uint32_t lastPuffSec;    ///< Timestamp of the last puff counted
+        uint32_t usedEntries;    ///< Live entries reported by nvs_get_stats (0 if unavailable)
+        uint32_t totalEntries;   ///< Total entries reported by nvs_get_stats (0 if unavailable)
+    };
+
+    /**
+     * @brief Snapshot of the wear counters (nvs_get_stats fields are filled in when available).
+     */
+    WearStats getWearStats() const;
+
+    /**
+     * @brief Zero the wear counters.
+     */
+    void resetWearStats();
+
+    /**
+     * @brief Projected days until the nvs partition reaches FLASH_ENDURANCE_CYCLES at the observed puff rate.
+     * @return Days, or 0 if less than an hour of puffs has been observed.
+     */
+    uint32_t projectLifetimeDays() const;
+
+    /**
+     * @brief Log write amplification, entries per puff and projected lifetime.
+     */
+    void logWearReport() const;
+
     /**
      * @brief Append a new puff record to persistent storage.
      */
@@ -99,6 +304,11 @@ public:
      */
     void appendPhaseStart(const PhaseModel& phase);
 
+    /**
+     * @brief Append a closed rollup to the rollup channel.
+     */
+    void appendRollup(const RollupRecord& rollup);
+
     /**
      * @brief Update the number of puffs taken for the current phase.
      */
@@ -122,14 +332,69 @@ public:
     uint32_t getLastEpoch(uint32_t fallback = 0);
 
     /**
-     * @brief Iterate over all stored puff records, invoking callback for each.
+     * @brief RTC drift estimate and the readings of the correction it came from (packed).
+     * Written only when a time sync yields a drift sample.
      */
-    void forEachPuff(const std::function<void(const PuffRecord&)>& cb);
+    struct ClockState {
+        uint32_t magic;          ///< 'PCLK'
+        int32_t driftPpm;        ///< RTC rate error across deep sleep; positive = RTC runs slow
+        uint16_t samples;        ///< Corrections folded into driftPpm
+        uint16_t reserved;
+        uint32_t syncEpoch;      ///< Wall clock set by the last correction
+        int32_t errorSec;        ///< Synced time minus RTC-derived time at that correction
+        uint32_t sleptSec;       ///< RTC-timed deep sleep (wake minus sleep readings) before that correction
+        uint32_t crc32;          ///< Over everything except crc32
+    } __attribute__((packed));
 
     /**
-     * @brief Iterate over all stored phase records, invoking callback for each.
+     * @brief Persist the drift estimate.
+     * @return True on success.
      */
-    void forEachPhase(const std::function<void(const PhaseRecord&)>& cb);
+    bool saveClockState(ClockState& st);
+
+    /**
+     * @brief Load the drift estimate if present and intact.
+     * Only initializes NVS; safe to call before restoreCursors().
+     */
+    bool loadClockState(ClockState& out);
+
+    /**
+     * @brief Visit stored puff records [fromRecord, toRecord) with cb(const PuffRecord&).
+     * A visitor returning bool stops the traversal on false. Does not allocate.
+     * @return Number of records visited.
+     */
+    template <typename Visit>
+    uint32_t forEachPuff(Visit&& cb, uint32_t fromRecord = 0, uint32_t toRecord = UINT32_MAX) {
+        ensureInit();
+        return puffCh.forEach(std::forward<Visit>(cb), fromRecord, toRecord);
+    }
+
+    /**
+     * @brief Visit stored phase records [fromRecord, toRecord) with cb(const PhaseRecord&).
+     * A visitor returning bool stops the traversal on false. Does not allocate.
+     * @return Number of records visited.
+     */
+    template <typename Visit>
+    uint32_t forEachPhase(Visit&& cb, uint32_t fromRecord = 0, uint32_t toRecord = UINT32_MAX) {
+        ensureInit();
+        return phaseCh.forEach(std::forward<Visit>(cb), fromRecord, toRecord);
+    }
+
+    /**
+     * @brief Record index of the first puff at or after tSec (puff timestamps never decrease).
+     * @return Index in [0, total puffs]; pass it to forEachPuff() as fromRecord.
+     */
+    uint32_t findPuffAtOrAfter(uint32_t tSec);
+
+    /**
+     * @brief Visit closed rollups [fromRecord, toRecord) with cb(const RollupRecord&), oldest first.
+     * @return Number of records visited.
+     */
+    template <typename Visit>
+    uint32_t forEachRollup(Visit&& cb, uint32_t fromRecord = 0, uint32_t toRecord = UINT32_MAX) {
+        ensureInit();
+        return rollupCh.forEach(std::forward<Visit>(cb), fromRecord, toRecord);
+    }
 
 private:
     PersistenceManager();
@@ -137,19 +402,9 @@ private:
     PersistenceManager(const PersistenceManager&) = delete;
     PersistenceManager& operator=(const PersistenceManager&) = delete;
 
-    // Channel meta for each persisted channel (puffs/phases)
-    struct ChannelMeta {
-        uint32_t magic;          // 'PMCH'
-        uint16_t recordSize;     // sizeof(record)
-        uint16_t blockCapacity;  // records per block
-        uint16_t activeBlockIndex; // current block index
-        uint16_t activeCount;      // records used in active block
-        uint32_t totalRecords;     // total records persisted
-    } __attribute__((packed));
-
     struct GlobalMeta {
         uint32_t magic;       // 'PMTA'
-        uint16_t version;     // 1
+        uint16_t version;     // 2 (1: 16-bit block numbers and puff numbers, keys "c<ch>b<block>")
         uint16_t channelCount;
         ChannelMeta channels[CHANNEL_COUNT];
         uint32_t crc32;       // over everything except crc32
@@ -157,22 +412,25 @@ private:
 
     GlobalMeta meta;
     bool metaLoaded;
+    bool nvsReady;
+    SyncState sync;
+    bool syncLoaded;
 
-    // Active blocks in RAM
-    uint8_t puffBlock[PUFF_BLOCK_CAP * sizeof(PuffRecord)];
-    uint8_t phaseBlock[PHASE_BLOCK_CAP * sizeof(PhaseRecord)];
-    bool puffBlockLoaded;
-    bool phaseBlockLoaded;
+    // Persisted channels; each owns its active block in RAM
+    RecordChannel<PuffRecord, PUFF_BLOCK_CAP, PUFF_CH, PUFF_RING_BLOCKS> puffCh;
+    RecordChannel<PhaseRecord, PHASE_BLOCK_CAP, PHASE_CH, PHASE_RING_BLOCKS> phaseCh;
+    RecordChannel<RollupRecord, ROLLUP_BLOCK_CAP, ROLLUP_CH, ROLLUP_RING_BLOCKS> rollupCh;
+    ChannelStore* const channels[CHANNEL_COUNT];
 
+    void ensureNvs();
     void ensureInit();
+    void ensureActiveBlock(ChannelStore& ch);
+    void rotateIfFull(ChannelStore& ch);
+    void initDefaultMeta();
     void loadMeta();
+    bool migrateV1(nvs_handle_t h, const uint8_t* raw, size_t sz);
     void saveMeta();
-    void loadActiveBlock(uint8_t ch);
-    void saveActiveBlock(uint8_t ch);
-    void rotateBlock(uint8_t ch);
-    uint32_t computeCrc(const void* d, size_t len) const;
-
-    uint8_t* getBlockPtr(uint8_t ch) { return (ch==PUFF_CH)? puffBlock : phaseBlock; }
-    ChannelMeta& chMeta(uint8_t ch) { return meta.channels[ch]; }
+    void loadSync();
+    bool saveSync();
 
 };
@@ -0,0 +1,147 @@
+#include "RecordChannel.h"
+#include "BootProfiler.h"
+
+// -----------------------------------------------------------------------------
+// Shared Traversal Scratch
+// -----------------------------------------------------------------------------
+
+static uint8_t s_scratch[CHANNEL_SCRATCH_BYTES];
+static StaticSemaphore_t s_scratchMutexBuf;
+static SemaphoreHandle_t s_scratchMutex = nullptr;
+
+ChannelStore::ScratchLock::ScratchLock() { xSemaphoreTake(s_scratchMutex, portMAX_DELAY); }
+ChannelStore::ScratchLock::~ScratchLock() { xSemaphoreGive(s_scratchMutex); }
+uint8_t* ChannelStore::ScratchLock::buffer() const { return s_scratch; }
+
+// -----------------------------------------------------------------------------
+// ChannelStore Method Implementations
+// -----------------------------------------------------------------------------
+
+ChannelStore::ChannelStore(uint8_t id, uint16_t recordSize, uint16_t blockCap, uint16_t ringBlocks, uint8_t* block,
+                           CounterId bytesCounter)
+    : block_(block), meta_(nullptr), firstBlock_(0), legacyEnd_(0), id_(id), recordSize_(recordSize), blockCap_(blockCap),
+      ringBlocks_(ringBlocks), bytesCounter_(bytesCounter), legacyRecordSize_(recordSize), legacyConvert_(nullptr),
+      loaded_(false) {
+    memset(block_, 0, blockBytes());
+    // Channels are constructed with the persistence singleton, before any task can traverse
+    if (!s_scratchMutex) s_scratchMutex = xSemaphoreCreateMutexStatic(&s_scratchMutexBuf);
+}
+
+void ChannelStore::resetMeta() {
+    memset(meta_, 0, sizeof(*meta_));
+    firstBlock_ = 0;
+    legacyEnd_ = 0;
+    meta_->magic = CHANNEL_META_MAGIC;
+    meta_->recordSize = recordSize_;
+    meta_->blockCapacity = blockCap_;
+    meta_->ringBlocks = ringBlocks_;
+}
+
+bool ChannelStore::metaMatches() const {
+    return meta_->magic == CHANNEL_META_MAGIC && meta_->recordSize == recordSize_ && meta_->blockCapacity == blockCap_
+        && meta_->ringBlocks == ringBlocks_ && meta_->activeCount <= blockCap_;
+}
+
+void ChannelStore::blockKey(uint32_t blockIndex, char* out, size_t outSize) const {
+    snprintf(out, outSize, "c%us%u", (unsigned)id_, (unsigned)(blockIndex % ringBlocks_));
+}
+
+void ChannelStore::legacyKey(uint32_t blockIndex, char* out, size_t outSize) const {
+    snprintf(out, outSize, "c%ub%02u", (unsigned)id_, (unsigned)blockIndex);
+}
+
+bool ChannelStore::readBlock(nvs_handle_t h, uint32_t blockIndex, uint8_t* out) const {
+    // A slot holds only the newest block mapped to it
+    if (!isStored(blockIndex)) return false;
+    if (blockIndex < legacyEnd_) return readLegacyBlock(h, blockIndex, out);
+    char key[NVS_KEY_SIZE]; blockKey(blockIndex, key, sizeof(key));
+    size_t sz = blockBytes();
+    return nvs_get_blob(h, key, out, &sz) == ESP_OK && sz == blockBytes();
+}
+
+bool ChannelStore::readLegacyBlock(nvs_handle_t h, uint32_t blockIndex, uint8_t* out) const {
+    size_t legacyBytes = (size_t)legacyRecordSize_ * blockCap_;
+    if (legacyBytes > blockBytes()) return false;
+    // Load at the end of out and convert forward: record i is read before record i + 1 overwrites it
+    uint8_t* src = out + (blockBytes() - legacyBytes);
+    char key[NVS_KEY_SIZE]; legacyKey(blockIndex, key, sizeof(key));
+    size_t sz = legacyBytes;
+    if (nvs_get_blob(h, key, src, &sz) != ESP_OK || sz != legacyBytes) return false;
+    if (legacyConvert_) {
+        for (uint16_t i = 0; i < blockCap_; ++i) {
+            legacyConvert_(src + (size_t)i * legacyRecordSize_, out + (size_t)i * recordSize_, blockIndex * blockCap_ + i);
+        }
+    }
+    return true;
+}
+
+void ChannelStore::loadActive() {
+    BootProfiler::Scope prof(BOOT_FIRST_WRITE_LOAD);
+    nvs_handle_t h; if (!pm_nvs(&h)) return;
+    if (!readBlock(h, meta_->activeBlockIndex, block_)) {
+        char key[NVS_KEY_SIZE]; blockKey(meta_->activeBlockIndex, key, sizeof(key));
+        memset(block_, 0, blockBytes());
+        pm_set_blob(h, key, block_, blockBytes(), bytesCounter_);
+        pm_commit(h);
+    }
+    loaded_ = true;
+}
+
+void ChannelStore::saveActive() {
+    nvs_handle_t h; if (!pm_nvs(&h)) return;
+    char key[NVS_KEY_SIZE]; blockKey(meta_->activeBlockIndex, key, sizeof(key));
+    pm_set_blob(h, key, block_, blockBytes(), bytesCounter_);
+    pm_commit(h);
+}
+
+uint32_t ChannelStore::dropBlocksBefore(uint32_t endBlock) {
+    if (endBlock > meta_->activeBlockIndex) endBlock = meta_->activeBlockIndex;
+    // Slots of blocks older than oldestBlock() already hold newer blocks
+    uint32_t from = oldestBlock();
+    if (endBlock <= from) {
+        if (endBlock > firstBlock_) firstBlock_ = endBlock;
+        return 0;
+    }
+    nvs_handle_t h; if (!pm_nvs(&h)) return 0;
+    uint32_t erased = 0;
+    for (uint32_t bi = from; bi < endBlock; ++bi) {
+        // Blocks between kept legacy blocks and the ring window were recycled
+        if (!isStored(bi)) continue;
+        char key[NVS_KEY_SIZE];
+        if (bi < legacyEnd_) legacyKey(bi, key, sizeof(key)); else blockKey(bi, key, sizeof(key));
+        // A block may already be gone if a previous pass lost power before recording progress
+        if (nvs_erase_key(h, key) == ESP_OK) erased++;
+    }
+    pm_commit(h);
+    firstBlock_ = endBlock;
+    return erased;
+}
+
+void ChannelStore::rotate() {
+    Counters::instance().add(CNT_BLOCK_ROTATIONS);
+    // The new block takes the slot of the oldest one; count it if it was never reclaimed
+    if (blockRecycledByRotate() != UINT32_MAX) Counters::instance().add(CNT_BLOCKS_RECYCLED);
+    meta_->activeBlockIndex++;
+    meta_->activeCount = 0;
+    memset(block_, 0, blockBytes());
+}
+
+void ChannelStore::migrateBlock(nvs_handle_t h, uint32_t blockIndex) {
+    size_t legacyBytes = (size_t)legacyRecordSize_ * blockCap_;
+    if (legacyBytes > CHANNEL_SCRATCH_BYTES) return;
+    ScratchLock scratch;
+    char legacy[NVS_KEY_SIZE]; legacyKey(blockIndex, legacy, sizeof(legacy));
+    size_t sz = legacyBytes;
+    if (nvs_get_blob(h, legacy, scratch.buffer(), &sz) != ESP_OK || sz != legacyBytes) return;
+    const uint8_t* src = scratch.buffer();
+    if (legacyConvert_) {
+        for (uint16_t i = 0; i < blockCap_; ++i) {
+            legacyConvert_(src + (size_t)i * legacyRecordSize_, block_ + (size_t)i * recordSize_, blockIndex * blockCap_ + i);
+        }
+    } else {
+        memcpy(block_, src, blockBytes());
+    }
+    char key[NVS_KEY_SIZE]; blockKey(blockIndex, key, sizeof(key));
+    if (pm_set_blob(h, key, block_, blockBytes(), bytesCounter_) == ESP_OK) nvs_erase_key(h, legacy);
+    loaded_ = false;
+}
@@ -0,0 +1,400 @@
+#pragma once
+
+/**
+ * @file RecordChannel.h
+ * @brief Block-journaled NVS channel of fixed-size records, specialized per record type at compile time.
+ *
+ * Records are packed into blocks of BlockCap records. Block numbers grow without bound, but only the
+ * newest RingBlocks blocks are kept: block b is stored under key "c<id>s<b % RingBlocks>", so a
+ * rotation reuses the slot of the oldest block and the key set never grows. Blocks migrated from the
+ * one-key-per-block layout may stay under their legacy keys, below the ring window, until reclaimed.
+ * Only the active block
+ * is held in RAM, in a buffer owned by the channel. Block I/O is shared by every
+ * channel through ChannelStore; the typed parts (buffer, append slot, traversal) are generated
+ * per RecordChannel instantiation so visitors are called directly and can be inlined.
+ * Traversal reads stored blocks into one static scratch buffer shared by all channels and
+ * never allocates.
+ *
+ * @author Vetra Firmware Team
+ * @copyright Copyright (c) 2025 Vetra
+ */
+
+// --- Standard Library Includes ---
+#include <Arduino.h>
+#include <algorithm>
+#include <type_traits>
+#include <utility>
+
+// --- FreeRTOS Includes ---
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+
+// --- ESP32 NVS Includes ---
+#include <nvs.h>
+#include <esp_err.h>
+
+// --- Project Includes ---
+#include "Counters.h"
+
+// -----------------------------------------------------------------------------
+// Channel Constants and Shared NVS Helpers
+// -----------------------------------------------------------------------------
+
+static constexpr const char* NAMESPACE = "persist";        ///< NVS namespace for persistence
+static constexpr uint32_t CHANNEL_META_MAGIC = 0x504D4332; ///< 'PMC2'
+static constexpr size_t NVS_KEY_SIZE = 16;                 ///< NVS key buffer (15 chars + terminator)
+static constexpr size_t CHANNEL_SCRATCH_BYTES = 512;       ///< Shared traversal buffer; bounds every channel's block size
+
+/**
+ * @brief Shared read-write handle to NAMESPACE, opened on first use and never closed
+ * (each nvs_open allocates a handle entry on the heap). Defined in PersistenceManager.cpp.
+ * @return False if the namespace cannot be opened.
+ */
+bool pm_nvs(nvs_handle_t* out);
+
+/**
+ * @brief nvs_set_blob with counter and wear accounting (defined in PersistenceManager.cpp).
+ */
+esp_err_t pm_set_blob(nvs_handle_t h, const char* key, const void* data, size_t len, CounterId bytesCounter);
+
+/**
+ * @brief nvs_commit with latency and counter accounting (defined in PersistenceManager.cpp).
+ */
+esp_err_t pm_commit(nvs_handle_t h);
+
+/**
+ * @brief Converts one legacy record into the current layout; recordIndex is its position in the channel.
+ */
+using LegacyRecordConvert = void (*)(const uint8_t* legacy, uint8_t* out, uint32_t recordIndex);
+
+/**
+ * @brief Per-channel cursor persisted inside the global meta blob (packed).
+ */
+struct ChannelMeta {
+    uint32_t magic;            ///< 'PMC2'
+    uint16_t recordSize;       ///< sizeof(record)
+    uint16_t blockCapacity;    ///< Records per block
+    uint16_t ringBlocks;       ///< Block slots reused as a ring
+    uint16_t activeCount;      ///< Records used in active block
+    uint32_t activeBlockIndex; ///< Current block number (stored in slot activeBlockIndex % ringBlocks)
+    uint32_t totalRecords;     ///< Total records persisted
+} __attribute__((packed));
+
+// -----------------------------------------------------------------------------
+// ChannelStore (type-erased block I/O)
+// -----------------------------------------------------------------------------
+
+/**
+ * @class ChannelStore
+ * @brief Block load/save/rotate shared by every RecordChannel.
+ */
+class ChannelStore {
+public:
+    uint8_t id() const { return id_; }
+    size_t blockBytes() const { return (size_t)recordSize_ * blockCap_; }
+    uint16_t recordSize() const { return recordSize_; }
+    uint16_t blockCapacity() const { return blockCap_; }
+    uint16_t ringBlocks() const { return ringBlocks_; }
+
+    /**
+     * @brief Bind the channel to its slot in the global meta.
+     */
+    void bind(ChannelMeta* meta) { meta_ = meta; }
+    ChannelMeta& meta() { return *meta_; }
+    const ChannelMeta& meta() const { return *meta_; }
+
+    /**
+     * @brief Reset the bound meta to an empty channel of this record type.
+     */
+    void resetMeta();
+
+    /**
+     * @brief True if the bound meta was written for this record size, block capacity and ring size.
+     */
+    bool metaMatches() const;
+
+    bool isLoaded() const { return loaded_; }
+    void invalidate() { loaded_ = false; }
+    bool isFull() const { return meta_->activeCount >= blockCap_; }
+
+    /**
+     * @brief Load the active block into RAM, creating an empty one if it is missing or short.
+     */
+    void loadActive();
+
+    /**
+     * @brief Persist the active block.
+     */
+    void saveActive();
+
+    /**
+     * @brief Start a fresh, empty active block in the next ring slot (the caller persists the meta).
+     *
+     * The block is written by the next commit, so a reset before then leaves the previous
+     * content of the slot behind an empty cursor instead of a half-rotated ring.
+     */
+    void rotate();
+
+    /**
+     * @brief Stored block whose slot the next rotate() overwrites, or UINT32_MAX if the slot is free.
+     */
+    uint32_t blockRecycledByRotate() const {
+        uint32_t next = meta_->activeBlockIndex + 1;
+        if (next < ringBlocks_ || next - ringBlocks_ < firstBlock_) return UINT32_MAX;
+        return next - ringBlocks_;
+    }
+
+    /**
+     * @brief First block not yet reclaimed by dropBlocksBefore().
+     */
+    uint32_t firstBlock() const { return firstBlock_; }
+    void setFirstBlock(uint32_t blockIndex) { firstBlock_ = blockIndex; }
+
+    /**
+     * @brief First block the ring still holds.
+     */
+    uint32_t ringStart() const {
+        return (meta_->activeBlockIndex >= ringBlocks_) ? meta_->activeBlockIndex + 1 - ringBlocks_ : 0;
+    }
+
+    /**
+     * @brief Record layout of blocks kept under legacy keys (see setLegacyEnd()).
+     * @param convert nullptr if the record layout is unchanged.
+     */
+    void setLegacyFormat(uint16_t legacyRecordSize, LegacyRecordConvert convert) {
+        legacyRecordSize_ = legacyRecordSize;
+        legacyConvert_ = convert;
+    }
+
+    /**
+     * @brief Blocks [firstBlock(), legacyEnd()) stay under their legacy keys, below the ring window,
+     * until dropBlocksBefore() reclaims them. They are read through the legacy format.
+     */
+    uint32_t legacyEnd() const { return legacyEnd_; }
+    void setLegacyEnd(uint32_t blockIndex) { legacyEnd_ = blockIndex; }
+
+    /**
+     * @brief Oldest block still stored: neither reclaimed nor overwritten by the ring.
+     */
+    uint32_t oldestBlock() const {
+        if (firstBlock_ < legacyEnd_) return firstBlock_;
+        uint32_t start = ringStart();
+        return firstBlock_ > start ? firstBlock_ : start;
+    }
+
+    /**
+     * @brief True if blockIndex is still stored, under its ring slot or its legacy key.
+     */
+    bool isStored(uint32_t blockIndex) const {
+        if (blockIndex < firstBlock_ || blockIndex > meta_->activeBlockIndex) return false;
+        return blockIndex < legacyEnd_ || blockIndex >= ringStart();
+    }
+
+    /**
+     * @brief Erase stored blocks [oldestBlock(), endBlock). The active block is never erased.
+     * Record indices are unchanged; traversals start at the oldest stored block.
+     * @return Number of blocks erased.
+     */
+    uint32_t dropBlocksBefore(uint32_t endBlock);
+
+    /**
+     * @brief Legacy key of a block ("c<id>b<nn>", one key per block).
+     */
+    void legacyKey(uint32_t blockIndex, char* out, size_t outSize) const;
+
+    /**
+     * @brief Move one block from its legacy key into its ring slot, converting each record.
+     *
+     * Reads the legacy key through the scratch buffer, writes the converted block and erases the
+     * legacy key. A missing legacy key is treated as already moved. Uses the setLegacyFormat() layout.
+     */
+    void migrateBlock(nvs_handle_t h, uint32_t blockIndex);
+
+protected:
+    /**
+     * @brief Exclusive use of the shared scratch buffer for one traversal.
+     */
+    class ScratchLock {
+    public:
+        ScratchLock();
+        ~ScratchLock();
+        uint8_t* buffer() const;
+        ScratchLock(const ScratchLock&) = delete;
+        ScratchLock& operator=(const ScratchLock&) = delete;
+    };
+
+    ChannelStore(uint8_t id, uint16_t recordSize, uint16_t blockCap, uint16_t ringBlocks, uint8_t* block, CounterId bytesCounter);
+    ChannelStore(const ChannelStore&) = delete;
+    ChannelStore& operator=(const ChannelStore&) = delete;
+
+    void blockKey(uint32_t blockIndex, char* out, size_t outSize) const;
+    bool readBlock(nvs_handle_t h, uint32_t blockIndex, uint8_t* out) const;
+
+    uint8_t* const block_;
+    ChannelMeta* meta_;
+    uint32_t firstBlock_;
+    uint32_t legacyEnd_;
+
+private:
+    const uint8_t id_;
+    const uint16_t recordSize_;
+    const uint16_t blockCap_;
+    const uint16_t ringBlocks_;
+    const CounterId bytesCounter_;
+    uint16_t legacyRecordSize_;
+    LegacyRecordConvert legacyConvert_;
+    bool loaded_;
+
+    bool readLegacyBlock(nvs_handle_t h, uint32_t blockIndex, uint8_t* out) const;
+};
+
+// -----------------------------------------------------------------------------
+// RecordChannel<Record, BlockCap, Id>
+// -----------------------------------------------------------------------------
+
+/**
+ * @class RecordChannel
+ * @brief Channel of Record values, BlockCap per block, keeping the newest RingBlocks blocks under channel id Id.
+ */
+template <typename Record, uint16_t BlockCap, uint8_t Id, uint16_t RingBlocks>
+class RecordChannel : public ChannelStore {
+    static_assert(BlockCap > 0, "RecordChannel needs a non-empty block");
+    static_assert(RingBlocks >= 2, "The ring must hold the active block and at least one full block");
+    static_assert(sizeof(Record) * BlockCap <= CHANNEL_SCRATCH_BYTES, "Block must fit in the shared scratch buffer");
+
+public:
+    static constexpr uint8_t ID = Id;                                 ///< Channel index (key prefix "c<Id>s")
+    static constexpr uint16_t BLOCK_CAP = BlockCap;                   ///< Records per block
+    static constexpr uint16_t RING_BLOCKS = RingBlocks;               ///< Blocks kept before slots are reused
+    static constexpr size_t BLOCK_BYTES = sizeof(Record) * BlockCap;  ///< Bytes per block
+
+    explicit RecordChannel(CounterId bytesCounter)
+        : ChannelStore(Id, sizeof(Record), BlockCap, RingBlocks, block, bytesCounter) {}
+
+    /**
+     * @brief Slot for the next record in the loaded active block. Call rotate() first if isFull().
+     */
+    Record& nextSlot() { return records()[meta_->activeCount]; }
+
+    /**
+     * @brief Count the record written to nextSlot() and persist the active block.
+     */
+    void commitSlot() {
+        meta_->activeCount++;
+        meta_->totalRecords++;
+        saveActive();
+    }
+
+    /**
+     * @brief Most recent record of the loaded active block, or nullptr if the block is empty.
+     */
+    Record* lastInBlock() { return meta_->activeCount ? &records()[meta_->activeCount - 1] : nullptr; }
+
+    /**
+     * @brief Visit stored records [fromRecord, toRecord) in order (0 = first record ever written).
+     *
+     * Records in blocks that were reclaimed or recycled by the ring are skipped. The visitor takes
+     * const Record&; if it returns bool, false stops the traversal. The active block is served
+     * from RAM when loaded, older blocks through the shared scratch buffer.
+     * Visitors must not start another traversal.
+     * @return Number of records visited.
+     */
+    template <typename Visit>
+    uint32_t forEach(Visit&& visit, uint32_t fromRecord = 0, uint32_t toRecord = UINT32_MAX) const {
+        const ChannelMeta& cm = meta();
+        if (toRecord > cm.totalRecords) toRecord = cm.totalRecords;
+        uint64_t stored = (uint64_t)oldestBlock() * BlockCap;
+        if (fromRecord < stored) fromRecord = stored > UINT32_MAX ? UINT32_MAX : (uint32_t)stored;
+        if (fromRecord >= toRecord) return 0;
+        // Record r lives in block r / BlockCap
+        uint32_t visited = 0;
+        ScratchLock scratch;
+        nvs_handle_t h; if (!pm_nvs(&h)) return 0;
+        uint32_t firstBlock = fromRecord / BlockCap;
+        uint32_t lastBlock = (toRecord - 1) / BlockCap;
+        if (lastBlock > cm.activeBlockIndex) lastBlock = cm.activeBlockIndex;
+        for (uint32_t bi = firstBlock; bi <= lastBlock; ++bi) {
+            const uint8_t* src = block_;
+            if (bi != cm.activeBlockIndex || !isLoaded()) {
+                if (!readBlock(h, bi, scratch.buffer())) continue;
+                src = scratch.buffer();
+            }
+            uint32_t base = bi * BlockCap;
+            uint16_t first = (bi == firstBlock) ? (uint16_t)(fromRecord - base) : 0;
+            uint16_t limit = (bi == cm.activeBlockIndex) ? cm.activeCount : BlockCap;
+            if (toRecord - base < limit) limit = (uint16_t)(toRecord - base);
+            const Record* recs = reinterpret_cast<const Record*>(src);
+            for (uint16_t i = first; i < limit; ++i) {
+                ++visited;
+                if (!invoke(visit, recs[i])) return visited;
+            }
+        }
+        return visited;
+    }
+
+    /**
+     * @brief Index of the first record whose key is not less than target (totalRecords if none).
+     *
+     * Records must be stored in non-decreasing key order; key(const Record&) returns the sort key.
+     * Each block's first and last records bound its keys, so a binary search over blocks reads
+     * O(log blocks) blocks through the scratch buffer and finishes with a search inside the
+     * matching block. Only stored blocks are searched.
+     */
+    template <typename KeyOf, typename Key>
+    uint32_t lowerBound(KeyOf&& key, const Key& target) const {
+        const ChannelMeta& cm = meta();
+        if (cm.totalRecords == 0) return 0;
+        uint32_t oldest = oldestBlock();
+        if (oldest > cm.activeBlockIndex) return cm.totalRecords;
+        ScratchLock scratch;
+        nvs_handle_t h; if (!pm_nvs(&h)) return cm.totalRecords;
+        // Kept legacy blocks and the ring window are separate runs; blocks between them were recycled
+        uint32_t ringFrom = std::max(oldest, ringStart());
+        if (oldest < ringFrom) {
+            uint32_t result = searchBlocks(key, target, h, scratch.buffer(), oldest, std::min(legacyEnd_, ringFrom));
+            if (result != cm.totalRecords) return result;
+        }
+        return searchBlocks(key, target, h, scratch.buffer(), ringFrom, cm.activeBlockIndex + 1);
+    }
+
+private:
+    /**
+     * @brief lowerBound() over the stored blocks [lo, hi).
+     */
+    template <typename KeyOf, typename Key>
+    uint32_t searchBlocks(KeyOf& key, const Key& target, nvs_handle_t h, uint8_t* scratch, uint32_t lo, uint32_t hi) const {
+        const ChannelMeta& cm = meta();
+        uint32_t result = cm.totalRecords;
+        // Find the first stored block whose last key reaches target
+        while (lo < hi) {
+            uint32_t bi = lo + (hi - lo) / 2;
+            const uint8_t* src = block_;
+            if (bi != cm.activeBlockIndex || !isLoaded()) {
+                if (!readBlock(h, bi, scratch)) { lo = bi + 1; continue; }
+                src = scratch;
+            }
+            const Record* recs = reinterpret_cast<const Record*>(src);
+            uint16_t count = (bi == cm.activeBlockIndex) ? cm.activeCount : BlockCap;
+            if (count == 0 || key(recs[count - 1]) < target) { lo = bi + 1; continue; }
+            const Record* it = std::lower_bound(recs, recs + count, target,
+                [&key](const Record& r, const Key& t) { return key(r) < t; });
+            result = bi * BlockCap + (uint32_t)(it - recs);
+            hi = bi;
+        }
+        return result;
+    }
+
+    Record* records() { return reinterpret_cast<Record*>(block); }
+
+    template <typename Visit>
+    static bool invoke(Visit& visit, const Record& rec) {
+        if constexpr (std::is_same<decltype(visit(rec)), bool>::value) {
+            return visit(rec);
+        } else {
+            visit(rec);
+            return true;
+        }
+    }
+
+    uint8_t block[BLOCK_BYTES];
+};
@@ -0,0 +1,117 @@
+#include "Rollups.h"
+#include "Logger.h"
+#include <freertos/FreeRTOS.h>
+#include <cstring>
+
+// The open rollups are updated from the loop task and read from BLE callbacks
+static portMUX_TYPE s_rollupsMux = portMUX_INITIALIZER_UNLOCKED;
+
+static inline void putLE16(uint8_t* b, uint16_t v) { b[0] = v & 0xFF; b[1] = (v >> 8) & 0xFF; }
+static inline void putLE32(uint8_t* b, uint32_t v) { b[0] = v & 0xFF; b[1] = (v >> 8) & 0xFF; b[2] = (v >> 16) & 0xFF; b[3] = (v >> 24) & 0xFF; }
+
+Rollups& Rollups::instance() { static Rollups inst; return inst; }
+
+Rollups::Rollups() { reset(); }
+
+void Rollups::reset() {
+    portENTER_CRITICAL(&s_rollupsMux);
+    memset(&st, 0, sizeof(st));
+    portEXIT_CRITICAL(&s_rollupsMux);
+}
+
+Rollups::State Rollups::state() const {
+    portENTER_CRITICAL(&s_rollupsMux);
+    State s = st;
+    portEXIT_CRITICAL(&s_rollupsMux);
+    return s;
+}
+
+void Rollups::restore(const State& s) {
+    portENTER_CRITICAL(&s_rollupsMux);
+    st = s;
+    portEXIT_CRITICAL(&s_rollupsMux);
+}
+
+void Rollups::syncClosed(uint32_t fromRecord) {
+    State s = state();
+    PersistenceManager::instance().forEachRollup([&s](const Record& rec) {
+        if (rec.kind < ROLLUP_KIND_COUNT && rec.key >= s.nextKey[rec.kind]) s.nextKey[rec.kind] = rec.key + 1;
+    }, fromRecord);
+    restore(s);
+}
+
+void Rollups::close(uint8_t kind, bool replay) {
+    const Record& done = st.open[kind];
+    // During replay, a rollup closed live before the reset is already in the channel
+    if (!replay || done.key >= st.nextKey[kind]) {
+        PersistenceManager::instance().appendRollup(done);
+        Logger::infof("[Rollups] Closed %s %u: %u puffs", kind == ROLLUP_PHASE ? "phase" : "day", (unsigned)done.key, (unsigned)done.count);
+    }
+    if (done.key >= st.nextKey[kind]) st.nextKey[kind] = done.key + 1;
+}
+
+void Rollups::onPuff(uint32_t tSec, uint32_t durationMs, uint16_t phaseIndex, bool replay) {
+    for (uint8_t kind = 0; kind < ROLLUP_KIND_COUNT; ++kind) {
+        uint32_t key = keyFor((RollupKind)kind, tSec, phaseIndex);
+        if (st.open[kind].count > 0 && st.open[kind].key != key) close(kind, replay);
+
+        portENTER_CRITICAL(&s_rollupsMux);
+        Record& r = st.open[kind];
+        if (r.count == 0 || r.key != key) {
+            memset(&r, 0, sizeof(r));
+            r.kind = kind;
+            r.key = key;
+            r.minDurationMs = UINT32_MAX;
+            r.firstSec = tSec;
+        }
+        if (r.count < UINT16_MAX) r.count++;
+        r.sumDurationMs += durationMs;
+        if (durationMs < r.minDurationMs) r.minDurationMs = durationMs;
+        if (durationMs > r.maxDurationMs) r.maxDurationMs = durationMs;
+        r.lastSec = tSec;
+        portEXIT_CRITICAL(&s_rollupsMux);
+    }
+}
+
+size_t Rollups::query(RollupKind kind, uint32_t fromKey, Record* out, size_t maxCount) const {
+    if (!out || maxCount == 0 || kind >= ROLLUP_KIND_COUNT) return 0;
+    size_t n = 0;
+    PersistenceManager::instance().forEachRollup([&](const Record& rec) {
+        if (rec.kind == kind && rec.key >= fromKey) out[n++] = rec;
+        return n < maxCount;
+    });
+    State s = state();
+    if (n < maxCount && s.open[kind].count > 0 && s.open[kind].key >= fromKey) out[n++] = s.open[kind];
+    return n;
+}
+
+static void encodeEntry(uint8_t* b, const Rollups::Record& r) {
+    b[0] = r.kind;
+    putLE32(&b[1], r.key);
+    putLE16(&b[5], r.count);
+    putLE32(&b[7], r.sumDurationMs);
+    putLE16(&b[11], (uint16_t)(r.minDurationMs > UINT16_MAX ? UINT16_MAX : r.minDurationMs));
+    putLE16(&b[13], (uint16_t)(r.maxDurationMs > UINT16_MAX ? UINT16_MAX : r.maxDurationMs));
+    putLE32(&b[15], r.firstSec);
+    putLE32(&b[19], r.lastSec);
+}
+
+size_t Rollups::serialize(RollupKind kind, uint32_t fromKey, size_t maxCount, uint8_t* out, size_t cap) const {
+    if (!out || cap < ROLLUP_HEADER) return 0;
+    size_t capacity = (cap - ROLLUP_HEADER) / ROLLUP_ENTRY;
+    if (maxCount > capacity) maxCount = capacity;
+    if (maxCount > UINT8_MAX) maxCount = UINT8_MAX;
+    // Encode straight into the frame; no intermediate record buffer
+    size_t n = 0;
+    if (maxCount > 0 && kind < ROLLUP_KIND_COUNT) {
+        PersistenceManager::instance().forEachRollup([&](const Record& rec) {
+            if (rec.kind == kind && rec.key >= fromKey) encodeEntry(&out[ROLLUP_HEADER + ROLLUP_ENTRY * n++], rec);
+            return n < maxCount;
+        });
+        State s = state();
+        if (n < maxCount && s.open[kind].count > 0 && s.open[kind].key >= fromKey) encodeEntry(&out[ROLLUP_HEADER + ROLLUP_ENTRY * n++], s.open[kind]);
+    }
+    out[0] = ROLLUPS_FORMAT_VERSION;
+    out[1] = (uint8_t)n;
+    return ROLLUP_HEADER + ROLLUP_ENTRY * n;
+}
@@ -0,0 +1,110 @@
+#pragma once
+
+/**
+ * @file Rollups.h
+ * @brief Incremental per-phase and per-day puff aggregates.
+ *
+ * Each puff updates one open rollup per kind. When a puff lands in a new phase or UTC day the
+ * open rollup is closed and appended to the rollup channel, so queries never scan puff history.
+ * Served by the BLE rollups characteristic (ROLLUPS_CHAR_UUID) and decoded with tools/rollups.py.
+ *
+ * @author Vetra Firmware Team
+ * @copyright Copyright (c) 2025 Vetra
+ */
+
+// --- Standard Library Includes ---
+#include <Arduino.h>
+#include <cstdint>
+
+// --- Project Includes ---
+#include "PersistenceManager.h"
+
+// -----------------------------------------------------------------------------
+// Rollup Constants
+// -----------------------------------------------------------------------------
+
+/// @name Wire Format
+///@{
+static constexpr uint8_t ROLLUPS_FORMAT_VERSION = 1; ///< Wire format version of Rollups::serialize()
+static constexpr size_t ROLLUP_HEADER = 2;           ///< [format][count]
+static constexpr size_t ROLLUP_ENTRY = 23;           ///< Bytes per serialized rollup
+///@}
+
+/// @brief Seconds per rollup day (days are UTC, keyed by epoch seconds / 86400)
+static constexpr uint32_t ROLLUP_DAY_SECONDS = 86400;
+
+// -----------------------------------------------------------------------------
+// Rollups Class
+// -----------------------------------------------------------------------------
+
+/**
+ * @class Rollups
+ * @brief Singleton holding the open rollups; closed rollups live in the persistence rollup channel.
+ */
+class Rollups {
+public:
+    using Record = PersistenceManager::RollupRecord;
+    using State = PersistenceManager::RollupState;
+
+    /**
+     * @brief Get singleton instance of Rollups.
+     */
+    static Rollups& instance();
+
+    /**
+     * @brief Fold a puff into the open rollups, closing any whose phase or day has ended.
+     * @param replay True while replaying the journal at boot: closed rollups already persisted are not appended again.
+     */
+    void onPuff(uint32_t tSec, uint32_t durationMs, uint16_t phaseIndex, bool replay = false);
+
+    /**
+     * @brief Forget the open rollups (nothing accumulated yet).
+     */
+    void reset();
+
+    /**
+     * @brief Open rollups and close cursors, for checkpoints and the resume snapshot.
+     */
+    State state() const;
+
+    /**
+     * @brief Restore state saved by state().
+     */
+    void restore(const State& s);
+
+    /**
+     * @brief Advance the close cursors past rollups persisted from record fromRecord on.
+     */
+    void syncClosed(uint32_t fromRecord);
+
+    /**
+     * @brief Rollups of one kind with key >= fromKey, oldest first; the open rollup comes last.
+     * @return Number of rollups written to out.
+     */
+    size_t query(RollupKind kind, uint32_t fromKey, Record* out, size_t maxCount) const;
+
+    /**
+     * @brief Serialize query() results (little-endian).
+     *
+     * Layout: [format(1)][count(1)] + count x [kind(1)][key(4)][count(2)][sumMs(4)]
+     * [minMs(2)][maxMs(2)][firstSec(4)][lastSec(4)]; min/max saturate at 65535 ms.
+     * @return Bytes written (0 if out cannot hold the header).
+     */
+    size_t serialize(RollupKind kind, uint32_t fromKey, size_t maxCount, uint8_t* out, size_t cap) const;
+
+    /**
+     * @brief Bucket key of a puff for one rollup kind.
+     */
+    static uint32_t keyFor(RollupKind kind, uint32_t tSec, uint16_t phaseIndex) {
+        return (kind == ROLLUP_PHASE) ? phaseIndex : tSec / ROLLUP_DAY_SECONDS;
+    }
+
+private:
+    Rollups();
+    Rollups(const Rollups&) = delete;
+    Rollups& operator=(const Rollups&) = delete;
+
+    void close(uint8_t kind, bool replay);
+
+    State st;
+};
@@ -0,0 +1,42 @@
+#include "SleepPolicy.h"
+
+SleepPolicy& SleepPolicy::instance() { static SleepPolicy inst; return inst; }
+
+void SleepPolicy::noteActivity(uint32_t nowMs) {
+    lastActivityMs = nowMs;
+}
+
+uint32_t SleepPolicy::idleLimitMs(const Inputs& in) {
+    if (in.connected) return SLEEP_CONNECTED_IDLE_MS;
+    return in.bleActive ? SLEEP_ADVERTISING_IDLE_MS : SLEEP_IDLE_MS;
+}
+
+uint32_t SleepPolicy::idleMs(const Inputs& in) const {
+    uint32_t sinceDevice = in.nowMs - lastActivityMs;
+    uint32_t sinceBle = in.bleActive ? in.nowMs - in.lastBleInteractionMs : UINT32_MAX;
+    return sinceDevice < sinceBle ? sinceDevice : sinceBle;
+}
+
+SleepPolicy::Decision SleepPolicy::decide(const Inputs& in) {
+    if (in.eventsPending || in.debounceActive || in.puffInProgress || in.buttonHeld) {
+        noteActivity(in.nowMs);
+        return Decision{SLEEP_NONE, 0};
+    }
+    if (in.notifyPending) return Decision{SLEEP_NONE, 0};
+
+    uint32_t limit = idleLimitMs(in);
+    uint32_t idle = idleMs(in);
+    uint32_t wait;
+    if (idle >= limit) {
+        if (in.msToNextPhase >= SLEEP_MIN_DEEP_MS) return Decision{SLEEP_DEEP, 0};
+        // The boundary is about to pass: handle it awake, then sleep with the next phase armed
+        wait = in.msToNextPhase;
+    } else {
+        wait = limit - idle;
+        if (in.msToNextPhase < wait) wait = in.msToNextPhase;
+    }
+    // With the radio up the loop blocks and esp_pm light sleeps between BLE events
+    if (in.bleActive) return Decision{SLEEP_NONE, wait < SLEEP_BLOCK_MAX_MS ? wait : (uint32_t)SLEEP_BLOCK_MAX_MS};
+    if (wait < SLEEP_LIGHT_MIN_MS) return Decision{SLEEP_NONE, wait};
+    return Decision{SLEEP_LIGHT, wait < SLEEP_LIGHT_MAX_MS ? wait : (uint32_t)SLEEP_LIGHT_MAX_MS};
+}
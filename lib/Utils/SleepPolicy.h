@@ -0,0 +1,149 @@
+#pragma once
+
+/**
+ * @file SleepPolicy.h
+ * @brief Decides when the device may light or deep sleep, from what is still in flight.
+ *
+ * A puff in progress, an open debounce window, undrained edge events, a held button and log
+ * lines owed to a subscribed client all keep the device awake. Otherwise it deep sleeps once
+ * idle for the threshold of its BLE state (off, advertising, connected), unless a phase
+ * boundary is about to pass. While waiting it light sleeps with the radio off; with the radio
+ * up the loop blocks until the next deadline or edge and esp_pm light sleeps between BLE
+ * events. The clock is an input, so the policy runs unchanged against a simulated clock in tests.
+ *
+ * @author Vetra Firmware Team
+ * @copyright Copyright (c) 2025 Vetra
+ */
+
+// --- Standard Library Includes ---
+#include <Arduino.h>
+#include <cstdint>
+
+// -----------------------------------------------------------------------------
+// Sleep Policy Constants
+// -----------------------------------------------------------------------------
+
+/// @name Idle Thresholds
+///@{
+// Idle time before deep sleep with the radio off
+#ifndef SLEEP_IDLE_MS
+#define SLEEP_IDLE_MS                     10000
+#endif
+// Idle time before deep sleep while advertising with no client
+#ifndef SLEEP_ADVERTISING_IDLE_MS
+#define SLEEP_ADVERTISING_IDLE_MS         30000
+#endif
+// Idle time before deep sleep with a client connected (no requests)
+#ifndef SLEEP_CONNECTED_IDLE_MS
+#define SLEEP_CONNECTED_IDLE_MS           60000
+#endif
+// A phase boundary closer than this is waited out awake instead of waking again right after
+#ifndef SLEEP_MIN_DEEP_MS
+#define SLEEP_MIN_DEEP_MS                 3000
+#endif
+// Shortest light sleep worth entering
+#ifndef SLEEP_LIGHT_MIN_MS
+#define SLEEP_LIGHT_MIN_MS                20
+#endif
+// Longest single light sleep (the loop re-evaluates after each)
+#ifndef SLEEP_LIGHT_MAX_MS
+#define SLEEP_LIGHT_MAX_MS                5000
+#endif
+// Longest single blocking wait with the radio up (bounds log streaming latency)
+#ifndef SLEEP_BLOCK_MAX_MS
+#define SLEEP_BLOCK_MAX_MS                2000
+#endif
+///@}
+
+/// @name Power Management
+///@{
+// Let esp_pm light sleep whenever every task is blocked, including with BLE up
+#ifndef PM_AUTO_LIGHT_SLEEP
+#define PM_AUTO_LIGHT_SLEEP               1
+#endif
+// CPU clock while any task runs
+#ifndef PM_MAX_FREQ_MHZ
+#define PM_MAX_FREQ_MHZ                   160
+#endif
+// CPU clock while idle and not light sleeping
+#ifndef PM_MIN_FREQ_MHZ
+#define PM_MIN_FREQ_MHZ                   40
+#endif
+///@}
+
+/**
+ * @enum SleepAction
+ * @brief What the loop should do after this iteration.
+ */
+enum SleepAction : uint8_t {
+    SLEEP_NONE,    ///< Stay awake; block for Decision::durationMs or until an edge
+    SLEEP_LIGHT,   ///< Light sleep for Decision::durationMs, waking on the puff and button pins
+    SLEEP_DEEP,    ///< Enter deep sleep
+};
+
+// -----------------------------------------------------------------------------
+// SleepPolicy Class
+// -----------------------------------------------------------------------------
+
+/**
+ * @class SleepPolicy
+ * @brief Singleton tracking the last activity and turning loop state into a sleep decision.
+ */
+class SleepPolicy {
+public:
+    /**
+     * @brief State sampled at the end of a loop iteration.
+     */
+    struct Inputs {
+        uint32_t nowMs;              ///< millis()
+        uint32_t lastBleInteractionMs; ///< Last BLE request or connection event (millis())
+        uint32_t msToNextPhase;      ///< Until the next phase boundary (UINT32_MAX = none)
+        bool bleActive;              ///< BLE stack up (advertising or connected)
+        bool connected;              ///< A client is connected
+        bool notifyPending;          ///< Lines or notifications still owed to a subscribed client
+        bool eventsPending;          ///< Edge events raised by an ISR and not yet handled
+        bool debounceActive;         ///< Debounce window open (a puff is being timed)
+        bool puffInProgress;         ///< Rising edge seen, puff not yet persisted
+        bool buttonHeld;             ///< Button down (a long press may still be measured)
+    };
+
+    /**
+     * @brief Decision for the loop.
+     */
+    struct Decision {
+        SleepAction action;
+        uint32_t durationMs;         ///< Light sleep length, or how long SLEEP_NONE may block (0 = poll)
+    };
+
+    /**
+     * @brief Get singleton instance of SleepPolicy.
+     */
+    static SleepPolicy& instance();
+
+    /**
+     * @brief Record user or device activity (wake, edges) at nowMs.
+     */
+    void noteActivity(uint32_t nowMs);
+
+    /**
+     * @brief Decide what to do next; anything in flight counts as activity.
+     */
+    Decision decide(const Inputs& in);
+
+    /**
+     * @brief Idle threshold for the BLE state in the inputs.
+     */
+    static uint32_t idleLimitMs(const Inputs& in);
+
+    /**
+     * @brief Milliseconds since the last activity (device or BLE) at in.nowMs.
+     */
+    uint32_t idleMs(const Inputs& in) const;
+
+private:
+    SleepPolicy() = default;
+    SleepPolicy(const SleepPolicy&) = delete;
+    SleepPolicy& operator=(const SleepPolicy&) = delete;
+
+    uint32_t lastActivityMs = 0;
+};
@@ -0,0 +1,51 @@
+#include "Timebase.h"
+#include <freertos/FreeRTOS.h>
+#include <sys/time.h>
+
+// The offset is set from the BLE task (NTP) and read from the loop
+static portMUX_TYPE s_timebaseMux = portMUX_INITIALIZER_UNLOCKED;
+
+Timebase& Timebase::instance() { static Timebase inst; return inst; }
+
+Timebase::Timebase() {
+    // The only gettimeofday: the system time carries the wall clock across deep sleep
+    struct timeval tv;
+    gettimeofday(&tv, nullptr);
+    offsetUs = (int64_t)tv.tv_sec * 1000000LL + tv.tv_usec - (int64_t)monoUs();
+}
+
+uint32_t Timebase::epochAt(uint64_t atMonoUs) const {
+    portENTER_CRITICAL(&s_timebaseMux);
+    int64_t offset = offsetUs;
+    portEXIT_CRITICAL(&s_timebaseMux);
+    int64_t us = (int64_t)atMonoUs + offset;
+    return us < 0 ? 0 : (uint32_t)(us / 1000000LL);
+}
+
+uint64_t Timebase::epochUs() const {
+    portENTER_CRITICAL(&s_timebaseMux);
+    int64_t offset = offsetUs;
+    portEXIT_CRITICAL(&s_timebaseMux);
+    int64_t us = (int64_t)monoUs() + offset;
+    return us < 0 ? 0 : (uint64_t)us;
+}
+
+Timebase::Now Timebase::sample() {
+    Now n;
+    n.monoUs = monoUs();
+    n.epochSec = epochAt(n.monoUs);
+    cached = n;
+    return n;
+}
+
+bool Timebase::setEpoch(uint32_t epochSec) {
+    struct timeval tv;
+    tv.tv_sec = epochSec;
+    tv.tv_usec = 0;
+    if (settimeofday(&tv, nullptr) != 0) return false;
+    int64_t offset = (int64_t)epochSec * 1000000LL - (int64_t)monoUs();
+    portENTER_CRITICAL(&s_timebaseMux);
+    offsetUs = offset;
+    portEXIT_CRITICAL(&s_timebaseMux);
+    return true;
+}
@@ -0,0 +1,89 @@
+#pragma once
+
+/**
+ * @file Timebase.h
+ * @brief Monotonic microsecond clock with a wall-clock offset, sampled once per loop iteration.
+ *
+ * Durations are measured on esp_timer, which never jumps. The wall clock is the monotonic clock
+ * plus an offset that changes only when the time is set (NTP write, restore at boot), so a sync
+ * in the middle of a puff moves timestamps but not durations. The loop samples one Now per
+ * iteration and passes it to the state machine handlers.
+ *
+ * @author Vetra Firmware Team
+ * @copyright Copyright (c) 2025 Vetra
+ */
+
+// --- Standard Library Includes ---
+#include <Arduino.h>
+#include <cstdint>
+
+// --- ESP32 Includes ---
+#include <esp_timer.h>
+
+// -----------------------------------------------------------------------------
+// Timebase Class
+// -----------------------------------------------------------------------------
+
+/**
+ * @class Timebase
+ * @brief Singleton owning the wall-clock offset; safe to read from any task.
+ */
+class Timebase {
+public:
+    /**
+     * @brief One instant on both clocks.
+     */
+    struct Now {
+        uint64_t monoUs;             ///< esp_timer microseconds since boot
+        uint32_t epochSec;           ///< Wall clock at monoUs
+    };
+
+    /**
+     * @brief Get singleton instance of Timebase (seeds the offset from the system time once).
+     */
+    static Timebase& instance();
+
+    /**
+     * @brief Monotonic microseconds since boot; unaffected by time syncs.
+     */
+    static uint64_t monoUs() { return (uint64_t)esp_timer_get_time(); }
+
+    /**
+     * @brief Take a fresh sample and keep it as current().
+     */
+    Now sample();
+
+    /**
+     * @brief Sample taken by the last sample() call (the loop's "now").
+     */
+    Now current() const { return cached; }
+
+    /**
+     * @brief Wall clock in microseconds since the Unix epoch, read fresh.
+     */
+    uint64_t epochUs() const;
+
+    /**
+     * @brief Wall clock in seconds since the Unix epoch, read fresh.
+     */
+    uint32_t epochSec() const { return (uint32_t)(epochUs() / 1000000ULL); }
+
+    /**
+     * @brief Wall clock at a monotonic instant.
+     */
+    uint32_t epochAt(uint64_t atMonoUs) const;
+
+    /**
+     * @brief Set the wall clock (and the system time kept across deep sleep).
+     * @return True if the system time was set.
+     */
+    bool setEpoch(uint32_t epochSec);
+
+private:
+    Timebase();
+    Timebase(const Timebase&) = delete;
+    Timebase& operator=(const Timebase&) = delete;
+
+    int64_t offsetUs = 0;            ///< Wall clock minus monotonic clock
+    Now cached{};
+};
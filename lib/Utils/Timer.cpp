@@ -2,32 +2,92 @@
 #include "Logger.h"
 #include "PersistenceManager.h"
 #include <ctime>
+#include <cstring>
+#include <freertos/FreeRTOS.h>
+
+// Local day the formatter is positioned on; only the time of day is computed per call
+struct TimestampDay {
+    uint32_t midnightSec;    ///< Epoch of local midnight at the cached UTC offset
+    uint32_t fromSec;        ///< First epoch the cache covers
+    uint32_t toSec;          ///< First epoch past the cache (fromSec == toSec: empty)
+    char date[12];           ///< "YYYY-MM-DD "
+};
+static TimestampDay s_day;
+// Formatted from the loop and from the BLE task (NTP writes)
+static portMUX_TYPE s_dayMux = portMUX_INITIALIZER_UNLOCKED;
+
+static uint32_t secondOfDay(const struct tm& t) { return (uint32_t)(t.tm_hour * 3600 + t.tm_min * 60 + t.tm_sec); }
+
+// True if epochSec is still (epochSec - midnightSec) into the cached day
+static bool sameOffset(uint32_t epochSec, uint32_t midnightSec) {
+    time_t rawtime = (time_t)epochSec;
+    struct tm t;
+    return localtime_r(&rawtime, &t) && secondOfDay(t) == epochSec - midnightSec;
+}
+
+static void putTwoDigits(char* p, uint32_t v) {
+    p[0] = (char)('0' + v / 10);
+    p[1] = (char)('0' + v % 10);
+}
+
+static bool fillDay(uint32_t epochSec, TimestampDay& day) {
+    time_t rawtime = (time_t)epochSec;
+    struct tm t;
+    if (!localtime_r(&rawtime, &t)) return false;
+    if (strftime(day.date, sizeof(day.date), "%Y-%m-%d ", &t) != sizeof(day.date) - 1) return false;
+    day.midnightSec = epochSec - secondOfDay(t);
+    day.fromSec = day.midnightSec;
+    day.toSec = day.midnightSec + 86400;
+    if (sameOffset(day.fromSec, day.midnightSec) && sameOffset(day.toSec - 1, day.midnightSec)) return true;
+    // DST change today: cover only the current local hour
+    day.fromSec = epochSec - (uint32_t)(t.tm_min * 60 + t.tm_sec);
+    day.toSec = day.fromSec + 3600;
+    if (!sameOffset(day.fromSec, day.midnightSec) || !sameOffset(day.toSec - 1, day.midnightSec)) day.toSec = day.fromSec = epochSec;
+    return true;
+}
 
 bool epochToTimestamp(uint32_t epochSec, char* out, size_t outSize) {
     if (!out || outSize == 0) {
         Logger::error("[Timer] Invalid output buffer or size");
         return false;
     }
-    time_t rawtime = (time_t)epochSec;
-    struct tm * timeinfo = localtime(&rawtime);
-    if (!timeinfo) return false;
-    size_t n = strftime(out, outSize, "%Y-%m-%d %H:%M:%S", timeinfo);
-    return n > 0;
+    static constexpr size_t LEN = 19; // "YYYY-MM-DD HH:MM:SS"
+    if (outSize <= LEN) return false;
+    portENTER_CRITICAL(&s_dayMux);
+    TimestampDay day = s_day;
+    portEXIT_CRITICAL(&s_dayMux);
+    if (epochSec < day.fromSec || epochSec >= day.toSec) {
+        // localtime_r only when the time leaves the cached day
+        if (!fillDay(epochSec, day)) return false;
+        if (day.fromSec == day.toSec) {
+            time_t rawtime = (time_t)epochSec;
+            struct tm t;
+            if (!localtime_r(&rawtime, &t)) return false;
+            return strftime(out, outSize, "%Y-%m-%d %H:%M:%S", &t) > 0;
+        }
+        portENTER_CRITICAL(&s_dayMux);
+        s_day = day;
+        portEXIT_CRITICAL(&s_dayMux);
+    }
+    uint32_t sec = epochSec - day.midnightSec;
+    memcpy(out, day.date, 11);
+    putTwoDigits(out + 11, sec / 3600);
+    out[13] = ':';
+    putTwoDigits(out + 14, sec / 60 % 60);
+    out[16] = ':';
+    putTwoDigits(out + 17, sec % 60);
+    out[LEN] = '\0';
+    return true;
 }
 
 bool updateSystemTime(uint32_t newEpochSeconds) {
-    struct timeval tv;
-    tv.tv_sec = newEpochSeconds;
-    tv.tv_usec = 0;
-
     uint32_t nowEpoch = epochSeconds();
     if (nowEpoch >= newEpochSeconds) {
         Logger::info("[Timer] Current system time is up-to-date or ahead; no update needed.");
         return false;
     }
-    
 
-    if (settimeofday(&tv,nullptr) != 0) {
+    if (!Timebase::instance().setEpoch(newEpochSeconds)) {
         Logger::error("[Timer] Failed to update system time.");
         return false;
     }
@@ -5,7 +5,8 @@
  * @file Timer.h
  * @brief Timer utility functions for timekeeping and formatting.
  *
- * Provides helpers for NTP/system time, epoch formatting, and wall time access.
+ * Provides helpers for NTP/system time, epoch formatting, and wall time access. Wall time is
+ * read from the Timebase (monotonic clock plus offset), not from gettimeofday.
  *
  * @author Vetra Firmware Team
  * @copyright Copyright (c) 2025 Vetra
@@ -13,7 +14,9 @@
 
 // --- Standard Library Includes ---
 #include <Arduino.h>
-#include <sys/time.h>
+
+// --- Project Includes ---
+#include "Timebase.h"
 
 // -----------------------------------------------------------------------------
 // Timer/NTP Helper API
@@ -36,13 +39,13 @@ bool updateSystemTime(uint32_t newEpochSeconds);
 bool epochToTimestamp(uint32_t epochSec, char* out, size_t outSize);
 
 /**
- * @brief Get wall/RTC milliseconds since epoch (may reset if time sync changes).
+ * @brief Get wall milliseconds since epoch (jumps when the time is set; use Timebase::monoUs() for durations).
  * @return Milliseconds since Unix epoch.
  */
-inline uint64_t epochMillis() { struct timeval tv; gettimeofday(&tv,nullptr); return ((uint64_t)tv.tv_sec * 1000) + (tv.tv_usec / 1000); }
+inline uint64_t epochMillis() { return Timebase::instance().epochUs() / 1000ULL; }
 
 /**
- * @brief Get wall/RTC seconds since epoch (may reset if time sync changes).
+ * @brief Get wall seconds since epoch (jumps when the time is set).
  * @return Seconds since Unix epoch.
  */
-inline uint32_t epochSeconds() { struct timeval tv; gettimeofday(&tv,nullptr); return (uint32_t)tv.tv_sec; }
\ No newline at end of file
+inline uint32_t epochSeconds() { return Timebase::instance().epochSec(); }
\ No newline at end of file
@@ -7,10 +7,24 @@
 #include "App.h"
 #include <Arduino.h>
 #include <esp_sleep.h>
+#include <esp_pm.h>
+#include <esp_idf_version.h>
+#include <hal/gpio_ll.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
 #include "PersistenceManager.h"
 #include "Timer.h"
 #include "LogBuffer.h"
 #include "Debounce.h"
+#include "BootProfiler.h"
+#include "Metrics.h"
+#include "Counters.h"
+#include "AllocTracker.h"
+#include "AdvertisePolicy.h"
+#include "SleepPolicy.h"
+#include "EnergyModel.h"
+#include "Timebase.h"
+#include "ClockDrift.h"
 
 // -----------------------------------------------------------------------------
 // Global ISR Flags
@@ -19,23 +33,43 @@
 static volatile bool s_wakeup_pending = false;
 static volatile bool s_puff_rising_pending = false;
 static volatile bool s_puff_falling_pending = false;
+static volatile uint32_t s_puff_rising_isr_us = 0;
+static TaskHandle_t s_loopTask = nullptr;   ///< Task running App::loop, notified by the ISRs
 
 // -----------------------------------------------------------------------------
 // ISR Implementations
 // -----------------------------------------------------------------------------
 
+// The inputs use level interrupts, which also wake automatic and explicit light sleep (edges
+// are missed while the GPIO clock is gated). Each ISR re-arms its pin for the opposite level,
+// so the pair behaves as edge detection.
+static inline void IRAM_ATTR armLevel(int pin, bool high) {
+    gpio_ll_set_intr_type(&GPIO, (gpio_num_t)pin, high ? GPIO_INTR_HIGH_LEVEL : GPIO_INTR_LOW_LEVEL);
+}
+
+// Unblock the loop waiting in App::waitForEvent()
+static inline void IRAM_ATTR wakeLoopFromIsr() {
+    BaseType_t woken = pdFALSE;
+    if (s_loopTask) vTaskNotifyGiveFromISR(s_loopTask, &woken);
+    if (woken == pdTRUE) portYIELD_FROM_ISR();
+}
+
 /**
  * @brief Unified ISR for HEAT_PIN.
  */
 void IRAM_ATTR heatIsr() {
     int state = digitalRead(HEAT_PIN);
+    armLevel(HEAT_PIN, state == LOW);
+    Counters::addFromIsr(CNT_EDGES_RAW);
     if (DebounceManager::instance().active()) {
         DebounceManager::instance().touch();
         return;
     } else if (state == HIGH) {
         // Logger::infof("Device state: %s", Device::getState());
         s_puff_rising_pending = true;
+        s_puff_rising_isr_us = Metrics::nowUs();
         DebounceManager::instance().start(s_puff_falling_pending, true);
+        wakeLoopFromIsr();
     }
     // if (state == HIGH) {
     //     s_puff_rising_pending = true;
@@ -48,7 +82,38 @@ void IRAM_ATTR heatIsr() {
  * @brief Wakeup ISR.
  */
 void IRAM_ATTR wakeupISR() {
+    bool high = digitalRead(BUTTON_PIN) == HIGH;
+    armLevel(BUTTON_PIN, !high);
+    if (!high) return;
     s_wakeup_pending = true;
+    wakeLoopFromIsr();
+}
+
+/**
+ * @brief StateMachine listener: drive the coil from inside the transition.
+ */
+static void driveCoil(state_t state) {
+    if (state == LOCKDOWN) {
+        Device::lockCoil();
+    } else {
+        Device::unlockCoil();
+    }
+}
+
+/**
+ * @brief Rewrite the coil pin for a state regardless of the cached Device state.
+ */
+static void syncCoil(state_t state) {
+    Device::syncCoil(state == LOCKDOWN ? COIL_LOCKED : COIL_UNLOCKED);
+}
+
+/**
+ * @brief Attach the input ISRs armed for the level opposite the current one, with light-sleep wake.
+ */
+static void attachInputs() {
+    attachInterrupt(BUTTON_PIN, wakeupISR, digitalRead(BUTTON_PIN) == HIGH ? ONLOW_WE : ONHIGH_WE);
+    attachInterrupt(HEAT_PIN, heatIsr, digitalRead(HEAT_PIN) == HIGH ? ONLOW_WE : ONHIGH_WE);
+    esp_sleep_enable_gpio_wakeup();
 }
 
 // -----------------------------------------------------------------------------
@@ -56,11 +121,29 @@ void IRAM_ATTR wakeupISR() {
 // -----------------------------------------------------------------------------
 
 void App::setup() {
+    esp_sleep_wakeup_cause_t wakeCause = esp_sleep_get_wakeup_cause();
+    BootProfiler::instance().begin((uint8_t)wakeCause);
+
     // Initialize singletons and services
     Device::setupPins();
-    puffCounterSm = &StateMachine::instance();
+
+    if (wakeCause == ESP_SLEEP_WAKEUP_TIMER) {
+        handleTimerWakeup();
+        return;
+    }
+
+    // Before the BLE controller comes up, so it registers with automatic light sleep
+    configurePowerManagement();
+
+    // When BLE is wanted regardless of stored state, bring it up on its own task while NVS is
+    // loaded here; characteristic handlers wait on the state-ready barrier released below
     bleManager = &BLEManager::instance();
+    BleStartReason bootReason = AdvertisePolicy::instance().atBoot((uint8_t)wakeCause);
+    if (bootReason != BLE_START_NONE) startBle(bootReason);
 
+    // Drift-correct the clock before the state machine reads it
+    correctClockDrift();
+    puffCounterSm = &StateMachine::instance();
     auto& persistenceManager = PersistenceManager::instance();
     persistenceManager.init();
 
@@ -82,23 +165,25 @@ void App::setup() {
         Logger::infof("[App] System time up-to-date (now=%s/%u, persisted=%s/%u); skipping restore.", nowTs, nowEpoch, lastTs, lastEpoch);
     }
 
-    // Configure deep-sleep wake on BUTTON_PIN going HIGH
-#if SOC_GPIO_SUPPORT_DEEPSLEEP_WAKEUP
-    esp_err_t wakeErr = esp_deep_sleep_enable_gpio_wakeup(1ULL << BUTTON_PIN, ESP_GPIO_WAKEUP_GPIO_HIGH);
-    if (wakeErr == ESP_OK) {
-        Logger::infof("[App] Wake source configured: ext1 GPIO %d HIGH", BUTTON_PIN);
-    } else {
-        Logger::errorf("[App] Failed to configure wake source (ext1) on GPIO %d, err=%d", BUTTON_PIN, (int)wakeErr);
-    }
-    #endif  
-
-    attachInterrupt(BUTTON_PIN, wakeupISR, RISING);
-    attachInterrupt(HEAT_PIN, heatIsr, CHANGE);
+    s_loopTask = xTaskGetCurrentTaskHandle();
+    attachInputs();
 
-    bleManager->startService();
+    // Write the pin once unconditionally; from here on every transition drives the coil itself
+    syncCoil(puffCounterSm->getCurrentState());
+    puffCounterSm->setStateListener(driveCoil);
+    BootProfiler::instance().mark(BOOT_COIL_READY);
+    uint32_t coilReadyUs = micros();
+    bleManager->markStateReady();
+    SleepPolicy::instance().noteActivity(millis());
+    Logger::infof("[App] Time-to-coil-ready: %u us", (unsigned)coilReadyUs);
+    if (!bleManager->isActive()) pollAdvertisePolicy();
 }
 
 void App::loop() {
+    AllocTracker::Scope alloc(ALLOC_APP);
+    // One clock sample per iteration; every handler below sees the same instant
+    Timebase::Now now = Timebase::instance().sample();
+    uint32_t loopStartUs = (uint32_t)now.monoUs;
     if (!bleManager) bleManager = &BLEManager::instance();
     if (!puffCounterSm) puffCounterSm = &StateMachine::instance();
 
@@ -107,48 +192,182 @@ void App::loop() {
 
     // Drain ISR events in task context
     bool wake = false, rise = false, fall = false;
+    uint32_t riseIsrUs = 0;
     noInterrupts();
     if (s_wakeup_pending) { wake = true; s_wakeup_pending = false; }
-    if (s_puff_rising_pending) { rise = true; s_puff_rising_pending = false; }
+    if (s_puff_rising_pending) { rise = true; s_puff_rising_pending = false; riseIsrUs = s_puff_rising_isr_us; }
     if (s_puff_falling_pending) { fall = true; s_puff_falling_pending = false; }
     interrupts();
+    if (wake || rise || fall) SleepPolicy::instance().noteActivity((uint32_t)(now.monoUs / 1000ULL));
+    if (rise || fall) Counters::instance().add(CNT_EDGES_DEBOUNCED, (uint32_t)rise + (uint32_t)fall);
     if (wake) handleWakeup();
-    if (rise) handlePuffCountRising();
-    if (fall) handlePuffCountFalling();
+    if (rise) {
+        Metrics::instance().record(METRIC_ISR_TO_HANDLER, Metrics::nowUs() - riseIsrUs);
+        handlePuffCountRising(now);
+    }
+    if (fall) handlePuffCountFalling(now);
+
+    puffCounterSm->incrementValidPhase(now);
+    if (!bleManager->isActive()) pollAdvertisePolicy();
 
-    if (bleManager->connectionTimeOut()) {
+    bleManager->pumpLogs();
+    Metrics::instance().record(METRIC_LOOP_ITERATION, Metrics::nowUs() - loopStartUs);
+
+    SleepPolicy::Decision next = SleepPolicy::instance().decide(sleepInputs());
+    if (next.action == SLEEP_DEEP) {
         if (bleManager->isActive()) bleManager->cleanupService();
-        // Store current epoch (requires prior NTP for accuracy)
-        PersistenceManager::instance().recordEpoch(epochSeconds());
-        Logger::info("[App] Entering deep sleep");
-        esp_deep_sleep_start();
+        enterDeepSleep();
+    } else if (next.action == SLEEP_LIGHT) {
+        lightSleep(next.durationMs);
+    } else {
+        waitForEvent(next.durationMs ? next.durationMs : WAKE_DELAY_MS);
     }
-    updateDeviceState();
-    puffCounterSm->incrementValidPhase();
+}
 
-    bleManager->pumpLogs();
-    delay(WAKE_DELAY_MS);
+void App::waitForEvent(uint32_t ms) {
+    // An edge raised since the drain above left a notification, so this returns at once
+    uint32_t startUs = Metrics::nowUs();
+    ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(ms));
+    EnergyModel::instance().addWait(Metrics::nowUs() - startUs);
+}
+
+void App::configurePowerManagement() {
+#if PM_AUTO_LIGHT_SLEEP
+#if ESP_IDF_VERSION_MAJOR >= 5
+    esp_pm_config_t cfg = {};
+#else
+    esp_pm_config_esp32c3_t cfg = {};
+#endif
+    cfg.max_freq_mhz = PM_MAX_FREQ_MHZ;
+    cfg.min_freq_mhz = PM_MIN_FREQ_MHZ;
+    cfg.light_sleep_enable = true;
+    esp_err_t err = esp_pm_configure(&cfg);
+    if (err != ESP_OK) {
+        // Framework built without tickless idle: keep frequency scaling, blocked time is idle
+        cfg.light_sleep_enable = false;
+        err = esp_pm_configure(&cfg);
+    }
+    bool autoLightSleep = err == ESP_OK && cfg.light_sleep_enable;
+    EnergyModel::instance().setAutoLightSleep(autoLightSleep);
+    if (err == ESP_OK) {
+        Logger::infof("[App] Power management: %d-%d MHz, automatic light sleep %s", PM_MIN_FREQ_MHZ, PM_MAX_FREQ_MHZ, autoLightSleep ? "on" : "off");
+    } else {
+        Logger::errorf("[App] Power management unavailable, err=%d", (int)err);
+    }
+#endif
+}
+
+SleepPolicy::Inputs App::sleepInputs() {
+    SleepPolicy::Inputs in;
+    in.nowMs = millis();
+    in.lastBleInteractionMs = bleManager->lastInteractionMs();
+    uint32_t untilNext = puffCounterSm->secondsUntilNextPhase();
+    in.msToNextPhase = (untilNext >= UINT32_MAX / 1000) ? UINT32_MAX : untilNext * 1000;
+    in.bleActive = bleManager->isActive();
+    in.connected = bleManager->isConnected();
+    in.notifyPending = bleManager->hasPendingNotifications();
+    in.eventsPending = s_wakeup_pending || s_puff_rising_pending || s_puff_falling_pending;
+    in.debounceActive = DebounceManager::instance().active();
+    in.puffInProgress = puffCounterSm->puffInProgress();
+    in.buttonHeld = digitalRead(BUTTON_PIN) == HIGH;
+    return in;
+}
+
+void App::lightSleep(uint32_t ms) {
+    // The inputs stay armed as GPIO wake sources; their level ISR runs right after wake
+    esp_sleep_enable_timer_wakeup((uint64_t)ms * 1000ULL);
+    uint32_t startUs = Metrics::nowUs();
+    esp_light_sleep_start();
+    EnergyModel::instance().addLightSleep(Metrics::nowUs() - startUs);
+    esp_sleep_disable_wakeup_source(ESP_SLEEP_WAKEUP_TIMER);
+}
+
+void App::pollAdvertisePolicy() {
+    AdvertisePolicy::Inputs in;
+    in.buttonHigh = digitalRead(BUTTON_PIN) == HIGH;
+    in.nowMs = millis();
+    in.unsyncedPuffs = PersistenceManager::instance().unsyncedPuffs();
+    in.epochSec = epochSeconds();
+    BleStartReason reason = AdvertisePolicy::instance().poll(in);
+    if (reason != BLE_START_NONE) startBle(reason);
+}
+
+void App::startBle(BleStartReason reason) {
+    Logger::infof("[App] Starting BLE (%s).", AdvertisePolicy::reasonName(reason));
+    BootProfiler::instance().setBleReason(reason);
+    AdvertisePolicy::instance().onAdvertise(epochSeconds());
+    bleManager->startServiceAsync();
 }
 
 void App::handleWakeup() {
     if (!puffCounterSm) puffCounterSm = &StateMachine::instance();
-    updateDeviceState();
+    // Transitions already drive the coil; rewrite the pin in case it diverged from the cached state
+    syncCoil(puffCounterSm->getCurrentState());
+}
+
+void App::handleTimerWakeup() {
+    // Headless path: coil stays locked from setupPins(), BLE is never started
+    Logger::info("[App] Timer wake at phase boundary; advancing phase headless.");
+    correctClockDrift();
+    puffCounterSm = &StateMachine::instance();
+    puffCounterSm->incrementValidPhase(Timebase::instance().sample());
+    enterDeepSleep();
 }
 
-void App::handlePuffCountRising() {
+void App::correctClockDrift() {
+    // Runs before anything reads the wall clock this wake
+    ClockDrift& drift = ClockDrift::instance();
+    drift.begin();
+    uint32_t rtcEpoch = epochSeconds();
+    int32_t correction = drift.onWake(rtcEpoch);
+    if (correction != 0) Timebase::instance().setEpoch((uint32_t)((int32_t)rtcEpoch + correction));
+}
+
+void App::handlePuffCountRising(const Timebase::Now& now) {
     if (!puffCounterSm) puffCounterSm = &StateMachine::instance();
-    puffCounterSm->handle_state_rising();
+    puffCounterSm->handle_state_rising(now);
 }
 
-void App::handlePuffCountFalling() {
+void App::handlePuffCountFalling(const Timebase::Now& now) {
     if (!puffCounterSm) puffCounterSm = &StateMachine::instance();
-    puffCounterSm->handle_state_falling();
+    puffCounterSm->handle_state_falling(now);
 }
 
-void App::updateDeviceState() {
-    if (puffCounterSm->getCurrentState() == LOCKDOWN) {
-        Device::lockCoil();
-    } else if (puffCounterSm->getCurrentState() == PUFF_COUNTING) {
-        Device::unlockCoil();
+void App::enterDeepSleep() {
+    // Only the button wakes deep sleep; drop the light-sleep GPIO wake armed by attachInputs()
+    esp_sleep_disable_wakeup_source(ESP_SLEEP_WAKEUP_GPIO);
+
+    // Configure deep-sleep wake on BUTTON_PIN going HIGH
+#if SOC_GPIO_SUPPORT_DEEPSLEEP_WAKEUP
+    esp_err_t wakeErr = esp_deep_sleep_enable_gpio_wakeup(1ULL << BUTTON_PIN, ESP_GPIO_WAKEUP_GPIO_HIGH);
+    if (wakeErr == ESP_OK) {
+        Logger::infof("[App] Wake source configured: ext1 GPIO %d HIGH", BUTTON_PIN);
+    } else {
+        Logger::errorf("[App] Failed to configure wake source (ext1) on GPIO %d, err=%d", BUTTON_PIN, (int)wakeErr);
     }
-}
\ No newline at end of file
+#endif
+
+    // Wake again at the next phase boundary so the phase is current before the next button wake
+    if (!puffCounterSm) puffCounterSm = &StateMachine::instance();
+    uint32_t untilNext = puffCounterSm->secondsUntilNextPhase();
+    if (untilNext != UINT32_MAX) {
+        uint64_t sleepUs = (uint64_t)(untilNext + PHASE_WAKE_MARGIN_SEC) * 1000000ULL;
+        esp_sleep_enable_timer_wakeup(sleepUs);
+        Logger::infof("[App] Wake source configured: timer in %u s (next phase boundary)", (unsigned)(untilNext + PHASE_WAKE_MARGIN_SEC));
+    }
+
+    // Store current epoch (requires prior NTP for accuracy); the same reading starts the drift count
+    uint32_t sleepEpoch = epochSeconds();
+    PersistenceManager::instance().recordEpoch(sleepEpoch);
+    ClockDrift::instance().onSleep(sleepEpoch);
+    // Reclaim history the client has acknowledged while nothing else is running
+    PersistenceManager::instance().compact();
+    PersistenceManager::instance().logWearReport();
+    AllocTracker::instance().logReport();
+    BLEManager::instance().logRadioReport();
+    EnergyModel::instance().logReport(BLEManager::instance().radioOnMs());
+    // Snapshot last so the persistence cursors match everything written above
+    puffCounterSm->saveResumeSnapshot();
+    Logger::info("[App] Entering deep sleep");
+    esp_deep_sleep_start();
+}
@@ -15,14 +15,20 @@
 #include "BLEManager.h"
 #include "StateMachine.h"
 #include "Device.h"
+#include "AdvertisePolicy.h"
+#include "SleepPolicy.h"
+#include "Timebase.h"
 
 // -----------------------------------------------------------------------------
 // Application Constants
 // -----------------------------------------------------------------------------
 
-/// @brief Delay in ms for wakeup debounce or sleep transitions
+/// @brief Poll interval in ms while work is in flight (debounce window, puff, held button)
 #define WAKE_DELAY_MS 100
 
+/// @brief Extra seconds added to the phase-boundary timer wake so the boundary has passed on wake
+#define PHASE_WAKE_MARGIN_SEC 1
+
 // -----------------------------------------------------------------------------
 // App Class
 // -----------------------------------------------------------------------------
@@ -37,6 +43,7 @@
  *   - handleWakeup(): Handle wakeup events
  *   - handlePuffCountRising(): Handle puff rising edge events
  *   - handlePuffCountFalling(): Handle puff falling edge events
+ *   - handleTimerWakeup(): Headless phase advance after a timer wake
  */
 class App {
 public:
@@ -58,18 +65,58 @@ public:
   /**
    * @brief Handle puff rising edge events.
    */
-  void handlePuffCountRising();
+  void handlePuffCountRising(const Timebase::Now& now);
 
   /**
    * @brief Handle puff falling edge events.
    */
-  void handlePuffCountFalling();
+  void handlePuffCountFalling(const Timebase::Now& now);
+
+  /**
+   * @brief Advance the phase after a phase-boundary timer wake and go back to sleep (no BLE).
+   */
+  void handleTimerWakeup();
 
 private:
   /**
-   * @brief Update device state based on current conditions.
+   * @brief Ask the advertise policy whether BLE should start now (while BLE is off).
+   */
+  void pollAdvertisePolicy();
+
+  /**
+   * @brief Start BLE on its own task and record why.
+   */
+  void startBle(BleStartReason reason);
+
+  /**
+   * @brief Sample the loop state the sleep policy decides on.
+   */
+  SleepPolicy::Inputs sleepInputs();
+
+  /**
+   * @brief Block the loop task until an input ISR notifies it or ms pass.
+   */
+  void waitForEvent(uint32_t ms);
+
+  /**
+   * @brief Configure esp_pm frequency scaling and automatic light sleep (PM_AUTO_LIGHT_SLEEP).
+   */
+  void configurePowerManagement();
+
+  /**
+   * @brief Light sleep with the radio off, waking on HEAT_PIN, BUTTON_PIN or after ms.
+   */
+  void lightSleep(uint32_t ms);
+
+  /**
+   * @brief Add the estimated RTC drift of the deep sleep that just ended to the wall clock.
+   */
+  void correctClockDrift();
+
+  /**
+   * @brief Configure GPIO and phase-boundary timer wake sources, persist epoch, and deep sleep.
    */
-  void updateDeviceState();
+  void enterDeepSleep();
 
   BLEManager* bleManager = nullptr;         ///< BLE manager instance
   StateMachine* puffCounterSm = nullptr;    ///< State machine instance
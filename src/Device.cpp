@@ -6,12 +6,18 @@
 
 #include "Device.h"
 #include <Arduino.h>
+#include <hal/gpio_ll.h>
 
 // -----------------------------------------------------------------------------
 // Device State (local static)
 // -----------------------------------------------------------------------------
 
-static DeviceState deviceState = COIL_LOCKED;
+static volatile DeviceState deviceState = COIL_LOCKED;
+
+// One store to GPIO out_w1ts/out_w1tc; no driver call, lock or pin-mode check
+static inline void IRAM_ATTR writeCoilPin(uint32_t level) {
+    gpio_ll_set_level(&GPIO, (gpio_num_t)COIL_CTRL_PIN, level);
+}
 
 // -----------------------------------------------------------------------------
 // Device Method Implementations
@@ -21,19 +27,27 @@ void Device::setupPins() {
     pinMode(BUTTON_PIN, INPUT_PULLDOWN);
     pinMode(HEAT_PIN, INPUT_PULLDOWN);
     pinMode(COIL_CTRL_PIN, OUTPUT);
-    digitalWrite(COIL_CTRL_PIN, HIGH); // Initially locked
+    writeCoilPin(HIGH); // Initially locked
+    deviceState = COIL_LOCKED;
 }
 
-void Device::lockCoil() {
-    digitalWrite(COIL_CTRL_PIN, HIGH);
+void IRAM_ATTR Device::lockCoil() {
+    if (deviceState == COIL_LOCKED) return;
+    writeCoilPin(HIGH);
     deviceState = COIL_LOCKED;
 }
 
-void Device::unlockCoil() {
-    digitalWrite(COIL_CTRL_PIN, LOW);
+void IRAM_ATTR Device::unlockCoil() {
+    if (deviceState == COIL_UNLOCKED) return;
+    writeCoilPin(LOW);
     deviceState = COIL_UNLOCKED;
 }
 
+void IRAM_ATTR Device::syncCoil(DeviceState state) {
+    writeCoilPin(state == COIL_LOCKED ? HIGH : LOW);
+    deviceState = state;
+}
+
 void Device::setState(DeviceState state) {
     if (state == COIL_LOCKED) {
         lockCoil();
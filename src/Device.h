@@ -5,7 +5,9 @@
  * @file Device.h
  * @brief Hardware abstraction for device-specific features (pins, coil, state).
  *
- * Provides static methods for pin setup, coil control, and device state management.
+ * Provides static methods for pin setup, coil control, and device state management. The coil
+ * output is edge-triggered: a lock or unlock that does not change the state writes nothing, and
+ * a change is a single write to the GPIO set/clear register (safe from an ISR).
  *
  * @author Vetra Firmware Team
  * @copyright Copyright (c) 2025 Vetra
@@ -54,15 +56,22 @@ public:
   static void setupPins();
 
   /**
-   * @brief Lock the coil (disable heating).
+   * @brief Lock the coil (disable heating); no write if already locked.
    */
   static void lockCoil();
 
   /**
-   * @brief Unlock the coil (enable heating).
+   * @brief Unlock the coil (enable heating); no write if already unlocked.
    */
   static void unlockCoil();
 
+  /**
+   * @brief Write the coil pin for a state even if the cached state already matches.
+   *
+   * Corrects a pin that diverged from the cached state; lockCoil()/unlockCoil() cannot.
+   */
+  static void syncCoil(DeviceState state);
+
   /**
    * @brief Set the device coil state.
    */
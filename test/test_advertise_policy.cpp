@@ -0,0 +1,74 @@
+#include <Arduino.h>
+#include <unity.h>
+#include <esp_sleep.h>
+#include "AdvertisePolicy.h"
+
+static constexpr uint32_t NOW = 1760000000;
+
+static AdvertisePolicy::Inputs idle(uint32_t nowMs) {
+    AdvertisePolicy::Inputs in{};
+    in.buttonHigh = false;
+    in.nowMs = nowMs;
+    in.unsyncedPuffs = 0;
+    in.epochSec = NOW;
+    return in;
+}
+
+void test_advertise_policy_boot() {
+    AdvertisePolicy& p = AdvertisePolicy::instance();
+    TEST_ASSERT_EQUAL(BLE_START_POWER_ON, p.atBoot(ESP_SLEEP_WAKEUP_UNDEFINED));
+    TEST_ASSERT_EQUAL(BLE_START_NONE, p.atBoot(ESP_SLEEP_WAKEUP_GPIO));
+}
+
+void test_advertise_policy_quiet_wake() {
+    AdvertisePolicy& p = AdvertisePolicy::instance();
+    p.reset();
+    p.onAdvertise(NOW - 60);
+    // Short press, a few puffs pending, recent advertisement: the radio stays off
+    AdvertisePolicy::Inputs in = idle(100);
+    in.buttonHigh = true;
+    in.unsyncedPuffs = BLE_UNSYNCED_PUFFS - 1;
+    TEST_ASSERT_EQUAL(BLE_START_NONE, p.poll(in));
+    in.nowMs = 100 + BLE_LONG_PRESS_MS - 1;
+    TEST_ASSERT_EQUAL(BLE_START_NONE, p.poll(in));
+    in.buttonHigh = false;
+    TEST_ASSERT_EQUAL(BLE_START_NONE, p.poll(in));
+}
+
+void test_advertise_policy_long_press_once() {
+    AdvertisePolicy& p = AdvertisePolicy::instance();
+    p.reset();
+    p.onAdvertise(NOW);
+    AdvertisePolicy::Inputs in = idle(1000);
+    in.buttonHigh = true;
+    TEST_ASSERT_EQUAL(BLE_START_NONE, p.poll(in));
+    in.nowMs += BLE_LONG_PRESS_MS;
+    TEST_ASSERT_EQUAL(BLE_START_LONG_PRESS, p.poll(in));
+    in.nowMs += 100;
+    TEST_ASSERT_EQUAL(BLE_START_NONE, p.poll(in)); // same press
+}
+
+void test_advertise_policy_triggers() {
+    AdvertisePolicy& p = AdvertisePolicy::instance();
+    p.reset();
+    p.onAdvertise(NOW);
+    AdvertisePolicy::Inputs in = idle(0);
+    in.unsyncedPuffs = BLE_UNSYNCED_PUFFS;
+    TEST_ASSERT_EQUAL(BLE_START_UNSYNCED, p.poll(in));
+    in.unsyncedPuffs = 0;
+    in.epochSec = NOW + BLE_ADVERTISE_INTERVAL_SEC;
+    TEST_ASSERT_EQUAL(BLE_START_SCHEDULED, p.poll(in));
+    in.epochSec = 1000; // clock never set
+    TEST_ASSERT_EQUAL(BLE_START_NO_TIME, p.poll(in));
+}
+
+void setup() {
+    UNITY_BEGIN();
+    RUN_TEST(test_advertise_policy_boot);
+    RUN_TEST(test_advertise_policy_quiet_wake);
+    RUN_TEST(test_advertise_policy_long_press_once);
+    RUN_TEST(test_advertise_policy_triggers);
+    UNITY_END();
+}
+
+void loop() {}
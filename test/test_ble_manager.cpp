@@ -10,9 +10,23 @@ void test_ble_manager_init() {
     TEST_ASSERT_FALSE(bleManager->isActive());
 }
 
+void test_ble_manager_restart() {
+    BLEManager* bleManager = &BLEManager::instance();
+    bleManager->startService();
+    bleManager->startService(); // idempotent while running
+    TEST_ASSERT_TRUE(bleManager->isActive());
+    bleManager->cleanupService();
+    // Rebuilt from the arena after the stack was torn down
+    bleManager->startService();
+    TEST_ASSERT_TRUE(bleManager->isActive());
+    bleManager->cleanupService();
+    TEST_ASSERT_FALSE(bleManager->isActive());
+}
+
 void setup() {
     UNITY_BEGIN();
     RUN_TEST(test_ble_manager_init);
+    RUN_TEST(test_ble_manager_restart);
     UNITY_END();
 }
 
@@ -0,0 +1,62 @@
+#include <Arduino.h>
+#include <unity.h>
+#include <nvs_flash.h>
+#include "ClockDrift.h"
+
+static constexpr uint32_t T0 = 1750000000;
+static constexpr uint32_t DAY = 86400;
+
+void test_clock_drift_correction_rounding() {
+    TEST_ASSERT_EQUAL_INT32(0, ClockDrift::correctionSec(DAY, 0));
+    // 100 ppm over a day is 8.64 s
+    TEST_ASSERT_EQUAL_INT32(9, ClockDrift::correctionSec(DAY, 100));
+    TEST_ASSERT_EQUAL_INT32(-9, ClockDrift::correctionSec(DAY, -100));
+    TEST_ASSERT_EQUAL_INT32(0, ClockDrift::correctionSec(3600, 100));
+}
+
+void test_clock_drift_sample_bounds() {
+    TEST_ASSERT_FALSE(ClockDrift::usableSample(5, DRIFT_MIN_SLEEP_SEC - 1));
+    TEST_ASSERT_TRUE(ClockDrift::usableSample(5, DAY));
+    TEST_ASSERT_TRUE(ClockDrift::usableSample(-5, DAY));
+    // Two hours off after a day asleep is a clock set by hand, not drift
+    TEST_ASSERT_FALSE(ClockDrift::usableSample(7200, DAY));
+}
+
+void test_clock_drift_update_estimate() {
+    // First sample is taken whole, later ones move halfway
+    TEST_ASSERT_EQUAL_INT32(100, ClockDrift::updatedPpm(0, 0, 864, 8640000));
+    TEST_ASSERT_EQUAL_INT32(150, ClockDrift::updatedPpm(100, 1, 864, 8640000));
+    TEST_ASSERT_EQUAL_INT32(DRIFT_MAX_PPM, ClockDrift::updatedPpm(DRIFT_MAX_PPM - 10, 3, 86, 864));
+    TEST_ASSERT_EQUAL_INT32(42, ClockDrift::updatedPpm(42, 2, 5, 0));
+}
+
+void test_clock_drift_sleep_sync_wake() {
+    ClockDrift& drift = ClockDrift::instance();
+    drift.begin();
+    TEST_ASSERT_EQUAL_INT32(0, drift.ppm());
+    // First sync after power-on only starts counting
+    drift.onSync(T0, T0);
+    TEST_ASSERT_EQUAL_INT32(0, drift.ppm());
+    // Two days asleep with no estimate yet: no correction, the RTC lost 17 s
+    drift.onSleep(T0);
+    TEST_ASSERT_EQUAL_INT32(0, drift.onWake(T0 + 2 * DAY));
+    drift.onSync(T0 + 2 * DAY, T0 + 2 * DAY + 17);
+    TEST_ASSERT_EQUAL_INT32(98, drift.ppm());
+    // The next day asleep is corrected by the new estimate
+    uint32_t now = T0 + 2 * DAY + 17;
+    drift.onSleep(now);
+    TEST_ASSERT_EQUAL_INT32(8, drift.onWake(now + DAY));
+}
+
+void setup() {
+    nvs_flash_erase();
+    nvs_flash_init();
+    UNITY_BEGIN();
+    RUN_TEST(test_clock_drift_correction_rounding);
+    RUN_TEST(test_clock_drift_sample_bounds);
+    RUN_TEST(test_clock_drift_update_estimate);
+    RUN_TEST(test_clock_drift_sleep_sync_wake);
+    UNITY_END();
+}
+
+void loop() {}
@@ -2,6 +2,9 @@
 #include <unity.h>
 #include "Device.h"
 
+// A coil lock is one register store; anything near this means a driver call crept back in
+static constexpr uint32_t LOCK_LATENCY_BUDGET_US = 5;
+
 void test_device_state() {
     Device::setState(COIL_UNLOCKED);
     TEST_ASSERT_EQUAL(Device::getState(), COIL_UNLOCKED);
@@ -9,9 +12,35 @@ void test_device_state() {
     TEST_ASSERT_EQUAL(Device::getState(), COIL_LOCKED);
 }
 
+void test_device_lock_latency() {
+    Device::setupPins();
+    Device::unlockCoil();
+    uint32_t startUs = micros();
+    Device::lockCoil();
+    uint32_t lockUs = micros() - startUs;
+    TEST_ASSERT_EQUAL(COIL_LOCKED, Device::getState());
+    TEST_ASSERT_LESS_OR_EQUAL_UINT32(LOCK_LATENCY_BUDGET_US, lockUs);
+    // Repeating the current state is a no-op
+    Device::lockCoil();
+    TEST_ASSERT_EQUAL(COIL_LOCKED, Device::getState());
+}
+
+void test_device_sync_coil() {
+    Device::setupPins();
+    // syncCoil writes even when the cached state already matches, and adopts the new state
+    Device::syncCoil(COIL_LOCKED);
+    TEST_ASSERT_EQUAL(COIL_LOCKED, Device::getState());
+    Device::syncCoil(COIL_UNLOCKED);
+    TEST_ASSERT_EQUAL(COIL_UNLOCKED, Device::getState());
+    Device::lockCoil();
+    TEST_ASSERT_EQUAL(COIL_LOCKED, Device::getState());
+}
+
 void setup() {
     UNITY_BEGIN();
     RUN_TEST(test_device_state);
+    RUN_TEST(test_device_lock_latency);
+    RUN_TEST(test_device_sync_coil);
     UNITY_END();
 }
 
@@ -0,0 +1,50 @@
+#include <Arduino.h>
+#include <unity.h>
+#include "EnergyModel.h"
+
+void test_energy_model_state_currents() {
+    TEST_ASSERT_EQUAL_UINT32(ENERGY_ACTIVE_UA, EnergyModel::chargeUc(1000, 0, 0, 0));
+    TEST_ASSERT_EQUAL_UINT32(ENERGY_LIGHT_SLEEP_UA + ENERGY_RADIO_UA, EnergyModel::chargeUc(0, 0, 1000, 1000));
+    TEST_ASSERT_EQUAL_UINT32(ENERGY_IDLE_UA * 2, EnergyModel::chargeUc(0, 2000, 0, 0));
+}
+
+void test_energy_model_blocked_time() {
+    EnergyModel& m = EnergyModel::instance();
+    m.reset();
+    m.addWait(59000000);
+    m.addLightSleep(0);
+    // Connected for a minute, blocked for all but one second
+    m.setAutoLightSleep(false);
+    EnergyModel::Estimate idle = m.estimate(60000, 60000);
+    TEST_ASSERT_EQUAL_UINT32(1000, idle.activeMs);
+    TEST_ASSERT_EQUAL_UINT32(59000, idle.idleMs);
+    TEST_ASSERT_EQUAL_UINT32(0, idle.lightSleepMs);
+    m.setAutoLightSleep(true);
+    EnergyModel::Estimate slept = m.estimate(60000, 60000);
+    TEST_ASSERT_EQUAL_UINT32(59000, slept.lightSleepMs);
+    TEST_ASSERT_EQUAL_UINT32(EnergyModel::chargeUc(1000, 0, 59000, 60000), slept.chargeUc);
+    TEST_ASSERT_TRUE(slept.averageUa * 2 < idle.averageUa);
+}
+
+void test_energy_model_clamps_to_wake() {
+    EnergyModel& m = EnergyModel::instance();
+    m.reset();
+    m.setAutoLightSleep(false);
+    m.addLightSleep(800000);
+    m.addWait(800000);
+    EnergyModel::Estimate e = m.estimate(1000, 5000);
+    TEST_ASSERT_EQUAL_UINT32(0, e.activeMs);
+    TEST_ASSERT_EQUAL_UINT32(200, e.idleMs);
+    TEST_ASSERT_EQUAL_UINT32(800, e.lightSleepMs);
+    TEST_ASSERT_EQUAL_UINT32(1000, e.radioMs);
+}
+
+void setup() {
+    UNITY_BEGIN();
+    RUN_TEST(test_energy_model_state_currents);
+    RUN_TEST(test_energy_model_blocked_time);
+    RUN_TEST(test_energy_model_clamps_to_wake);
+    UNITY_END();
+}
+
+void loop() {}
@@ -0,0 +1,36 @@
+#include <Arduino.h>
+#include <unity.h>
+#include "Metrics.h"
+
+void test_metrics_percentiles() {
+    Metrics& m = Metrics::instance();
+    m.reset();
+    for (int i = 0; i < 98; ++i) m.record(METRIC_NVS_COMMIT, 100);   // bucket [64, 128)
+    m.record(METRIC_NVS_COMMIT, 5000);                               // bucket [4096, 8192)
+    m.record(METRIC_NVS_COMMIT, 6000);
+    TEST_ASSERT_EQUAL_UINT32(128, m.percentileUs(METRIC_NVS_COMMIT, 50));
+    TEST_ASSERT_EQUAL_UINT32(6000, m.percentileUs(METRIC_NVS_COMMIT, 99));
+    TEST_ASSERT_EQUAL_UINT32(0, m.percentileUs(METRIC_LOOP_ITERATION, 50));
+}
+
+void test_metrics_serialize_and_reset() {
+    Metrics& m = Metrics::instance();
+    m.reset();
+    m.record(METRIC_PUFFS_REQUEST, 3);
+    uint8_t buf[Metrics::serializedSize()];
+    TEST_ASSERT_EQUAL(Metrics::serializedSize(), m.serialize(buf, sizeof(buf)));
+    size_t puffsOffset = 3 + METRIC_PUFFS_REQUEST * (16 + METRIC_BUCKETS * 4);
+    TEST_ASSERT_EQUAL(1, buf[puffsOffset]);
+    m.reset();
+    m.serialize(buf, sizeof(buf));
+    TEST_ASSERT_EQUAL(0, buf[puffsOffset]);
+}
+
+void setup() {
+    UNITY_BEGIN();
+    RUN_TEST(test_metrics_percentiles);
+    RUN_TEST(test_metrics_serialize_and_reset);
+    UNITY_END();
+}
+
+void loop() {}
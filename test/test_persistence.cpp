@@ -0,0 +1,64 @@
+#include <Arduino.h>
+#include <unity.h>
+#include <nvs_flash.h>
+#include "PersistenceManager.h"
+
+static constexpr uint32_t RING_PUFFS = (uint32_t)PUFF_RING_BLOCKS * PUFF_BLOCK_CAP;
+
+static uint32_t s_puffs = 0;
+
+static void appendPuffs(uint32_t n) {
+    for (uint32_t i = 0; i < n; ++i) {
+        ++s_puffs;
+        PuffModel p{(int)s_puffs, 1000 + s_puffs, 800, 1};
+        PersistenceManager::instance().appendPuff(p);
+    }
+}
+
+static uint32_t lostPuffs() { return Counters::instance().get(CNT_PUFFS_UNSYNCED_LOST); }
+
+void test_persistence_ring_full_nothing_acked() {
+    PersistenceManager& pm = PersistenceManager::instance();
+    uint32_t before = lostPuffs();
+    appendPuffs(RING_PUFFS);
+    TEST_ASSERT_EQUAL_UINT32(before, lostPuffs());
+    TEST_ASSERT_EQUAL_UINT32(RING_PUFFS, pm.unsyncedPuffs());
+    // The next puff takes the slot of block 0, none of which the client has
+    appendPuffs(1);
+    TEST_ASSERT_EQUAL_UINT32(before + PUFF_BLOCK_CAP, lostPuffs());
+    uint32_t first = 0, seen = 0;
+    pm.forEachPuff([&](const PersistenceManager::PuffRecord& r) { if (!seen++) first = r.puffNumber; });
+    TEST_ASSERT_EQUAL_UINT32(RING_PUFFS - PUFF_BLOCK_CAP + 1, seen);
+    TEST_ASSERT_EQUAL_UINT32(PUFF_BLOCK_CAP + 1, first);
+}
+
+void test_persistence_ring_full_partly_acked() {
+    PersistenceManager& pm = PersistenceManager::instance();
+    uint32_t before = lostPuffs();
+    // Block 1 is recycled next; the client has its first five puffs
+    TEST_ASSERT_TRUE(pm.acknowledgePuffs(PUFF_BLOCK_CAP + 5));
+    appendPuffs(PUFF_BLOCK_CAP);
+    TEST_ASSERT_EQUAL_UINT32(before + PUFF_BLOCK_CAP - 5, lostPuffs());
+}
+
+void test_persistence_ring_full_all_acked() {
+    PersistenceManager& pm = PersistenceManager::instance();
+    uint32_t before = lostPuffs();
+    TEST_ASSERT_TRUE(pm.acknowledgePuffs(s_puffs));
+    TEST_ASSERT_EQUAL_UINT32(0, pm.unsyncedPuffs());
+    appendPuffs(PUFF_BLOCK_CAP);
+    TEST_ASSERT_EQUAL_UINT32(before, lostPuffs());
+}
+
+void setup() {
+    // Start from empty storage so the ring fills at a known puff count
+    nvs_flash_erase();
+    nvs_flash_init();
+    UNITY_BEGIN();
+    RUN_TEST(test_persistence_ring_full_nothing_acked);
+    RUN_TEST(test_persistence_ring_full_partly_acked);
+    RUN_TEST(test_persistence_ring_full_all_acked);
+    UNITY_END();
+}
+
+void loop() {}
@@ -0,0 +1,197 @@
+#include <Arduino.h>
+#include <unity.h>
+#include <nvs_flash.h>
+#include "RecordChannel.h"
+
+struct TestRecord {
+    uint32_t value;
+    uint16_t tag;
+} __attribute__((packed));
+
+// Channel id 7 is unused by the firmware, so the test blocks do not collide with real data
+using TestChannel = RecordChannel<TestRecord, 4, 7, 4>;
+
+static void appendValues(TestChannel& ch, uint32_t from, uint32_t to) {
+    for (uint32_t v = from; v < to; ++v) {
+        if (ch.isFull()) ch.rotate();
+        TestRecord& r = ch.nextSlot();
+        r.value = v;
+        r.tag = (uint16_t)(v * 3);
+        ch.commitSlot();
+    }
+}
+
+void test_record_channel_append_and_rotate() {
+    ChannelMeta meta;
+    TestChannel ch(CNT_NVS_BYTES_META);
+    ch.bind(&meta);
+    ch.resetMeta();
+    TEST_ASSERT_TRUE(ch.metaMatches());
+    ch.loadActive();
+    appendValues(ch, 0, 10);
+    TEST_ASSERT_EQUAL_UINT32(10, meta.totalRecords);
+    TEST_ASSERT_EQUAL(2, meta.activeBlockIndex);
+    TEST_ASSERT_EQUAL(2, meta.activeCount);
+    TEST_ASSERT_EQUAL_UINT32(9, ch.lastInBlock()->value);
+}
+
+void test_record_channel_for_each_from_record() {
+    ChannelMeta meta;
+    TestChannel ch(CNT_NVS_BYTES_META);
+    ch.bind(&meta);
+    ch.resetMeta();
+    ch.loadActive();
+    appendValues(ch, 100, 110);
+    uint32_t expected = 100, seen = 0;
+    ch.forEach([&](const TestRecord& r) {
+        TEST_ASSERT_EQUAL_UINT32(expected, r.value);
+        TEST_ASSERT_EQUAL(expected * 3 & 0xFFFF, r.tag);
+        ++expected; ++seen;
+    });
+    TEST_ASSERT_EQUAL_UINT32(10, seen);
+    expected = 106; seen = 0;
+    ch.forEach([&](const TestRecord& r) { TEST_ASSERT_EQUAL_UINT32(expected++, r.value); ++seen; }, 6);
+    TEST_ASSERT_EQUAL_UINT32(4, seen);
+}
+
+void test_record_channel_range_and_early_stop() {
+    ChannelMeta meta;
+    TestChannel ch(CNT_NVS_BYTES_META);
+    ch.bind(&meta);
+    ch.resetMeta();
+    ch.loadActive();
+    appendValues(ch, 0, 10);
+    uint32_t sum = 0;
+    TEST_ASSERT_EQUAL_UINT32(4, ch.forEach([&](const TestRecord& r) { sum += r.value; }, 3, 7));
+    TEST_ASSERT_EQUAL_UINT32(3 + 4 + 5 + 6, sum);
+    uint32_t last = 0;
+    TEST_ASSERT_EQUAL_UINT32(3, ch.forEach([&](const TestRecord& r) { last = r.value; return r.value < 2; }));
+    TEST_ASSERT_EQUAL_UINT32(2, last);
+    TEST_ASSERT_EQUAL_UINT32(0, ch.forEach([](const TestRecord&) {}, 12));
+}
+
+void test_record_channel_lower_bound() {
+    ChannelMeta meta;
+    TestChannel ch(CNT_NVS_BYTES_META);
+    ch.bind(&meta);
+    ch.resetMeta();
+    ch.loadActive();
+    auto value = [](const TestRecord& r) { return r.value; };
+    TEST_ASSERT_EQUAL_UINT32(0, ch.lowerBound(value, 5u));
+    appendValues(ch, 10, 20);
+    TEST_ASSERT_EQUAL_UINT32(0, ch.lowerBound(value, 0u));
+    TEST_ASSERT_EQUAL_UINT32(0, ch.lowerBound(value, 10u));
+    TEST_ASSERT_EQUAL_UINT32(3, ch.lowerBound(value, 13u));
+    TEST_ASSERT_EQUAL_UINT32(4, ch.lowerBound(value, 14u));
+    TEST_ASSERT_EQUAL_UINT32(9, ch.lowerBound(value, 19u));
+    TEST_ASSERT_EQUAL_UINT32(10, ch.lowerBound(value, 20u));
+    // Same answers with the active block served from NVS instead of RAM
+    ch.invalidate();
+    TEST_ASSERT_EQUAL_UINT32(8, ch.lowerBound(value, 18u));
+    TEST_ASSERT_EQUAL_UINT32(10, ch.lowerBound(value, 100u));
+}
+
+void test_record_channel_drop_blocks() {
+    ChannelMeta meta;
+    TestChannel ch(CNT_NVS_BYTES_META);
+    ch.bind(&meta);
+    ch.resetMeta();
+    ch.loadActive();
+    appendValues(ch, 0, 10);
+    TEST_ASSERT_EQUAL(2, ch.dropBlocksBefore(2));
+    TEST_ASSERT_EQUAL(2, ch.firstBlock());
+    // The active block is never dropped
+    TEST_ASSERT_EQUAL(0, ch.dropBlocksBefore(5));
+    uint32_t first = 0;
+    TEST_ASSERT_EQUAL_UINT32(2, ch.forEach([&](const TestRecord& r) { if (!first) first = r.value; }));
+    TEST_ASSERT_EQUAL_UINT32(8, first);
+    TEST_ASSERT_EQUAL_UINT32(8, ch.lowerBound([](const TestRecord& r) { return r.value; }, 0u));
+    TEST_ASSERT_EQUAL_UINT32(10, meta.totalRecords);
+}
+
+void test_record_channel_ring_reuse() {
+    ChannelMeta meta;
+    TestChannel ch(CNT_NVS_BYTES_META);
+    ch.bind(&meta);
+    ch.resetMeta();
+    ch.loadActive();
+    appendValues(ch, 0, 40);
+    TEST_ASSERT_EQUAL_UINT32(9, meta.activeBlockIndex);
+    // Blocks 0-5 were overwritten by 4-9 in the four slots
+    TEST_ASSERT_EQUAL_UINT32(6, ch.oldestBlock());
+    uint32_t first = UINT32_MAX, last = 0;
+    TEST_ASSERT_EQUAL_UINT32(16, ch.forEach([&](const TestRecord& r) { if (first == UINT32_MAX) first = r.value; last = r.value; }));
+    TEST_ASSERT_EQUAL_UINT32(24, first);
+    TEST_ASSERT_EQUAL_UINT32(39, last);
+    TEST_ASSERT_EQUAL_UINT32(0, ch.forEach([](const TestRecord&) {}, 0, 24));
+    TEST_ASSERT_EQUAL_UINT32(24, ch.lowerBound([](const TestRecord& r) { return r.value; }, 0u));
+    TEST_ASSERT_EQUAL_UINT32(30, ch.lowerBound([](const TestRecord& r) { return r.value; }, 30u));
+    TEST_ASSERT_EQUAL_UINT32(40, meta.totalRecords);
+}
+
+// One-key-per-block layout with a narrower record; the tag is rebuilt from the record index
+static void convertLegacy(const uint8_t* legacy, uint8_t* out, uint32_t recordIndex) {
+    uint16_t value;
+    memcpy(&value, legacy, sizeof(value));
+    TestRecord r{value, (uint16_t)(recordIndex * 3)};
+    memcpy(out, &r, sizeof(r));
+}
+
+void test_record_channel_legacy_blocks() {
+    ChannelMeta meta;
+    TestChannel ch(CNT_NVS_BYTES_META);
+    ch.bind(&meta);
+    ch.resetMeta();
+    ch.setLegacyFormat(sizeof(uint16_t), convertLegacy);
+    nvs_handle_t h;
+    TEST_ASSERT_TRUE(pm_nvs(&h));
+    for (uint32_t bi = 0; bi < 6; ++bi) {
+        uint16_t values[4] = {(uint16_t)(bi * 4), (uint16_t)(bi * 4 + 1), (uint16_t)(bi * 4 + 2), (uint16_t)(bi * 4 + 3)};
+        char key[NVS_KEY_SIZE]; ch.legacyKey(bi, key, sizeof(key));
+        TEST_ASSERT_EQUAL(ESP_OK, nvs_set_blob(h, key, values, sizeof(values)));
+    }
+    meta.activeBlockIndex = 5;
+    meta.activeCount = 4;
+    meta.totalRecords = 24;
+    // Blocks 2-5 move into the ring; 0 and 1 stay under their legacy keys
+    ch.setLegacyEnd(ch.ringStart());
+    for (uint32_t bi = ch.ringStart(); bi <= meta.activeBlockIndex; ++bi) ch.migrateBlock(h, bi);
+    ch.loadActive();
+    uint32_t expected = 0;
+    TEST_ASSERT_EQUAL_UINT32(24, ch.forEach([&](const TestRecord& r) {
+        TEST_ASSERT_EQUAL_UINT32(expected, r.value);
+        TEST_ASSERT_EQUAL(expected * 3, r.tag);
+        ++expected;
+    }));
+    // The ring recycles blocks 2 and 3; the legacy blocks are still there
+    appendValues(ch, 24, 32);
+    TEST_ASSERT_EQUAL_UINT32(0, ch.oldestBlock());
+    TEST_ASSERT_FALSE(ch.isStored(2));
+    TEST_ASSERT_EQUAL_UINT32(24, ch.forEach([](const TestRecord&) {}));
+    auto value = [](const TestRecord& r) { return r.value; };
+    TEST_ASSERT_EQUAL_UINT32(5, ch.lowerBound(value, 5u));
+    TEST_ASSERT_EQUAL_UINT32(16, ch.lowerBound(value, 10u));
+    TEST_ASSERT_EQUAL_UINT32(31, ch.lowerBound(value, 31u));
+    // Reclaiming erases legacy keys and ring slots alike
+    TEST_ASSERT_EQUAL(3, ch.dropBlocksBefore(5));
+    char key[NVS_KEY_SIZE]; ch.legacyKey(0, key, sizeof(key));
+    size_t sz = 0;
+    TEST_ASSERT_NOT_EQUAL(ESP_OK, nvs_get_blob(h, key, nullptr, &sz));
+    TEST_ASSERT_EQUAL_UINT32(5, ch.oldestBlock());
+    TEST_ASSERT_EQUAL_UINT32(12, ch.forEach([](const TestRecord&) {}));
+}
+
+void setup() {
+    nvs_flash_init();
+    UNITY_BEGIN();
+    RUN_TEST(test_record_channel_append_and_rotate);
+    RUN_TEST(test_record_channel_for_each_from_record);
+    RUN_TEST(test_record_channel_range_and_early_stop);
+    RUN_TEST(test_record_channel_lower_bound);
+    RUN_TEST(test_record_channel_drop_blocks);
+    RUN_TEST(test_record_channel_ring_reuse);
+    RUN_TEST(test_record_channel_legacy_blocks);
+    UNITY_END();
+}
+
+void loop() {}
@@ -0,0 +1,83 @@
+#include <Arduino.h>
+#include <unity.h>
+#include <nvs_flash.h>
+#include "Rollups.h"
+
+static constexpr uint32_t DAY = 20000;   // 2024-10-04
+static constexpr uint16_t PHASE = 3;
+static constexpr uint32_t T0 = DAY * ROLLUP_DAY_SECONDS + 3600;
+
+static uint32_t storedRollups() { return PersistenceManager::instance().getCursor(ROLLUP_CH).totalRecords; }
+
+void test_rollups_accumulate_open() {
+    Rollups& r = Rollups::instance();
+    r.reset();
+    r.onPuff(T0, 1000, PHASE);
+    r.onPuff(T0 + 60, 3000, PHASE);
+    Rollups::Record out[4];
+    TEST_ASSERT_EQUAL(1, r.query(ROLLUP_DAY, DAY, out, 4));
+    TEST_ASSERT_EQUAL_UINT32(DAY, out[0].key);
+    TEST_ASSERT_EQUAL(2, out[0].count);
+    TEST_ASSERT_EQUAL_UINT32(4000, out[0].sumDurationMs);
+    TEST_ASSERT_EQUAL_UINT32(1000, out[0].minDurationMs);
+    TEST_ASSERT_EQUAL_UINT32(3000, out[0].maxDurationMs);
+    TEST_ASSERT_EQUAL_UINT32(T0, out[0].firstSec);
+    TEST_ASSERT_EQUAL_UINT32(T0 + 60, out[0].lastSec);
+}
+
+void test_rollups_close_on_new_day() {
+    Rollups& r = Rollups::instance();
+    uint32_t before = storedRollups();
+    r.onPuff(T0 + ROLLUP_DAY_SECONDS, 2000, PHASE);
+    TEST_ASSERT_EQUAL_UINT32(before + 1, storedRollups());
+    Rollups::Record out[4];
+    TEST_ASSERT_EQUAL(2, r.query(ROLLUP_DAY, DAY, out, 4));
+    TEST_ASSERT_EQUAL_UINT32(DAY, out[0].key);
+    TEST_ASSERT_EQUAL(2, out[0].count);
+    TEST_ASSERT_EQUAL_UINT32(DAY + 1, out[1].key);
+    TEST_ASSERT_EQUAL(1, out[1].count);
+    // Same phase throughout, so the phase rollup is still open
+    TEST_ASSERT_EQUAL(1, r.query(ROLLUP_PHASE, PHASE, out, 4));
+    TEST_ASSERT_EQUAL(3, out[0].count);
+}
+
+void test_rollups_replay_skips_stored() {
+    Rollups& r = Rollups::instance();
+    uint32_t before = storedRollups();
+    r.reset();
+    r.syncClosed(0);
+    r.onPuff(T0, 1000, PHASE, true);
+    r.onPuff(T0 + 60, 3000, PHASE, true);
+    r.onPuff(T0 + ROLLUP_DAY_SECONDS, 2000, PHASE, true);
+    TEST_ASSERT_EQUAL_UINT32(before, storedRollups());
+    Rollups::Record out[4];
+    TEST_ASSERT_EQUAL(2, r.query(ROLLUP_DAY, DAY, out, 4));
+    TEST_ASSERT_EQUAL_UINT32(DAY + 1, out[1].key);
+}
+
+void test_rollups_serialize() {
+    uint8_t buf[ROLLUP_HEADER + 4 * ROLLUP_ENTRY];
+    size_t len = Rollups::instance().serialize(ROLLUP_DAY, DAY + 1, 4, buf, sizeof(buf));
+    TEST_ASSERT_EQUAL(ROLLUP_HEADER + ROLLUP_ENTRY, len);
+    TEST_ASSERT_EQUAL(ROLLUPS_FORMAT_VERSION, buf[0]);
+    TEST_ASSERT_EQUAL(1, buf[1]);
+    TEST_ASSERT_EQUAL(ROLLUP_DAY, buf[2]);
+    TEST_ASSERT_EQUAL_UINT32(DAY + 1, buf[3] | (buf[4] << 8) | (buf[5] << 16) | ((uint32_t)buf[6] << 24));
+    TEST_ASSERT_EQUAL(1, buf[7] | (buf[8] << 8));
+    TEST_ASSERT_EQUAL(2000, buf[13] | (buf[14] << 8));
+    TEST_ASSERT_EQUAL(0, Rollups::instance().serialize(ROLLUP_DAY, 0, 4, buf, 1));
+}
+
+void setup() {
+    // Start from empty storage: closed rollups stored here would raise the device's next keys
+    nvs_flash_erase();
+    nvs_flash_init();
+    UNITY_BEGIN();
+    RUN_TEST(test_rollups_accumulate_open);
+    RUN_TEST(test_rollups_close_on_new_day);
+    RUN_TEST(test_rollups_replay_skips_stored);
+    RUN_TEST(test_rollups_serialize);
+    UNITY_END();
+}
+
+void loop() {}
@@ -1,6 +0,0 @@
-// SleepManager removed. Placeholder test to keep build system intact.
-#include <Arduino.h>
-#include <unity.h>
-void test_placeholder(){ TEST_ASSERT_TRUE(true); }
-void setup(){ UNITY_BEGIN(); RUN_TEST(test_placeholder); UNITY_END(); }
-void loop(){}
@@ -0,0 +1,93 @@
+#include <Arduino.h>
+#include <unity.h>
+#include "SleepPolicy.h"
+
+// Simulated clock: every decision gets an explicit nowMs
+static SleepPolicy::Inputs at(uint32_t nowMs) {
+    SleepPolicy::Inputs in{};
+    in.nowMs = nowMs;
+    in.msToNextPhase = UINT32_MAX;
+    return in;
+}
+
+void test_sleep_policy_radio_off_idle() {
+    SleepPolicy& p = SleepPolicy::instance();
+    p.noteActivity(1000);
+    SleepPolicy::Decision d = p.decide(at(1000));
+    TEST_ASSERT_EQUAL(SLEEP_LIGHT, d.action);
+    TEST_ASSERT_EQUAL_UINT32(SLEEP_LIGHT_MAX_MS < SLEEP_IDLE_MS ? SLEEP_LIGHT_MAX_MS : SLEEP_IDLE_MS, d.durationMs);
+    d = p.decide(at(1000 + SLEEP_IDLE_MS - 5));
+    TEST_ASSERT_EQUAL(SLEEP_NONE, d.action); // shorter than SLEEP_LIGHT_MIN_MS: block instead
+    TEST_ASSERT_EQUAL_UINT32(5, d.durationMs);
+    d = p.decide(at(1000 + SLEEP_IDLE_MS));
+    TEST_ASSERT_EQUAL(SLEEP_DEEP, d.action);
+}
+
+void test_sleep_policy_work_in_flight() {
+    SleepPolicy& p = SleepPolicy::instance();
+    p.noteActivity(0);
+    SleepPolicy::Inputs in = at(SLEEP_IDLE_MS * 2);
+    in.debounceActive = true;
+    SleepPolicy::Decision d = p.decide(in);
+    TEST_ASSERT_EQUAL(SLEEP_NONE, d.action);
+    TEST_ASSERT_EQUAL_UINT32(0, d.durationMs); // poll until the window closes
+    // The debounce window counted as activity, so the idle time restarts from there
+    in = at(SLEEP_IDLE_MS * 2 + 100);
+    TEST_ASSERT_EQUAL(SLEEP_LIGHT, p.decide(in).action);
+    in.puffInProgress = true;
+    TEST_ASSERT_EQUAL(SLEEP_NONE, p.decide(in).action);
+    in = at(SLEEP_IDLE_MS * 10);
+    in.notifyPending = true;
+    TEST_ASSERT_EQUAL(SLEEP_NONE, p.decide(in).action);
+}
+
+void test_sleep_policy_ble_thresholds() {
+    SleepPolicy& p = SleepPolicy::instance();
+    p.noteActivity(0);
+    SleepPolicy::Inputs in = at(SLEEP_IDLE_MS + 1);
+    in.bleActive = true;
+    in.lastBleInteractionMs = 0;
+    SleepPolicy::Decision d = p.decide(in);
+    TEST_ASSERT_EQUAL(SLEEP_NONE, d.action); // advertising: block (esp_pm light sleeps), not idle yet
+    TEST_ASSERT_EQUAL_UINT32(SLEEP_BLOCK_MAX_MS < SLEEP_ADVERTISING_IDLE_MS - SLEEP_IDLE_MS - 1 ? SLEEP_BLOCK_MAX_MS : SLEEP_ADVERTISING_IDLE_MS - SLEEP_IDLE_MS - 1, d.durationMs);
+    in.nowMs = SLEEP_ADVERTISING_IDLE_MS;
+    TEST_ASSERT_EQUAL(SLEEP_DEEP, p.decide(in).action);
+    in.connected = true;
+    TEST_ASSERT_EQUAL(SLEEP_NONE, p.decide(in).action);
+    in.lastBleInteractionMs = SLEEP_ADVERTISING_IDLE_MS; // a request resets the idle time
+    in.nowMs = SLEEP_ADVERTISING_IDLE_MS + SLEEP_CONNECTED_IDLE_MS - 1;
+    d = p.decide(in);
+    TEST_ASSERT_EQUAL(SLEEP_NONE, d.action);
+    TEST_ASSERT_EQUAL_UINT32(1, d.durationMs); // blocks exactly until the idle limit
+    in.nowMs += 1;
+    TEST_ASSERT_EQUAL(SLEEP_DEEP, p.decide(in).action);
+}
+
+void test_sleep_policy_phase_deadline() {
+    SleepPolicy& p = SleepPolicy::instance();
+    p.noteActivity(0);
+    SleepPolicy::Inputs in = at(SLEEP_IDLE_MS);
+    in.msToNextPhase = SLEEP_MIN_DEEP_MS - 1000;
+    SleepPolicy::Decision d = p.decide(in);
+    TEST_ASSERT_EQUAL(SLEEP_LIGHT, d.action); // wait out the boundary instead of a quick timer wake
+    TEST_ASSERT_EQUAL_UINT32(SLEEP_MIN_DEEP_MS - 1000, d.durationMs);
+    in.msToNextPhase = SLEEP_MIN_DEEP_MS;
+    TEST_ASSERT_EQUAL(SLEEP_DEEP, p.decide(in).action);
+    // Before the idle limit the light sleep ends at the boundary
+    in = at(100);
+    in.msToNextPhase = 500;
+    d = p.decide(in);
+    TEST_ASSERT_EQUAL(SLEEP_LIGHT, d.action);
+    TEST_ASSERT_EQUAL_UINT32(500, d.durationMs);
+}
+
+void setup() {
+    UNITY_BEGIN();
+    RUN_TEST(test_sleep_policy_radio_off_idle);
+    RUN_TEST(test_sleep_policy_work_in_flight);
+    RUN_TEST(test_sleep_policy_ble_thresholds);
+    RUN_TEST(test_sleep_policy_phase_deadline);
+    UNITY_END();
+}
+
+void loop() {}
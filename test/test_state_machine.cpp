@@ -1,14 +1,78 @@
 #include <Arduino.h>
 #include <unity.h>
+#include <nvs_flash.h>
 #include "StateMachine.h"
+#include "PhaseSchedule.h"
+#include "Device.h"
+
+// The puff edge that reaches the allowance must lock before persistence and BLE run
+static constexpr uint32_t LOCKDOWN_LATENCY_BUDGET_US = 500;
+static uint32_t s_lockUs = 0;
+
+static void lockRecorder(state_t state) {
+    if (state == LOCKDOWN) {
+        Device::lockCoil();
+        s_lockUs = micros();
+    } else {
+        Device::unlockCoil();
+    }
+}
 
 void test_state_machine_init() {
     TEST_ASSERT_EQUAL(StateMachine::instance().getCurrentState(), PUFF_COUNTING);
 }
 
+void test_phase_schedule_taper() {
+    PhaseSchedule schedule(600, 10, 3, 2, 5);
+    TEST_ASSERT_EQUAL(10, schedule.phaseAt(0).maxPuffs);
+    TEST_ASSERT_EQUAL(4, schedule.phaseAt(2).maxPuffs);
+    TEST_ASSERT_EQUAL(2, schedule.phaseAt(3).maxPuffs);
+    TEST_ASSERT_EQUAL(2, schedule.phaseAt(5).maxPuffs);
+    TEST_ASSERT_EQUAL(600, schedule.phaseAt(4).phaseDuration);
+    TEST_ASSERT_EQUAL(4, schedule.phaseAt(4).phaseIndex);
+    TEST_ASSERT_TRUE(schedule.hasPhase(5));
+    TEST_ASSERT_FALSE(schedule.hasPhase(6));
+    TEST_ASSERT_FALSE(schedule.hasPhase(-1));
+}
+
+void test_phase_schedule_open_ended() {
+    PhaseSchedule schedule(3600, 20, 0, 1, 0);
+    TEST_ASSERT_TRUE(schedule.hasPhase(40000));
+    TEST_ASSERT_EQUAL(20, schedule.phaseAt(40000).maxPuffs);
+    TEST_ASSERT_EQUAL_UINT32(PHASE_INDEX_LIMIT, schedule.lastPhase());
+}
+
+void test_state_machine_lockdown_latency() {
+    StateMachine& sm = StateMachine::instance();
+    sm.setStateListener(lockRecorder);
+    TEST_ASSERT_EQUAL(COIL_UNLOCKED, Device::getState());
+    int remaining = sm.currentPhase().maxPuffs - sm.currentPhase().puffsTaken;
+    for (int i = 0; i < remaining; ++i) {
+        sm.handle_state_rising(Timebase::instance().sample());
+        delay(MIN_PUFF_DURATION_MILLISECONDS + 10);
+        TEST_ASSERT_EQUAL(COIL_UNLOCKED, Device::getState());
+        uint32_t fallUs = micros();
+        sm.handle_state_falling(Timebase::instance().sample());
+        TEST_ASSERT_EQUAL_UINT32(0, (uint32_t)sm.puffInProgress());
+        if (i + 1 < remaining) continue;
+        // Locked inside handle_state_falling, not on a later loop pass
+        TEST_ASSERT_EQUAL(LOCKDOWN, sm.getCurrentState());
+        TEST_ASSERT_EQUAL(COIL_LOCKED, Device::getState());
+        TEST_ASSERT_LESS_OR_EQUAL_UINT32(LOCKDOWN_LATENCY_BUDGET_US, s_lockUs - fallUs);
+    }
+    sm.setStateListener(nullptr);
+}
+
 void setup() {
+    // Start from empty storage so the phase allowance is known
+    nvs_flash_erase();
+    nvs_flash_init();
+    Device::setupPins();
     UNITY_BEGIN();
     RUN_TEST(test_state_machine_init);
+    RUN_TEST(test_phase_schedule_taper);
+    RUN_TEST(test_phase_schedule_open_ended);
+    RUN_TEST(test_state_machine_lockdown_latency);
     UNITY_END();
 }
 
@@ -0,0 +1,38 @@
+#include <Arduino.h>
+#include <unity.h>
+#include "Timebase.h"
+
+static constexpr uint32_t T0 = 1750000000;
+
+void test_timebase_sync_moves_wall_not_mono() {
+    Timebase& tb = Timebase::instance();
+    TEST_ASSERT_TRUE(tb.setEpoch(T0));
+    Timebase::Now a = tb.sample();
+    TEST_ASSERT_UINT32_WITHIN(1, T0, a.epochSec);
+    // A sync backwards in the middle of a measurement
+    TEST_ASSERT_TRUE(tb.setEpoch(T0 - 3600));
+    delay(20);
+    Timebase::Now b = tb.sample();
+    TEST_ASSERT_UINT32_WITHIN(1, T0 - 3600, b.epochSec);
+    TEST_ASSERT_TRUE(b.monoUs - a.monoUs >= 20000);
+    TEST_ASSERT_TRUE(b.monoUs - a.monoUs < 1000000);
+}
+
+void test_timebase_cached_sample() {
+    Timebase& tb = Timebase::instance();
+    Timebase::Now a = tb.sample();
+    delay(5);
+    TEST_ASSERT_TRUE(tb.current().monoUs == a.monoUs);
+    TEST_ASSERT_EQUAL_UINT32(a.epochSec, tb.current().epochSec);
+    TEST_ASSERT_EQUAL_UINT32(a.epochSec, tb.epochAt(a.monoUs));
+    TEST_ASSERT_UINT32_WITHIN(1, a.epochSec, tb.epochSec());
+}
+
+void setup() {
+    UNITY_BEGIN();
+    RUN_TEST(test_timebase_sync_moves_wall_not_mono);
+    RUN_TEST(test_timebase_cached_sample);
+    UNITY_END();
+}
+
+void loop() {}
@@ -0,0 +1,60 @@
+#include <Arduino.h>
+#include <unity.h>
+#include <ctime>
+#include <cstdlib>
+#include "Timer.h"
+
+static constexpr uint32_t T0 = 1750000000;
+
+static void expectLikeStrftime(uint32_t epochSec) {
+    time_t raw = (time_t)epochSec;
+    struct tm t;
+    localtime_r(&raw, &t);
+    char expected[32], actual[32];
+    strftime(expected, sizeof(expected), "%Y-%m-%d %H:%M:%S", &t);
+    TEST_ASSERT_TRUE(epochToTimestamp(epochSec, actual, sizeof(actual)));
+    TEST_ASSERT_EQUAL_STRING(expected, actual);
+}
+
+void test_timer_timestamp_format() {
+    char ts[32];
+    setenv("TZ", "UTC0", 1);
+    tzset();
+    TEST_ASSERT_TRUE(epochToTimestamp(T0, ts, sizeof(ts)));
+    TEST_ASSERT_EQUAL_STRING("2025-06-15 15:06:40", ts);
+    // Cached day, then the last second of it and the next midnight
+    TEST_ASSERT_TRUE(epochToTimestamp(T0 + 1, ts, sizeof(ts)));
+    TEST_ASSERT_EQUAL_STRING("2025-06-15 15:06:41", ts);
+    TEST_ASSERT_TRUE(epochToTimestamp(1750031999, ts, sizeof(ts)));
+    TEST_ASSERT_EQUAL_STRING("2025-06-15 23:59:59", ts);
+    TEST_ASSERT_TRUE(epochToTimestamp(1750032000, ts, sizeof(ts)));
+    TEST_ASSERT_EQUAL_STRING("2025-06-16 00:00:00", ts);
+    // Back to a day before the cached one
+    TEST_ASSERT_TRUE(epochToTimestamp(T0 - 86400, ts, sizeof(ts)));
+    TEST_ASSERT_EQUAL_STRING("2025-06-14 15:06:40", ts);
+    TEST_ASSERT_FALSE(epochToTimestamp(T0, ts, 19));
+}
+
+void test_timer_timestamp_matches_strftime_across_dst() {
+    setenv("TZ", "CET-1CEST,M3.5.0,M10.5.0/3", 1);
+    tzset();
+    // Every 7 minutes across the 2025 spring-forward and fall-back days
+    for (uint32_t t = 1743206400; t < 1743379200; t += 421) expectLikeStrftime(t);
+    for (uint32_t t = 1761433200 - 86400; t < 1761433200 + 86400; t += 421) expectLikeStrftime(t);
+    // Each side of both changes
+    expectLikeStrftime(1743296399);
+    expectLikeStrftime(1743296400);
+    expectLikeStrftime(1761440399);
+    expectLikeStrftime(1761440400);
+    setenv("TZ", "UTC0", 1);
+    tzset();
+}
+
+void setup() {
+    UNITY_BEGIN();
+    RUN_TEST(test_timer_timestamp_format);
+    RUN_TEST(test_timer_timestamp_matches_strftime_across_dst);
+    UNITY_END();
+}
+
+void loop() {}
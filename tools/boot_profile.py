@@ -0,0 +1,111 @@
+#!/usr/bin/env python3
+"""Pretty-print boot profiles read from the Vetra diagnostics characteristic.
+
+Usage:
+    boot_profile.py <hex>             # value as copied from a BLE client (spaces/dashes ok)
+    boot_profile.py --file dump.bin   # raw bytes
+    ... | boot_profile.py             # hex on stdin
+
+Layout (little-endian, see lib/Utils/BootProfiler.h):
+    [format(1)][stageCount(1)][profileCount(1)]
+    per profile: [seq(2)][fwVersion(2)][wakeCause(1)][bleReason(1)]   (format 1: reserved)
+                 stageCount x [startUs(4)][durationUs(4)]
+
+"first write load" is timed when the first record of the wake is written, not during setup;
+after an RTC resume its start is usually later than "coil ready".
+"""
+
+import argparse
+import struct
+import sys
+
+STAGES = [
+    "nvs_flash_init",
+    "loadMeta",
+    "first write load",
+    "reconstruct",
+    "BLEDevice::init",
+    "service create",
+    "first advertise",
+    "coil ready",
+    "radio on (total)",
+]
+
+BLE_REASONS = {
+    0: "off",
+    1: "always",
+    2: "power-on",
+    3: "no time",
+    4: "long press",
+    5: "unsynced puffs",
+    6: "schedule",
+}
+
+WAKE_CAUSES = {
+    0: "power-on/reset",
+    2: "ext0",
+    3: "ext1",
+    4: "timer",
+    7: "gpio",
+}
+
+STAGE_UNSET = 0xFFFFFFFF
+
+
+def parse(data):
+    if len(data) < 3:
+        raise ValueError("payload too short")
+    fmt, stage_count, count = data[0], data[1], data[2]
+    if fmt not in (1, 2):
+        raise ValueError("unsupported format version %d" % fmt)
+    profiles = []
+    idx = 3
+    for _ in range(count):
+        seq, fw, wake, reason = struct.unpack_from("<HHBB", data, idx)
+        idx += 6
+        stages = []
+        for _ in range(stage_count):
+            start, dur = struct.unpack_from("<II", data, idx)
+            idx += 8
+            stages.append((start, dur))
+        profiles.append({"seq": seq, "fw": fw, "wake": wake, "ble": reason if fmt >= 2 else None, "stages": stages})
+    return profiles
+
+
+def stage_name(i):
+    return STAGES[i] if i < len(STAGES) else "stage %d" % i
+
+
+def print_profiles(profiles):
+    if not profiles:
+        print("No boot profiles recorded.")
+        return
+    for p in profiles:
+        ble = "" if p["ble"] is None else "  ble: %s" % BLE_REASONS.get(p["ble"], str(p["ble"]))
+        print("Boot #%d  fw %d.%d  wake: %s%s" % (
+            p["seq"], p["fw"] >> 8, p["fw"] & 0xFF, WAKE_CAUSES.get(p["wake"], str(p["wake"])), ble))
+        print("  %-18s %12s %12s" % ("stage", "start (us)", "duration (us)"))
+        for i, (start, dur) in enumerate(p["stages"]):
+            if start == STAGE_UNSET:
+                print("  %-18s %12s %12s" % (stage_name(i), "-", "-"))
+            else:
+                print("  %-18s %12d %12d" % (stage_name(i), start, dur))
+        print()
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    ap.add_argument("hex", nargs="?", help="characteristic value as hex")
+    ap.add_argument("--file", help="read raw bytes from file")
+    args = ap.parse_args()
+    if args.file:
+        with open(args.file, "rb") as f:
+            data = f.read()
+    else:
+        text = args.hex if args.hex else sys.stdin.read()
+        data = bytes.fromhex("".join(c for c in text if c in "0123456789abcdefABCDEF"))
+    print_profiles(parse(data))
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,81 @@
+#!/usr/bin/env python3
+"""Pretty-print device counters read from the Vetra counters characteristic.
+
+Usage:
+    counters.py <hex>             # value as copied from a BLE client (spaces/dashes ok)
+    counters.py --file dump.bin   # raw bytes
+    ... | counters.py             # hex on stdin
+
+Layout (little-endian, see lib/Utils/Counters.h):
+    [format(1)][valueCount(1)] + valueCount x [value(4)]
+Stored counters come first in CounterId order, then log lines dropped,
+heap free bytes and heap minimum-free bytes.
+"""
+
+import argparse
+import struct
+import sys
+
+COUNTERS = [
+    "nvs bytes (puff)",
+    "nvs bytes (phase)",
+    "nvs bytes (meta)",
+    "nvs commits",
+    "block rotations",
+    "puffs notify",
+    "puffs indicate",
+    "phases notify",
+    "phases indicate",
+    "logger notify",
+    "logger indicate",
+    "edges raw",
+    "edges debounced",
+    "puffs invalid",
+    "nvs bytes (rollup)",
+    "blocks recycled",
+    "unsynced puffs lost",
+]
+
+DERIVED = [
+    "log lines dropped",
+    "heap free",
+    "heap min free",
+]
+
+
+def parse(data):
+    if len(data) < 2:
+        raise ValueError("payload too short")
+    fmt, count = data[0], data[1]
+    if fmt != 1:
+        raise ValueError("unsupported format version %d" % fmt)
+    return list(struct.unpack_from("<%dI" % count, data, 2))
+
+
+def value_names(count):
+    stored = count - len(DERIVED)
+    names = [COUNTERS[i] if i < len(COUNTERS) else "counter %d" % i for i in range(stored)]
+    return names + DERIVED
+
+
+def print_counters(values):
+    for name, value in zip(value_names(len(values)), values):
+        print("  %-20s %12d" % (name, value))
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    ap.add_argument("hex", nargs="?", help="characteristic value as hex")
+    ap.add_argument("--file", help="read raw bytes from file")
+    args = ap.parse_args()
+    if args.file:
+        with open(args.file, "rb") as f:
+            data = f.read()
+    else:
+        text = args.hex if args.hex else sys.stdin.read()
+        data = bytes.fromhex("".join(c for c in text if c in "0123456789abcdefABCDEF"))
+    print_counters(parse(data))
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,142 @@
+/**
+ * @file alloc_check.cpp
+ * @brief Asserts the steady-state loop, puff, persistence and sync paths never touch the heap.
+ *
+ * Built with ALLOC_TRACKING=1 and the allocator wrapped (see alloc_check.sh). After a warm-up
+ * that lets every lazily initialized path run once, each loop-like iteration (counters,
+ * metrics, logging and log draining) and each puff (puff append, rollups, phase update,
+ * checkpoints, phase starts, history reads, acknowledgement and compaction) must make zero
+ * allocations outside the host NVS model. Exits 1 and names the module on the first failure.
+ *
+ * Usage: alloc_check [--puffs N]
+ *
+ * @author Vetra Firmware Team
+ * @copyright Copyright (c) 2025 Vetra
+ */
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include "AllocTracker.h"
+#include "Counters.h"
+#include "LogBuffer.h"
+#include "Logger.h"
+#include "Metrics.h"
+#include "PersistenceManager.h"
+#include "Rollups.h"
+#include "nvs_sim.h"
+
+void host_advance_ms(uint64_t ms);
+
+static const char* const MODULE_NAMES[ALLOC_MODULE_COUNT] = { "other", "app", "state", "persistence", "logger", "ble", "host" };
+
+static const uint32_t START_SEC = 1735689600; // 2025-01-01T00:00:00Z
+static const uint32_t PHASE_SEC = 3600;
+static const uint32_t PUFF_GAP_SEC = 300;
+
+struct Sim {
+    PhaseModel phase{0, PHASE_SEC, START_SEC, MAX_PUFFS, 0};
+    uint32_t puffNumber = 0;
+    uint32_t t = START_SEC;
+};
+
+// The work App::loop does on every iteration that does not involve the radio or pins
+static void loopIteration() {
+    AllocTracker::Scope alloc(ALLOC_APP);
+    uint32_t startUs = Metrics::nowUs();
+    Counters::instance().add(CNT_EDGES_DEBOUNCED);
+    Logger::infof("[AllocCheck] loop at %u us", (unsigned)startUs);
+    char line[LogBuffer::lineCapacity()];
+    while (LogBuffer::instance().pop(line, sizeof(line)) > 0) {}
+    host_advance_ms(10);
+    Metrics::instance().record(METRIC_LOOP_ITERATION, Metrics::nowUs() - startUs);
+}
+
+static void saveCheckpoint(PersistenceManager& pm, const PhaseModel& phase) {
+    PersistenceManager::CheckpointRecord cp{};
+    cp.phaseIndex = (uint16_t)phase.phaseIndex;
+    cp.puffRecordsCovered = pm.getCursor(PUFF_CH).totalRecords;
+    cp.phaseRecordsCovered = pm.getCursor(PHASE_CH).totalRecords;
+    cp.rollupRecordsCovered = pm.getCursor(ROLLUP_CH).totalRecords;
+    cp.rollups = Rollups::instance().state();
+    pm.saveCheckpoint(cp);
+}
+
+// One puff through the persistence paths handle_state_falling and a syncing client exercise
+static void puff(Sim& s) {
+    PersistenceManager& pm = PersistenceManager::instance();
+    AllocTracker::Scope alloc(ALLOC_STATE);
+    s.t += PUFF_GAP_SEC;
+    while (s.t >= s.phase.phaseStartSec + PHASE_SEC) {
+        s.phase.phaseIndex++;
+        s.phase.phaseStartSec += PHASE_SEC;
+        s.phase.puffsTaken = 0;
+        pm.appendPhaseStart(s.phase);
+        saveCheckpoint(pm, s.phase);
+    }
+    pm.recordEpoch(s.t);
+    PuffModel p{(int)(++s.puffNumber), s.t, 1500, s.phase.phaseIndex};
+    pm.appendPuff(p);
+    Rollups::instance().onPuff(s.t, 1500, (uint16_t)s.phase.phaseIndex);
+    s.phase.puffsTaken++;
+    pm.updateCurrentPhasePuffsTaken((uint16_t)s.phase.phaseIndex, (uint16_t)s.phase.puffsTaken);
+    if (s.puffNumber % CHECKPOINT_INTERVAL == 0) saveCheckpoint(pm, s.phase);
+
+    // Sync: read back the recent history and rollups, acknowledge, and compact as before sleep
+    uint32_t from = pm.findPuffAtOrAfter(s.t - 3600);
+    uint32_t seen = 0;
+    pm.forEachPuff([&seen](const PersistenceManager::PuffRecord&) { seen++; }, from);
+    uint8_t frame[ROLLUP_HEADER + 8 * ROLLUP_ENTRY];
+    Rollups::instance().serialize(ROLLUP_DAY, 0, 8, frame, sizeof(frame));
+    pm.acknowledgePuffs(s.puffNumber);
+    pm.compact();
+}
+
+static bool expectNoAllocs(const char* what, uint32_t iteration) {
+    AllocTracker& tracker = AllocTracker::instance();
+    if (tracker.totalAllocs() == 0) return true;
+    fprintf(stderr, "FAIL: %s %u allocated:", what, iteration);
+    for (uint8_t m = 0; m < ALLOC_MODULE_COUNT; ++m) {
+        AllocTracker::Stats st = tracker.stats((AllocModule)m);
+        if (m != ALLOC_HOST && st.allocs) fprintf(stderr, " %s=%u (%u bytes)", MODULE_NAMES[m], st.allocs, st.bytes);
+    }
+    fprintf(stderr, "\n");
+    return false;
+}
+
+int main(int argc, char** argv) {
+    uint32_t puffs = 2000;
+    if (argc == 3 && !strcmp(argv[1], "--puffs")) puffs = (uint32_t)strtoul(argv[2], nullptr, 10);
+    else if (argc != 1) {
+        fprintf(stderr, "usage: %s [--puffs N]\n", argv[0]);
+        return 2;
+    }
+    if (!AllocTracker::enabled()) {
+        fprintf(stderr, "alloc_check must be built with -DALLOC_TRACKING=1 (use alloc_check.sh)\n");
+        return 2;
+    }
+
+    nvs_sim_reset(NVS_PARTITION_PAGES);
+    PersistenceManager& pm = PersistenceManager::instance();
+    pm.init();
+    Sim sim;
+    pm.appendPhaseStart(sim.phase);
+
+    // Warm-up: one full block of puffs so every rotation, checkpoint and compaction path has run
+    for (uint32_t i = 0; i < 2 * CHECKPOINT_INTERVAL; ++i) { loopIteration(); puff(sim); }
+
+    for (uint32_t i = 0; i < puffs; ++i) {
+        AllocTracker::instance().reset();
+        loopIteration();
+        if (!expectNoAllocs("loop iteration", i)) return 1;
+        puff(sim);
+        if (!expectNoAllocs("puff", sim.puffNumber)) return 1;
+    }
+    if (nvs_sim_stats().failedWrites) {
+        fprintf(stderr, "FAIL: NVS model ran out of space\n");
+        return 1;
+    }
+    printf("OK: %u loop iterations and %u puffs without heap allocations (%u phases, %u puffs acknowledged)\n",
+           puffs, puffs, (unsigned)sim.phase.phaseIndex + 1, (unsigned)pm.ackedPuffs());
+    return 0;
+}
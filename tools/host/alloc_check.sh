@@ -0,0 +1,14 @@
+#!/usr/bin/env bash
+# Build and run the zero-allocation check on the host (allocator wrapped, ALLOC_TRACKING=1).
+# Usage: tools/host/alloc_check.sh [--puffs N]   (extra compiler flags via CXXFLAGS)
+set -euo pipefail
+root="$(cd "$(dirname "$0")/../.." && pwd)"
+out="${OUT:-/tmp/vetra_alloc_check}"
+"${CXX:-g++}" -std=c++17 -O2 -DLOG_LEVEL=2 -DALLOC_TRACKING=1 ${CXXFLAGS:-} \
+    -I"$root/tools/host/include" -I"$root/lib/Logger" -I"$root/lib/StateMachine" -I"$root/lib/Utils" \
+    "$root/tools/host/alloc_check.cpp" "$root/tools/host/nvs_sim.cpp" "$root/tools/host/host_stubs.cpp" \
+    "$root/lib/Utils/PersistenceManager.cpp" "$root/lib/Utils/RecordChannel.cpp" "$root/lib/Utils/Rollups.cpp" "$root/lib/Utils/Counters.cpp" "$root/lib/Utils/Metrics.cpp" \
+    "$root/lib/Utils/BootProfiler.cpp" "$root/lib/Utils/AllocTracker.cpp" "$root/lib/Logger/Logger.cpp" "$root/lib/Logger/LogBuffer.cpp" \
+    -Wl,--wrap=malloc -Wl,--wrap=free -Wl,--wrap=calloc -Wl,--wrap=realloc \
+    -o "$out"
+exec "$out" "$@"
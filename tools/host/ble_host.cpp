@@ -0,0 +1,110 @@
+/**
+ * @file ble_host.cpp
+ * @brief Host stand-in for the Arduino BLE library: one server, a fixed characteristic pool, no radio.
+ *
+ * BLEManager runs unmodified on top of it. A simulated client connects, writes characteristics
+ * and CCCDs through host_sim.h; the callbacks run inline, as if the BLE task had been scheduled
+ * between two loop iterations. Notifications and indications are counted, not delivered.
+ */
+
+#include <BLEDevice.h>
+#include <BLE2902.h>
+#include <cstring>
+#include "host_sim.h"
+
+static BLEServer s_server;
+static BLEAdvertising s_advertising;
+static bool s_initialized = false;
+static uint64_t s_pushes = 0;
+static uint16_t s_nextHandle = 1;
+
+// -----------------------------------------------------------------------------
+// Library classes
+// -----------------------------------------------------------------------------
+
+void BLEDescriptor::setValue(const uint8_t* data, size_t len) {
+    length = len < sizeof(value) ? len : sizeof(value);
+    memcpy(value, data, length);
+}
+
+void BLECharacteristic::setValue(const uint8_t* data, size_t len) {
+    length = len < VALUE_CAPACITY ? len : VALUE_CAPACITY;
+    memcpy(value, data, length);
+}
+
+void BLECharacteristic::notify(bool) { pushes++; s_pushes++; }
+void BLECharacteristic::indicate() { pushes++; s_pushes++; }
+
+BLECharacteristic* BLEService::getCharacteristic(const char* uuid) {
+    for (size_t i = 0; i < count; ++i) {
+        if (!strcmp(chars[i].uuid, uuid)) return &chars[i];
+    }
+    return nullptr;
+}
+
+BLECharacteristic* BLEService::createCharacteristic(const char* uuid, uint32_t) {
+    // A stack restart registers the same table again; reuse the slot
+    BLECharacteristic* c = getCharacteristic(uuid);
+    if (!c) {
+        if (count == MAX_CHARACTERISTICS) return nullptr;
+        c = &chars[count++];
+    }
+    *c = BLECharacteristic();
+    c->uuid = uuid;
+    return c;
+}
+
+void BLEDevice::init(std::string) { s_initialized = true; }
+
+void BLEDevice::deinit(bool) {
+    s_initialized = false;
+    s_advertising.stop();
+    s_server.connected = 0;
+}
+
+bool BLEDevice::getInitialized() { return s_initialized; }
+BLEServer* BLEDevice::createServer() { return &s_server; }
+BLEAdvertising* BLEDevice::getAdvertising() { return &s_advertising; }
+void BLEDevice::startAdvertising() { s_advertising.start(); }
+void BLEDevice::stopAdvertising() { s_advertising.stop(); }
+
+// -----------------------------------------------------------------------------
+// Simulated client
+// -----------------------------------------------------------------------------
+
+bool host_ble_up() { return s_initialized; }
+
+bool host_ble_connect(bool connected) {
+    if (!s_initialized || (s_server.connected != 0) == connected) return false;
+    s_server.connected = connected ? 1 : 0;
+    if (connected) s_advertising.stop();
+    BLEServerCallbacks* cb = s_server.getCallbacks();
+    if (cb) {
+        if (connected) cb->onConnect(&s_server);
+        else cb->onDisconnect(&s_server);
+    }
+    return true;
+}
+
+bool host_ble_write(const char* uuid, const uint8_t* data, size_t len) {
+    if (!s_initialized) return false;
+    BLECharacteristic* c = s_server.getService()->getCharacteristic(uuid);
+    if (!c || !c->getCallbacks()) return false;
+    c->setValue(data, len);
+    c->getCallbacks()->onWrite(c);
+    return true;
+}
+
+bool host_ble_subscribe(const char* uuid, uint8_t cccd) {
+    if (!s_initialized) return false;
+    BLECharacteristic* c = s_server.getService()->getCharacteristic(uuid);
+    BLEDescriptor* d = c ? c->getDescriptor() : nullptr;
+    if (!d || !d->getCallbacks()) return false;
+    if (d->getHandle() == 0xFFFF) d->setHandle(s_nextHandle++);
+    uint8_t value[2] = {cccd, 0};
+    d->setValue(value, sizeof(value));
+    d->getCallbacks()->onWrite(d);
+    return true;
+}
+
+uint64_t host_ble_pushes() { return s_pushes; }
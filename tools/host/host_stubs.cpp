@@ -0,0 +1,269 @@
+/**
+ * @file host_stubs.cpp
+ * @brief Host stand-ins for the Arduino clock and pins, heap queries, FreeRTOS and sleep control.
+ *
+ * The clock is virtual: it only advances through delay(), waits or host_advance_ms(), so replays
+ * are deterministic and independent of wall time. Scripted input edges (host_sim.h) are applied
+ * at their own time as the clock passes them, and a pin whose level matches the interrupt level
+ * armed on it runs its ISR, as the level interrupts do on the device.
+ */
+
+#include <Arduino.h>
+#include <esp_timer.h>
+#include <esp_system.h>
+#include <esp_sleep.h>
+#include <esp_pm.h>
+#include <hal/gpio_ll.h>
+#include <freertos/semphr.h>
+#include <freertos/task.h>
+#include <freertos/event_groups.h>
+#include <sys/time.h>
+#include "host_sim.h"
+
+// -----------------------------------------------------------------------------
+// Clock
+// -----------------------------------------------------------------------------
+
+static uint64_t s_nowMs = 0;
+static int64_t s_wallOffsetUs = 0;   // gettimeofday() = clock + offset
+static void (*s_idleHook)() = nullptr;
+
+// -----------------------------------------------------------------------------
+// Pins and level interrupts
+// -----------------------------------------------------------------------------
+
+static constexpr uint8_t HOST_PINS = 32;
+
+struct HostPin {
+    uint8_t level;
+    gpio_int_type_t armed;
+    void (*isr)();
+};
+
+gpio_dev_t GPIO;
+static HostPin s_pins[HOST_PINS];
+static HostInput* s_input = nullptr;
+static bool s_inIsr = false;
+static bool s_isrFired = false;       // an ISR ran since the current light sleep began
+static uint64_t s_edgesApplied = 0;
+static uint64_t s_isrCalls = 0;
+
+static bool levelArmed(const HostPin& p) {
+    return (p.armed == GPIO_INTR_HIGH_LEVEL && p.level) || (p.armed == GPIO_INTR_LOW_LEVEL && !p.level);
+}
+
+// Run the ISR while its level is armed; the firmware's ISRs re-arm for the opposite level.
+// A re-arm from inside the ISR is evaluated once it returns.
+static void servicePin(uint8_t pin) {
+    if (s_inIsr || pin >= HOST_PINS) return;
+    HostPin& p = s_pins[pin];
+    for (int guard = 0; guard < 4 && p.isr && levelArmed(p); ++guard) {
+        s_inIsr = true;
+        s_isrCalls++;
+        s_isrFired = true;
+        p.isr();
+        s_inIsr = false;
+    }
+}
+
+// Advance to untilMs applying due edges; returns early once *stop is set by an ISR
+static void runUntil(uint64_t untilMs, const volatile bool* stop) {
+    HostEdge e;
+    while (!(stop && *stop) && s_input && s_input->peek(e) && e.atMs <= untilMs) {
+        if (e.atMs > s_nowMs) s_nowMs = e.atMs;
+        s_input->pop();
+        host_set_pin(e.pin, e.level);
+        s_edgesApplied++;
+    }
+    if (stop && *stop) return;
+    if (untilMs > s_nowMs) s_nowMs = untilMs;
+}
+
+void host_advance_ms(uint64_t ms) { runUntil(s_nowMs + ms, nullptr); }
+uint64_t host_now_ms() { return s_nowMs; }
+void host_set_idle_hook(void (*hook)()) { s_idleHook = hook; }
+void host_set_wall_base(uint32_t epochSec) { s_wallOffsetUs = (int64_t)epochSec * 1000000LL - (int64_t)(s_nowMs * 1000); }
+
+void host_set_input(HostInput* input) { s_input = input; }
+
+void host_set_pin(uint8_t pin, int level) {
+    if (pin >= HOST_PINS) return;
+    s_pins[pin].level = level ? 1 : 0;
+    servicePin(pin);
+}
+
+int host_pin_level(uint8_t pin) { return pin < HOST_PINS ? s_pins[pin].level : 0; }
+
+void host_detach_all() {
+    for (uint8_t pin = 0; pin < HOST_PINS; ++pin) {
+        s_pins[pin].isr = nullptr;
+        s_pins[pin].armed = GPIO_INTR_DISABLE;
+    }
+}
+
+uint64_t host_edges_applied() { return s_edgesApplied; }
+uint64_t host_isr_calls() { return s_isrCalls; }
+
+unsigned long millis() { return (unsigned long)s_nowMs; }
+unsigned long micros() { return (unsigned long)(s_nowMs * 1000); }
+void delay(unsigned long ms) { host_advance_ms(ms); }
+int64_t esp_timer_get_time() { return (int64_t)(s_nowMs * 1000); }
+
+void pinMode(uint8_t, uint8_t) {}
+int digitalRead(uint8_t pin) { return host_pin_level(pin); }
+void digitalWrite(uint8_t pin, uint8_t level) { if (pin < HOST_PINS) s_pins[pin].level = level ? 1 : 0; }
+
+void attachInterrupt(uint8_t pin, void (*isr)(), int mode) {
+    if (pin >= HOST_PINS) return;
+    s_pins[pin].isr = isr;
+    s_pins[pin].armed = (mode == ONHIGH_WE) ? GPIO_INTR_HIGH_LEVEL : (mode == ONLOW_WE) ? GPIO_INTR_LOW_LEVEL : GPIO_INTR_DISABLE;
+    servicePin(pin);
+}
+
+void detachInterrupt(uint8_t pin) {
+    if (pin >= HOST_PINS) return;
+    s_pins[pin].isr = nullptr;
+    s_pins[pin].armed = GPIO_INTR_DISABLE;
+}
+
+void gpio_ll_set_intr_type(gpio_dev_t*, gpio_num_t gpio, gpio_int_type_t type) {
+    if ((uint32_t)gpio >= HOST_PINS) return;
+    s_pins[gpio].armed = type;
+    servicePin((uint8_t)gpio);
+}
+
+void gpio_ll_set_level(gpio_dev_t*, gpio_num_t gpio, uint32_t level) {
+    if ((uint32_t)gpio < HOST_PINS) s_pins[gpio].level = level ? 1 : 0;
+}
+
+// -----------------------------------------------------------------------------
+// Wall clock (linked with --wrap=gettimeofday,--wrap=settimeofday where Timebase is used)
+// -----------------------------------------------------------------------------
+
+extern "C" int __wrap_gettimeofday(struct timeval* tv, void*) {
+    int64_t us = (int64_t)(s_nowMs * 1000) + s_wallOffsetUs;
+    tv->tv_sec = (time_t)(us / 1000000LL);
+    tv->tv_usec = (suseconds_t)(us % 1000000LL);
+    return 0;
+}
+
+extern "C" int __wrap_settimeofday(const struct timeval* tv, const void*) {
+    s_wallOffsetUs = (int64_t)tv->tv_sec * 1000000LL + tv->tv_usec - (int64_t)(s_nowMs * 1000);
+    return 0;
+}
+
+// -----------------------------------------------------------------------------
+// Heap queries and power management
+// -----------------------------------------------------------------------------
+
+uint32_t esp_get_free_heap_size() { return 0; }
+uint32_t esp_get_minimum_free_heap_size() { return 0; }
+esp_err_t esp_pm_configure(const void*) { return ESP_OK; }
+
+// -----------------------------------------------------------------------------
+// FreeRTOS
+// -----------------------------------------------------------------------------
+
+static int s_loopTaskToken;
+static volatile bool s_notified = false;
+
+SemaphoreHandle_t xSemaphoreCreateMutex() { static int token; return &token; }
+BaseType_t xSemaphoreTake(SemaphoreHandle_t, TickType_t) { return pdTRUE; }
+BaseType_t xSemaphoreGive(SemaphoreHandle_t) { return pdTRUE; }
+SemaphoreHandle_t xSemaphoreCreateMutexStatic(StaticSemaphore_t* buffer) { return buffer; }
+
+BaseType_t xTaskCreate(TaskFunction_t fn, const char*, uint32_t, void* arg, UBaseType_t, TaskHandle_t* handle) {
+    if (handle) *handle = nullptr;
+    fn(arg);
+    return pdPASS;
+}
+
+void vTaskDelete(TaskHandle_t) {}
+void vTaskDelay(TickType_t ticks) { host_advance_ms(ticks); }
+TaskHandle_t xTaskGetCurrentTaskHandle() { return &s_loopTaskToken; }
+
+uint32_t ulTaskNotifyTake(BaseType_t, TickType_t ticks) {
+    if (s_idleHook) s_idleHook();
+    if (!s_notified) runUntil(s_nowMs + ticks, &s_notified);
+    uint32_t taken = s_notified ? 1 : 0;
+    s_notified = false;
+    return taken;
+}
+
+void vTaskNotifyGiveFromISR(TaskHandle_t, BaseType_t* woken) {
+    s_notified = true;
+    if (woken) *woken = pdTRUE;
+}
+
+struct HostEventGroup { EventBits_t bits; };
+static HostEventGroup s_groups[4];
+static size_t s_groupCount = 0;
+
+EventGroupHandle_t xEventGroupCreate() { return s_groupCount < 4 ? &s_groups[s_groupCount++] : nullptr; }
+EventBits_t xEventGroupSetBits(EventGroupHandle_t g, EventBits_t bits) { return static_cast<HostEventGroup*>(g)->bits |= bits; }
+EventBits_t xEventGroupClearBits(EventGroupHandle_t g, EventBits_t bits) {
+    EventBits_t before = static_cast<HostEventGroup*>(g)->bits;
+    static_cast<HostEventGroup*>(g)->bits &= ~bits;
+    return before;
+}
+EventBits_t xEventGroupWaitBits(EventGroupHandle_t g, EventBits_t bits, BaseType_t clearOnExit, BaseType_t, TickType_t) {
+    EventBits_t now = static_cast<HostEventGroup*>(g)->bits;
+    if (clearOnExit) static_cast<HostEventGroup*>(g)->bits &= ~bits;
+    return now;
+}
+
+// -----------------------------------------------------------------------------
+// Sleep
+// -----------------------------------------------------------------------------
+
+static esp_sleep_wakeup_cause_t s_wakeCause = ESP_SLEEP_WAKEUP_UNDEFINED;
+static uint64_t s_timerWakeUs = 0;
+static bool s_gpioWake = false;
+static uint64_t s_deepGpioMask = 0;
+static bool s_deepGpioHigh = false;
+
+void host_set_wakeup_cause(esp_sleep_wakeup_cause_t cause) { s_wakeCause = cause; }
+esp_sleep_wakeup_cause_t esp_sleep_get_wakeup_cause() { return s_wakeCause; }
+
+esp_err_t esp_sleep_enable_timer_wakeup(uint64_t timeUs) { s_timerWakeUs = timeUs; return ESP_OK; }
+esp_err_t esp_sleep_enable_gpio_wakeup() { s_gpioWake = true; return ESP_OK; }
+
+esp_err_t esp_sleep_disable_wakeup_source(esp_sleep_source_t source) {
+    if (source == ESP_SLEEP_WAKEUP_TIMER || source == ESP_SLEEP_WAKEUP_ALL) s_timerWakeUs = 0;
+    if (source == ESP_SLEEP_WAKEUP_GPIO || source == ESP_SLEEP_WAKEUP_ALL) s_gpioWake = false;
+    return ESP_OK;
+}
+
+esp_err_t esp_deep_sleep_enable_gpio_wakeup(uint64_t gpioMask, esp_deepsleep_gpio_wake_up_mode_t mode) {
+    s_deepGpioMask = gpioMask;
+    s_deepGpioHigh = mode == ESP_GPIO_WAKEUP_GPIO_HIGH;
+    return ESP_OK;
+}
+
+esp_err_t esp_light_sleep_start() {
+    // The armed level interrupts are the GPIO wake sources; their ISR runs as the sleep ends
+    if (s_idleHook) s_idleHook();
+    uint64_t untilMs = s_timerWakeUs ? s_nowMs + (s_timerWakeUs + 999) / 1000 : UINT64_MAX;
+    s_isrFired = false;
+    runUntil(untilMs, s_gpioWake ? &s_isrFired : nullptr);
+    return ESP_OK;
+}
+
+// Bounds of the RTC_DATA_ATTR section; weak so programs without RTC variables still link
+extern char __start_host_rtc_data[] __attribute__((weak));
+extern char __stop_host_rtc_data[] __attribute__((weak));
+
+void host_rtc_reset() {
+    if (__start_host_rtc_data) memset(__start_host_rtc_data, 0, (size_t)(__stop_host_rtc_data - __start_host_rtc_data));
+}
+
+void esp_deep_sleep_start() {
+    HostDeepSleep sleep{s_timerWakeUs, s_deepGpioMask, s_deepGpioHigh};
+    // A deep-sleep wake is a reset: interrupts, notifications and wake sources start over
+    host_detach_all();
+    s_notified = false;
+    s_timerWakeUs = 0;
+    s_gpioWake = false;
+    s_deepGpioMask = 0;
+    throw sleep;
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+/**
+ * @file Arduino.h
+ * @brief Host stand-in for the subset of the Arduino core the firmware uses (clock, pins, interrupts).
+ *
+ * Pin levels and interrupts are modelled by host_stubs.cpp; see host_sim.h for driving them.
+ *
+ * @author Vetra Firmware Team
+ * @copyright Copyright (c) 2025 Vetra
+ */
+
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <cstdio>
+#include <string>
+
+#define IRAM_ATTR
+// Collected in one section so host_rtc_reset() can clear RTC memory as a power-on does
+#define RTC_DATA_ATTR       __attribute__((section("host_rtc_data")))
+#define RTC_NOINIT_ATTR
+
+#define HIGH                1
+#define LOW                 0
+#define INPUT               0x01
+#define OUTPUT              0x03
+#define INPUT_PULLDOWN      0x09
+#define ONLOW_WE            0x0C
+#define ONHIGH_WE           0x0D
+
+unsigned long millis();
+unsigned long micros();
+void delay(unsigned long ms);
+
+void pinMode(uint8_t pin, uint8_t mode);
+int digitalRead(uint8_t pin);
+void digitalWrite(uint8_t pin, uint8_t level);
+void attachInterrupt(uint8_t pin, void (*isr)(), int mode);
+void detachInterrupt(uint8_t pin);
+inline void noInterrupts() {}
+inline void interrupts() {}
@@ -0,0 +1,15 @@
+#pragma once
+
+/**
+ * @file BLE2902.h
+ * @brief Host stand-in for the Client Characteristic Configuration descriptor.
+ */
+
+#include "BLEDescriptor.h"
+
+class BLE2902 : public BLEDescriptor {
+public:
+    BLE2902() {}
+    void setNotifications(bool on) { value[0] = on ? (value[0] | 0x01) : (value[0] & ~0x01); }
+    void setIndications(bool on) { value[0] = on ? (value[0] | 0x02) : (value[0] & ~0x02); }
+};
@@ -0,0 +1,19 @@
+#pragma once
+
+/**
+ * @file BLEAdvertising.h
+ * @brief Host stand-in for Arduino BLE advertising (state only).
+ */
+
+#include <cstdint>
+
+class BLEAdvertising {
+public:
+    void addServiceUUID(const char* uuid) {}
+    void setScanResponse(bool on) {}
+    void setMinPreferred(uint16_t interval) {}
+    void start() { advertising = true; }
+    void stop() { advertising = false; }
+
+    bool advertising = false;
+};
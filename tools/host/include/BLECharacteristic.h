@@ -0,0 +1,50 @@
+#pragma once
+
+/**
+ * @file BLECharacteristic.h
+ * @brief Host stand-in for the Arduino BLE characteristic; notify/indicate are counted, not sent.
+ */
+
+#include <cstdint>
+#include <cstddef>
+#include "BLEDescriptor.h"
+
+class BLECharacteristic;
+
+class BLECharacteristicCallbacks {
+public:
+    virtual ~BLECharacteristicCallbacks() {}
+    virtual void onRead(BLECharacteristic* pCharacteristic) {}
+    virtual void onWrite(BLECharacteristic* pCharacteristic) {}
+};
+
+class BLECharacteristic {
+public:
+    static const uint32_t PROPERTY_READ     = 1 << 0;
+    static const uint32_t PROPERTY_WRITE    = 1 << 1;
+    static const uint32_t PROPERTY_NOTIFY   = 1 << 2;
+    static const uint32_t PROPERTY_BROADCAST = 1 << 3;
+    static const uint32_t PROPERTY_INDICATE = 1 << 4;
+    static const uint32_t PROPERTY_WRITE_NR = 1 << 5;
+
+    static constexpr size_t VALUE_CAPACITY = 512;
+
+    void setCallbacks(BLECharacteristicCallbacks* callbacks) { this->callbacks = callbacks; }
+    BLECharacteristicCallbacks* getCallbacks() const { return callbacks; }
+    void addDescriptor(BLEDescriptor* descriptor) { this->descriptor = descriptor; }
+    BLEDescriptor* getDescriptor() const { return descriptor; }
+    void setValue(const uint8_t* data, size_t len);
+    uint8_t* getData() { return value; }
+    size_t getLength() const { return length; }
+    void notify(bool isNotification = true);
+    void indicate();
+
+    const char* uuid = nullptr;     ///< Set by BLEService::createCharacteristic
+    uint32_t pushes = 0;            ///< notify() + indicate() calls
+
+private:
+    uint8_t value[VALUE_CAPACITY] = {};
+    size_t length = 0;
+    BLECharacteristicCallbacks* callbacks = nullptr;
+    BLEDescriptor* descriptor = nullptr;
+};
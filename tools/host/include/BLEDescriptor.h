@@ -0,0 +1,36 @@
+#pragma once
+
+/**
+ * @file BLEDescriptor.h
+ * @brief Host stand-in for the Arduino BLE descriptor (value held in place, no stack).
+ */
+
+#include <cstdint>
+#include <cstddef>
+
+class BLEDescriptor;
+
+class BLEDescriptorCallbacks {
+public:
+    virtual ~BLEDescriptorCallbacks() {}
+    virtual void onRead(BLEDescriptor* pDescriptor) {}
+    virtual void onWrite(BLEDescriptor* pDescriptor) {}
+};
+
+class BLEDescriptor {
+public:
+    virtual ~BLEDescriptor() {}
+    uint8_t* getValue() { return value; }
+    size_t getLength() const { return length; }
+    uint16_t getHandle() const { return handle; }
+    void setValue(const uint8_t* data, size_t len);
+    void setCallbacks(BLEDescriptorCallbacks* callbacks) { this->callbacks = callbacks; }
+    BLEDescriptorCallbacks* getCallbacks() const { return callbacks; }
+    void setHandle(uint16_t h) { handle = h; }
+
+protected:
+    uint8_t value[2] = {0, 0};
+    size_t length = 2;
+    uint16_t handle = 0xFFFF;
+    BLEDescriptorCallbacks* callbacks = nullptr;
+};
@@ -0,0 +1,21 @@
+#pragma once
+
+/**
+ * @file BLEDevice.h
+ * @brief Host stand-in for the Arduino BLE device singleton (one server, no radio).
+ */
+
+#include <string>
+#include "BLEServer.h"
+#include "BLEAdvertising.h"
+
+class BLEDevice {
+public:
+    static void init(std::string deviceName);
+    static void deinit(bool releaseMemory = false);
+    static bool getInitialized();
+    static BLEServer* createServer();
+    static BLEAdvertising* getAdvertising();
+    static void startAdvertising();
+    static void stopAdvertising();
+};
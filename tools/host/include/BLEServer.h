@@ -0,0 +1,46 @@
+#pragma once
+
+/**
+ * @file BLEServer.h
+ * @brief Host stand-in for the Arduino BLE GATT server and service (fixed characteristic pool).
+ */
+
+#include <cstdint>
+#include "BLECharacteristic.h"
+
+class BLEServer;
+
+class BLEService {
+public:
+    static constexpr size_t MAX_CHARACTERISTICS = 16;
+
+    BLECharacteristic* createCharacteristic(const char* uuid, uint32_t properties);
+    BLECharacteristic* getCharacteristic(const char* uuid);
+    void start() {}
+
+private:
+    BLECharacteristic chars[MAX_CHARACTERISTICS];
+    size_t count = 0;
+};
+
+class BLEServerCallbacks {
+public:
+    virtual ~BLEServerCallbacks() {}
+    virtual void onConnect(BLEServer* pServer) {}
+    virtual void onDisconnect(BLEServer* pServer) {}
+};
+
+class BLEServer {
+public:
+    BLEService* createService(const char* uuid) { return &service; }
+    void setCallbacks(BLEServerCallbacks* callbacks) { this->callbacks = callbacks; }
+    BLEServerCallbacks* getCallbacks() const { return callbacks; }
+    uint32_t getConnectedCount() const { return connected; }
+    BLEService* getService() { return &service; }
+
+    uint32_t connected = 0;         ///< Set by host_ble_connect()
+
+private:
+    BLEService service;
+    BLEServerCallbacks* callbacks = nullptr;
+};
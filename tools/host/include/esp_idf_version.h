@@ -0,0 +1,9 @@
+#pragma once
+
+/**
+ * @file esp_idf_version.h
+ * @brief Host stand-in for the ESP-IDF version macros.
+ */
+
+#define ESP_IDF_VERSION_MAJOR   5
+#define ESP_IDF_VERSION_MINOR   1
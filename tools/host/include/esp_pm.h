@@ -0,0 +1,16 @@
+#pragma once
+
+/**
+ * @file esp_pm.h
+ * @brief Host stand-in for ESP-IDF power management (accepted and ignored).
+ */
+
+#include "esp_err.h"
+
+typedef struct {
+    int max_freq_mhz;
+    int min_freq_mhz;
+    bool light_sleep_enable;
+} esp_pm_config_t;
+
+esp_err_t esp_pm_configure(const void* config);
@@ -0,0 +1,39 @@
+#pragma once
+
+/**
+ * @file esp_sleep.h
+ * @brief Host stand-in for ESP-IDF sleep control.
+ *
+ * Light sleep advances the host clock until the timer or an armed GPIO level wakes it. Deep
+ * sleep throws HostDeepSleep (host_sim.h) so a driver can simulate the gap and the next boot.
+ */
+
+#include <cstdint>
+#include "esp_err.h"
+
+#define SOC_GPIO_SUPPORT_DEEPSLEEP_WAKEUP   1
+
+typedef enum {
+    ESP_SLEEP_WAKEUP_UNDEFINED,
+    ESP_SLEEP_WAKEUP_ALL,
+    ESP_SLEEP_WAKEUP_EXT0,
+    ESP_SLEEP_WAKEUP_EXT1,
+    ESP_SLEEP_WAKEUP_TIMER,
+    ESP_SLEEP_WAKEUP_TOUCHPAD,
+    ESP_SLEEP_WAKEUP_ULP,
+    ESP_SLEEP_WAKEUP_GPIO,
+} esp_sleep_source_t;
+typedef esp_sleep_source_t esp_sleep_wakeup_cause_t;
+
+typedef enum {
+    ESP_GPIO_WAKEUP_GPIO_LOW = 0,
+    ESP_GPIO_WAKEUP_GPIO_HIGH = 1,
+} esp_deepsleep_gpio_wake_up_mode_t;
+
+esp_sleep_wakeup_cause_t esp_sleep_get_wakeup_cause();
+esp_err_t esp_sleep_enable_timer_wakeup(uint64_t timeUs);
+esp_err_t esp_sleep_enable_gpio_wakeup();
+esp_err_t esp_sleep_disable_wakeup_source(esp_sleep_source_t source);
+esp_err_t esp_deep_sleep_enable_gpio_wakeup(uint64_t gpioMask, esp_deepsleep_gpio_wake_up_mode_t mode);
+esp_err_t esp_light_sleep_start();
+[[noreturn]] void esp_deep_sleep_start();
@@ -0,0 +1,11 @@
+#pragma once
+
+/**
+ * @file esp_system.h
+ * @brief Host stand-in for ESP-IDF heap queries.
+ */
+
+#include <cstdint>
+
+uint32_t esp_get_free_heap_size();
+uint32_t esp_get_minimum_free_heap_size();
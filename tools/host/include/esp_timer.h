@@ -0,0 +1,10 @@
+#pragma once
+
+/**
+ * @file esp_timer.h
+ * @brief Host stand-in for the ESP-IDF microsecond timer (driven by the host clock).
+ */
+
+#include <cstdint>
+
+int64_t esp_timer_get_time();
@@ -0,0 +1,26 @@
+#pragma once
+
+/**
+ * @file FreeRTOS.h
+ * @brief Host stand-in for FreeRTOS types and critical sections (single-threaded host).
+ */
+
+#include <cstdint>
+
+typedef uint32_t TickType_t;
+typedef int BaseType_t;
+typedef unsigned int UBaseType_t;
+
+#define pdTRUE              1
+#define pdFALSE             0
+#define pdPASS              1
+#define portMAX_DELAY       0xffffffffu
+#define pdMS_TO_TICKS(x)    ((TickType_t)(x))
+#define portTICK_PERIOD_MS  1
+
+typedef struct { int unused; } portMUX_TYPE;
+#define portMUX_INITIALIZER_UNLOCKED    {0}
+#define portENTER_CRITICAL(m)           ((void)(m))
+#define portEXIT_CRITICAL(m)            ((void)(m))
+#define portENTER_CRITICAL_ISR(m)       ((void)(m))
+#define portEXIT_CRITICAL_ISR(m)        ((void)(m))
@@ -0,0 +1,16 @@
+#pragma once
+
+/**
+ * @file semphr.h
+ * @brief Host stand-in for FreeRTOS mutexes (no-ops on the single-threaded host).
+ */
+
+#include "FreeRTOS.h"
+
+typedef void* SemaphoreHandle_t;
+typedef struct { int unused; } StaticSemaphore_t;
+
+SemaphoreHandle_t xSemaphoreCreateMutex();
+SemaphoreHandle_t xSemaphoreCreateMutexStatic(StaticSemaphore_t* buffer);
+BaseType_t xSemaphoreTake(SemaphoreHandle_t m, TickType_t wait);
+BaseType_t xSemaphoreGive(SemaphoreHandle_t m);
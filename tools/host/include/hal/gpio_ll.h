@@ -0,0 +1,25 @@
+#pragma once
+
+/**
+ * @file gpio_ll.h
+ * @brief Host stand-in for the GPIO low-level register API (routed to the host pin model).
+ */
+
+#include <cstdint>
+
+typedef int gpio_num_t;
+
+typedef enum {
+    GPIO_INTR_DISABLE,
+    GPIO_INTR_POSEDGE,
+    GPIO_INTR_NEGEDGE,
+    GPIO_INTR_ANYEDGE,
+    GPIO_INTR_LOW_LEVEL,
+    GPIO_INTR_HIGH_LEVEL,
+} gpio_int_type_t;
+
+typedef struct { int unused; } gpio_dev_t;
+extern gpio_dev_t GPIO;
+
+void gpio_ll_set_intr_type(gpio_dev_t* hw, gpio_num_t gpio, gpio_int_type_t type);
+void gpio_ll_set_level(gpio_dev_t* hw, gpio_num_t gpio, uint32_t level);
@@ -0,0 +1,146 @@
+#pragma once
+
+/**
+ * @file host_sim.h
+ * @brief Controls for the host stand-ins: virtual clock, scripted pin edges, sleep and BLE client.
+ *
+ * The clock only moves when the firmware waits (delay, task notification, light sleep) or the
+ * driver advances it. Scripted edges are applied at their exact time as the clock passes them,
+ * through the level-interrupt model the firmware arms with attachInterrupt/gpio_ll_set_intr_type.
+ */
+
+#include <cstddef>
+#include <cstdint>
+#include <esp_sleep.h>
+
+// -----------------------------------------------------------------------------
+// Clock
+// -----------------------------------------------------------------------------
+
+/**
+ * @brief Advance the host clock, applying every scripted edge that falls due.
+ */
+void host_advance_ms(uint64_t ms);
+
+/**
+ * @brief Current host clock (ms since the simulated power-on).
+ */
+uint64_t host_now_ms();
+
+/**
+ * @brief Wall clock at the simulated power-on (what gettimeofday reports before any sync).
+ */
+void host_set_wall_base(uint32_t epochSec);
+
+/**
+ * @brief Run hook each time the firmware blocks (task wait or light sleep), before the clock moves.
+ */
+void host_set_idle_hook(void (*hook)());
+
+// -----------------------------------------------------------------------------
+// Pins
+// -----------------------------------------------------------------------------
+
+/**
+ * @brief Level change applied to an input when the host clock reaches atMs.
+ */
+struct HostEdge {
+    uint64_t atMs;
+    uint8_t pin;
+    uint8_t level;
+};
+
+/**
+ * @brief Source of scripted edges, in time order.
+ *
+ * pop() runs as the clock reaches the edge, so a script can also act there (client writes, a
+ * power cycle thrown as an exception); an edge on a pin out of range changes no level.
+ */
+class HostInput {
+public:
+    virtual ~HostInput() {}
+    /// @brief Next edge without consuming it; false when the script is exhausted.
+    virtual bool peek(HostEdge& edge) = 0;
+    /// @brief Consume the edge last returned by peek().
+    virtual void pop() = 0;
+};
+
+/**
+ * @brief Drive the inputs from a script (nullptr = inputs hold their level).
+ */
+void host_set_input(HostInput* input);
+
+/**
+ * @brief Drive a pin now (runs its ISR if the new level matches the armed one).
+ */
+void host_set_pin(uint8_t pin, int level);
+
+/**
+ * @brief Level last driven on a pin, input or output.
+ */
+int host_pin_level(uint8_t pin);
+
+/**
+ * @brief Detach every ISR, as a reset does; pin levels are kept.
+ */
+void host_detach_all();
+
+/**
+ * @brief Edges applied and ISR invocations since start.
+ */
+uint64_t host_edges_applied();
+uint64_t host_isr_calls();
+
+// -----------------------------------------------------------------------------
+// Sleep
+// -----------------------------------------------------------------------------
+
+/**
+ * @brief Thrown by esp_deep_sleep_start(); carries the wake sources that were armed.
+ */
+struct HostDeepSleep {
+    uint64_t timerUs;           ///< Timer wake (0 = none)
+    uint64_t gpioMask;          ///< Pins that wake on the level below
+    bool gpioHigh;              ///< Wake level of gpioMask
+};
+
+/**
+ * @brief Wake cause reported by esp_sleep_get_wakeup_cause() on the next boot.
+ */
+void host_set_wakeup_cause(esp_sleep_wakeup_cause_t cause);
+
+/**
+ * @brief Zero every RTC_DATA_ATTR variable, as a power-on does (they all start zeroed).
+ */
+void host_rtc_reset();
+
+// -----------------------------------------------------------------------------
+// BLE client
+// -----------------------------------------------------------------------------
+
+/**
+ * @brief True while the firmware has the BLE stack up and advertising or connected.
+ */
+bool host_ble_up();
+
+/**
+ * @brief Connect or disconnect the simulated client (server callbacks run inline).
+ * @return False if the stack is not up.
+ */
+bool host_ble_connect(bool connected);
+
+/**
+ * @brief Client write to a characteristic; its onWrite callback runs inline.
+ * @return False if the stack is not up or the characteristic does not exist.
+ */
+bool host_ble_write(const char* uuid, const uint8_t* data, size_t len);
+
+/**
+ * @brief Client write to the CCCD of a characteristic (0x01 notify, 0x02 indicate).
+ */
+bool host_ble_subscribe(const char* uuid, uint8_t cccd);
+
+/**
+ * @brief Notifications plus indications sent since start.
+ */
+uint64_t host_ble_pushes();
@@ -0,0 +1,29 @@
+#pragma once
+
+/**
+ * @file nvs.h
+ * @brief Host stand-in for the ESP-IDF NVS API, backed by the page model in nvs_sim.cpp.
+ */
+
+#include <cstdint>
+#include <cstddef>
+#include "esp_err.h"
+
+typedef uint32_t nvs_handle_t;
+typedef enum { NVS_READONLY, NVS_READWRITE } nvs_open_mode_t;
+typedef struct {
+    size_t used_entries;
+    size_t free_entries;
+    size_t total_entries;
+    size_t namespace_count;
+} nvs_stats_t;
+
+esp_err_t nvs_open(const char* name, nvs_open_mode_t mode, nvs_handle_t* out);
+void nvs_close(nvs_handle_t h);
+esp_err_t nvs_get_blob(nvs_handle_t h, const char* key, void* out, size_t* len);
+esp_err_t nvs_set_blob(nvs_handle_t h, const char* key, const void* data, size_t len);
+esp_err_t nvs_get_u32(nvs_handle_t h, const char* key, uint32_t* out);
+esp_err_t nvs_set_u32(nvs_handle_t h, const char* key, uint32_t value);
+esp_err_t nvs_erase_key(nvs_handle_t h, const char* key);
+esp_err_t nvs_commit(nvs_handle_t h);
+esp_err_t nvs_get_stats(const char* part, nvs_stats_t* out);
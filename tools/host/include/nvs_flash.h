@@ -0,0 +1,11 @@
+#pragma once
+
+/**
+ * @file nvs_flash.h
+ * @brief Host stand-in for NVS partition init/erase.
+ */
+
+#include "nvs.h"
+
+esp_err_t nvs_flash_init();
+esp_err_t nvs_flash_erase();
@@ -0,0 +1,43 @@
+#pragma once
+
+/**
+ * @file nvs_sim.h
+ * @brief Page-level model of the ESP-IDF NVS partition for host replays.
+ *
+ * Values live in a key map; alongside it the model tracks where each item's entries sit in
+ * 4 KiB pages of 126 entries, marks superseded entries erased, and garbage-collects the
+ * page with the most erased entries (relocating its live items) when only the reserve
+ * page is left free. Multi-entry chunks are not split across pages, and a write that finds
+ * no reclaimable page fails with ESP_ERR_NVS_NOT_ENOUGH_SPACE and drops the key.
+ *
+ * @author Vetra Firmware Team
+ * @copyright Copyright (c) 2025 Vetra
+ */
+
+#include <cstdint>
+#include <cstddef>
+
+/**
+ * @brief Physical write counters of the simulated partition.
+ */
+struct NvsSimStats {
+    uint64_t entriesRequested;  ///< Entries written on behalf of nvs_set_* calls
+    uint64_t entriesRelocated;  ///< Entries copied by garbage collection
+    uint64_t pageErases;        ///< Page erases performed
+    uint64_t failedWrites;      ///< Writes rejected because no page could be reclaimed
+    uint32_t maxPageErases;     ///< Highest erase count of any single page
+    uint32_t minPageErases;     ///< Lowest erase count of any single page
+    uint32_t pages;             ///< Pages in the partition
+    uint32_t liveEntries;       ///< Entries currently holding live items
+};
+
+/**
+ * @brief Reset the simulated partition to empty, erased flash.
+ * @param pages Number of 4 KiB pages (one is kept free for garbage collection).
+ */
+void nvs_sim_reset(uint32_t pages);
+
+/**
+ * @brief Current physical write counters.
+ */
+NvsSimStats nvs_sim_stats();
@@ -0,0 +1,206 @@
+/**
+ * @file nvs_sim.cpp
+ * @brief Host NVS stand-in with page, entry and erase accounting (see nvs_sim.h).
+ */
+
+#include "nvs_sim.h"
+#include <nvs.h>
+#include <nvs_flash.h>
+#include "AllocTracker.h"
+#include <algorithm>
+#include <cstring>
+#include <map>
+#include <string>
+#include <vector>
+
+// -----------------------------------------------------------------------------
+// Page Model
+// -----------------------------------------------------------------------------
+
+static constexpr uint32_t ENTRY_BYTES = 32;
+static constexpr uint32_t ENTRIES_PER_PAGE = 126;
+
+struct Span { uint32_t page; uint32_t entries; };
+
+struct Item {
+    std::vector<uint8_t> value;
+    std::vector<Span> spans;
+};
+
+struct Page {
+    uint32_t used = 0;     // entries written since the last erase
+    uint32_t live = 0;     // entries still holding current items
+    uint32_t erases = 0;
+    bool free = true;
+};
+
+static std::vector<Page> s_pages;
+static std::vector<uint32_t> s_freeList;
+static uint32_t s_active = 0;
+static std::map<std::string, Item> s_items;
+static NvsSimStats s_stats;
+
+static void releaseSpans(Item& it) {
+    for (const Span& sp : it.spans) s_pages[sp.page].live -= sp.entries;
+    it.spans.clear();
+}
+
+static bool takeFreePage() {
+    if (s_freeList.empty()) return false;
+    s_active = s_freeList.front();
+    s_freeList.erase(s_freeList.begin());
+    s_pages[s_active].free = false;
+    return true;
+}
+
+static bool place(Item& it, uint32_t entries, bool relocation);
+
+// Reclaim the full page with the most erased entries into the reserve page
+static bool collectGarbage() {
+    int victim = -1; uint32_t best = 0;
+    for (uint32_t i = 0; i < s_pages.size(); ++i) {
+        const Page& p = s_pages[i];
+        if (p.free || i == s_active) continue;
+        uint32_t erased = p.used - p.live;
+        if (erased > best) { best = erased; victim = (int)i; }
+    }
+    if (victim < 0 || !takeFreePage()) return false;
+    for (auto& kv : s_items) {
+        Item& it = kv.second;
+        std::vector<Span> keep;
+        std::vector<uint32_t> moved;
+        for (const Span& sp : it.spans) {
+            if (sp.page == (uint32_t)victim) moved.push_back(sp.entries); else keep.push_back(sp);
+        }
+        if (moved.empty()) continue;
+        it.spans = keep;
+        for (uint32_t n : moved) place(it, n, true);
+    }
+    Page& v = s_pages[victim];
+    v.used = 0; v.live = 0; v.free = true; v.erases++;
+    s_freeList.push_back((uint32_t)victim);
+    s_stats.pageErases++;
+    return true;
+}
+
+static bool place(Item& it, uint32_t entries, bool relocation) {
+    while (s_pages[s_active].used + entries > ENTRIES_PER_PAGE) {
+        // Keep one page in reserve for garbage collection, like the IDF page manager
+        if (s_freeList.size() > 1) { takeFreePage(); continue; }
+        if (!collectGarbage()) return false;
+    }
+    Page& p = s_pages[s_active];
+    p.used += entries;
+    p.live += entries;
+    it.spans.push_back(Span{s_active, entries});
+    if (relocation) s_stats.entriesRelocated += entries; else s_stats.entriesRequested += entries;
+    return true;
+}
+
+static esp_err_t writeItem(const char* key, const void* data, size_t len, bool blob) {
+    // The old entries are released before placing the new ones (IDF erases them after the write)
+    Item& it = s_items[key];
+    releaseSpans(it);
+    it.value.assign((const uint8_t*)data, (const uint8_t*)data + len);
+    bool ok = blob ? place(it, 1 + (uint32_t)((len + ENTRY_BYTES - 1) / ENTRY_BYTES), false) && place(it, 1, false)
+                   : place(it, 1, false);
+    if (!ok) {
+        releaseSpans(it);
+        s_items.erase(key);
+        s_stats.failedWrites++;
+        return ESP_ERR_NVS_NOT_ENOUGH_SPACE;
+    }
+    return ESP_OK;
+}
+
+void nvs_sim_reset(uint32_t pages) {
+    AllocTracker::Scope alloc(ALLOC_HOST);
+    s_pages.assign(std::max<uint32_t>(pages, 2), Page());
+    s_freeList.clear();
+    for (uint32_t i = 0; i < s_pages.size(); ++i) s_freeList.push_back(i);
+    s_items.clear();
+    memset(&s_stats, 0, sizeof(s_stats));
+    takeFreePage();
+}
+
+NvsSimStats nvs_sim_stats() {
+    AllocTracker::Scope alloc(ALLOC_HOST);
+    NvsSimStats out = s_stats;
+    out.pages = (uint32_t)s_pages.size();
+    out.maxPageErases = 0;
+    out.minPageErases = UINT32_MAX;
+    out.liveEntries = 0;
+    for (const Page& p : s_pages) {
+        out.maxPageErases = std::max(out.maxPageErases, p.erases);
+        out.minPageErases = std::min(out.minPageErases, p.erases);
+        out.liveEntries += p.live;
+    }
+    return out;
+}
+
+// -----------------------------------------------------------------------------
+// NVS API
+// -----------------------------------------------------------------------------
+
+// The model itself uses the heap; its allocations are booked to ALLOC_HOST so alloc_check
+// only sees the firmware's own.
+
+esp_err_t nvs_flash_init() {
+    if (s_pages.empty()) nvs_sim_reset(5);
+    return ESP_OK;
+}
+
+esp_err_t nvs_flash_erase() {
+    // Erasing before the first init still formats the default partition
+    nvs_sim_reset(s_pages.empty() ? 5 : (uint32_t)s_pages.size());
+    return ESP_OK;
+}
+
+esp_err_t nvs_open(const char*, nvs_open_mode_t, nvs_handle_t* out) { *out = 1; return ESP_OK; }
+void nvs_close(nvs_handle_t) {}
+esp_err_t nvs_commit(nvs_handle_t) { return ESP_OK; }
+
+esp_err_t nvs_get_blob(nvs_handle_t, const char* key, void* out, size_t* len) {
+    AllocTracker::Scope alloc(ALLOC_HOST);
+    auto it = s_items.find(key);
+    if (it == s_items.end()) return ESP_ERR_NVS_NOT_FOUND;
+    const std::vector<uint8_t>& v = it->second.value;
+    if (!out) { *len = v.size(); return ESP_OK; }
+    if (*len < v.size()) return ESP_ERR_NVS_INVALID_LENGTH;
+    memcpy(out, v.data(), v.size());
+    *len = v.size();
+    return ESP_OK;
+}
+
+esp_err_t nvs_set_blob(nvs_handle_t, const char* key, const void* data, size_t len) {
+    AllocTracker::Scope alloc(ALLOC_HOST);
+    return writeItem(key, data, len, true);
+}
+
+esp_err_t nvs_get_u32(nvs_handle_t h, const char* key, uint32_t* out) {
+    size_t len = sizeof(*out);
+    return nvs_get_blob(h, key, out, &len);
+}
+
+esp_err_t nvs_set_u32(nvs_handle_t, const char* key, uint32_t value) {
+    AllocTracker::Scope alloc(ALLOC_HOST);
+    return writeItem(key, &value, sizeof(value), false);
+}
+
+esp_err_t nvs_erase_key(nvs_handle_t, const char* key) {
+    AllocTracker::Scope alloc(ALLOC_HOST);
+    auto it = s_items.find(key);
+    if (it == s_items.end()) return ESP_ERR_NVS_NOT_FOUND;
+    releaseSpans(it->second);
+    s_items.erase(it);
+    return ESP_OK;
+}
+
+esp_err_t nvs_get_stats(const char*, nvs_stats_t* out) {
+    NvsSimStats st = nvs_sim_stats();
+    out->total_entries = (size_t)st.pages * ENTRIES_PER_PAGE;
+    out->used_entries = st.liveEntries;
+    out->free_entries = out->total_entries - out->used_entries;
+    out->namespace_count = 1;
+    return ESP_OK;
+}
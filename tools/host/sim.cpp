@@ -0,0 +1,666 @@
+/**
+ * @file sim.cpp
+ * @brief Deterministic simulation of the firmware (App, StateMachine, persistence, BLE) on a virtual clock.
+ *
+ * Runs the real App::setup()/App::loop() against the host stand-ins: the clock only moves when
+ * the firmware waits or sleeps, HEAT_PIN/BUTTON_PIN edges come from a script and reach the
+ * firmware through its level interrupts, deep sleep ends on the button, the phase timer or a
+ * scripted power cycle, and a simulated client connects and sets the time over BLE. The same
+ * script always produces the same run, so a timing bug found once replays on every run.
+ *
+ * Checked while running:
+ * - the coil is locked exactly in LOCKDOWN and a phase never records more than maxPuffs (the
+ *   last phase excepted once it has run its time: the program then lifts the lock);
+ * - the live state after every wake (RTC fast resume) and every power cycle (reconstruction
+ *   from storage) equals the state before it;
+ * - no App::loop() iteration allocates once warmed up (built with ALLOC_TRACKING=1);
+ * - at the end, stored puff numbers are contiguous, timestamps never decrease and durations
+ *   are valid, plus the puff, blocked-attempt and phase counts the scenario expects.
+ *
+ * Scripts are built-in scenarios (bounce, overlap, boundary, lockout, sleep, soak, phase0) or a
+ * trace file with one event per line, "<ms> <kind> [value]", '#' starting a comment:
+ *   heat 1|0, button 1|0   pin level
+ *   connect, disconnect    simulated BLE client
+ *   ntp <epoch>            client writes the NTP characteristic
+ *   reboot                 power cycle (RTC memory and wall clock lost)
+ *
+ * Every simulated reset rebuilds the state machine, persistence and rollups from scratch, as RAM
+ * is lost on the device; a power cycle also clears RTC memory and restarts the wall clock. Other
+ * singletons keep their RAM and the uptime clocks run on across resets, so reboots are meant for
+ * idle moments.
+ *
+ * Usage: sim [--scenario NAME|all] [--trace FILE] [--seed N] [--puffs N] [--verbose]
+ *
+ * @author Vetra Firmware Team
+ * @copyright Copyright (c) 2025 Vetra
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cstdarg>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+#include <sys/wait.h>
+#include <unistd.h>
+#include "App.h"
+#include "AllocTracker.h"
+#include "BLEManager.h"
+#include "Debounce.h"
+#include "LogBuffer.h"
+#include "PersistenceManager.h"
+#include "PhaseSchedule.h"
+#include "Rollups.h"
+#include "StateMachine.h"
+#include "Timebase.h"
+#include "host_sim.h"
+#include "nvs_sim.h"
+
+static const char* const MODULE_NAMES[ALLOC_MODULE_COUNT] = { "other", "app", "state", "persistence", "logger", "ble", "host" };
+
+static const uint32_t START_SEC = 1735689600;      // 2025-01-01T00:00:00Z, the epoch scenarios sync to
+static const uint8_t NO_PIN = 0xFF;                // scripted action: applied as an edge on no pin
+static const uint64_t SETTLE_MS = 2 * 3600 * 1000; // run time allowed past the script when the device never sleeps
+static const uint32_t WARMUP_LOOPS = 20;           // loop iterations before the allocation check starts
+static const uint64_t PHASE_MS = (uint64_t)PHASE_DURATION_SECONDS * 1000;
+static const uint32_t PULSE_MS = 25;               // heater sense line toggle period while firing
+
+/**
+ * @brief Thrown from the script at a scripted power cycle.
+ */
+struct HostPowerCycle {};
+
+// -----------------------------------------------------------------------------
+// Script
+// -----------------------------------------------------------------------------
+
+enum EventKind : uint8_t { EV_EDGE, EV_NTP, EV_CONNECT, EV_DISCONNECT, EV_REBOOT };
+
+struct Event {
+    uint64_t atMs;
+    EventKind kind;
+    uint8_t pin;
+    uint8_t level;
+    uint32_t value;
+};
+
+/**
+ * @brief Time-ordered pin edges and client actions, fed to the host clock as one input.
+ *
+ * Actions run when the clock reaches them, from inside whatever wait the firmware is in, as the
+ * BLE task would. Scenario builders add events in any order; finish() sorts them (stable, so
+ * same-time events keep their order).
+ */
+class Script : public HostInput {
+public:
+    std::vector<Event> events;
+    int32_t expectPuffs = -1;       ///< Stored puffs at the end (-1 = not checked)
+    int32_t expectBlocked = -1;     ///< Firings started while locked
+    int32_t expectPhase = -1;       ///< Phase index at the end
+    uint32_t blocked = 0;
+    uint32_t skipped = 0;           ///< Client actions that found no BLE stack up
+
+    void edge(uint64_t at, uint8_t pin, uint8_t level) { events.push_back(Event{at, EV_EDGE, pin, level, 0}); }
+    void action(uint64_t at, EventKind kind, uint32_t value = 0) { events.push_back(Event{at, kind, NO_PIN, 0, value}); }
+
+    // Button press long enough for a deep-sleep wake and the wake ISR
+    void press(uint64_t at) { edge(at, BUTTON_PIN, 1); edge(at + 150, BUTTON_PIN, 0); }
+
+    // Heater sense line while firing for firingMs: it toggles every pulseMs, and the firmware
+    // ends the puff DEBOUNCE_MS after the last edge (pulseMs 0 holds a steady level instead).
+    // Optional contact bounce (1 ms toggles) at both ends.
+    void puff(uint64_t at, uint32_t firingMs, uint8_t bounces = 0, uint32_t pulseMs = PULSE_MS) {
+        uint64_t t = at;
+        for (uint8_t i = 0; i < bounces; ++i, t += 2) { edge(t, HEAT_PIN, 1); edge(t + 1, HEAT_PIN, 0); }
+        edge(t, HEAT_PIN, 1);
+        uint64_t end = at + firingMs;
+        if (pulseMs) {
+            for (uint64_t p = t + pulseMs; p + pulseMs < end; p += 2 * pulseMs) { edge(p, HEAT_PIN, 0); edge(p + pulseMs, HEAT_PIN, 1); }
+        }
+        for (uint8_t i = 0; i < bounces; ++i, end += 2) { edge(end, HEAT_PIN, 0); edge(end + 1, HEAT_PIN, 1); }
+        edge(end, HEAT_PIN, 0);
+    }
+
+    // Client connects, sets the clock and leaves
+    void sync(uint64_t at, uint32_t epoch) {
+        action(at, EV_CONNECT);
+        action(at + 200, EV_NTP, epoch);
+        action(at + 700, EV_DISCONNECT);
+    }
+
+    void finish() {
+        std::stable_sort(events.begin(), events.end(), [](const Event& a, const Event& b) { return a.atMs < b.atMs; });
+        next = 0;
+    }
+
+    bool exhausted() const { return next >= events.size(); }
+    uint64_t endMs() const { return events.empty() ? 0 : events.back().atMs; }
+
+    bool peek(HostEdge& e) override {
+        if (next >= events.size()) return false;
+        const Event& ev = events[next];
+        e = HostEdge{ev.atMs, ev.kind == EV_EDGE ? ev.pin : NO_PIN, ev.level};
+        return true;
+    }
+
+    void pop() override {
+        const Event ev = events[next++];
+        switch (ev.kind) {
+            case EV_EDGE:
+                if (ev.pin != HEAT_PIN) break;
+                // A firing starts on the first edge after a window with none
+                if (ev.atMs >= lastHeatMs + DEBOUNCE_MS && StateMachine::instance().getCurrentState() == LOCKDOWN) blocked++;
+                lastHeatMs = ev.atMs;
+                break;
+            case EV_NTP: {
+                uint8_t le[4] = {(uint8_t)ev.value, (uint8_t)(ev.value >> 8), (uint8_t)(ev.value >> 16), (uint8_t)(ev.value >> 24)};
+                if (!host_ble_write(NTP_CHAR_UUID, le, sizeof(le))) skipped++;
+                break;
+            }
+            case EV_CONNECT: if (!host_ble_connect(true)) skipped++; break;
+            case EV_DISCONNECT: if (!host_ble_connect(false)) skipped++; break;
+            case EV_REBOOT: throw HostPowerCycle{};
+        }
+    }
+
+private:
+    size_t next = 0;
+    uint64_t lastHeatMs = 0;
+};
+
+// Deterministic xorshift32; the same seed gives the same soak script on every host
+struct Rng {
+    uint32_t s;
+    explicit Rng(uint32_t seed) : s(seed ? seed : 1) {}
+    uint32_t next() { s ^= s << 13; s ^= s >> 17; s ^= s << 5; return s; }
+    uint32_t range(uint32_t lo, uint32_t hi) { return lo + next() % (hi - lo + 1); }
+};
+
+// -----------------------------------------------------------------------------
+// Scenarios
+// -----------------------------------------------------------------------------
+
+// Every scenario but phase0 starts from a fresh device synced one second after power-on;
+// the sync moves it straight past phase 0 into phase 1, which then starts at ~START_SEC
+static const uint64_t SYNC_MS = 1000;
+static const uint64_t PHASE1_END_MS = SYNC_MS + 200 + PHASE_MS;
+
+// Contact bounce at both ends of every puff never adds or loses a puff
+static void buildBounce(Script& s, uint32_t, uint32_t) {
+    s.sync(SYNC_MS, START_SEC);
+    for (uint8_t i = 0; i < 12; ++i) s.puff(5000 + i * 20000ULL, 1500, (uint8_t)(1 + i % 5));
+    s.expectPuffs = 12;
+}
+
+// Edges inside the debounce window belong to the puff in progress; a gap that outlasts the
+// window plus one loop poll (WAKE_DELAY_MS) starts a new puff
+static void buildOverlap(Script& s, uint32_t, uint32_t) {
+    s.sync(SYNC_MS, START_SEC);
+    const uint32_t merged[] = {1, 50, 100, 150, 190, DEBOUNCE_MS - 1};
+    const uint32_t split[] = {DEBOUNCE_MS + WAKE_DELAY_MS + 1, 1000};
+    uint64_t t = 5000;
+    for (uint32_t gap : merged) { s.puff(t, 1200); s.puff(t + 1200 + gap, 1200); t += 20000; }
+    // Any pulse period inside the window is one puff, from 1 ms up to just under DEBOUNCE_MS
+    for (uint32_t pulse = 1; pulse < DEBOUNCE_MS; pulse += 60) { s.puff(t, 1500, 0, pulse); t += 20000; }
+    for (uint32_t gap : split) { s.puff(t, 1200); s.puff(t + 1200 + gap, 1200); t += 20000; }
+    s.expectPuffs = 6 + 4 + 4;
+}
+
+// Durations either side of the shortest valid puff, and a puff straddling a phase boundary
+static void buildBoundary(Script& s, uint32_t, uint32_t) {
+    s.sync(SYNC_MS, START_SEC);
+    // The fall is applied at the first loop poll DEBOUNCE_MS after the last edge, so the
+    // measured duration is the held time plus the window, rounded up to the poll period
+    const uint32_t minHeld = MIN_PUFF_DURATION_MILLISECONDS - DEBOUNCE_MS;
+    s.puff(5000, 1);
+    s.puff(25000, minHeld - WAKE_DELAY_MS - 1);
+    s.puff(45000, minHeld);
+    s.puff(65000, 5000);
+    // A level held without pulses ends after one window: too short to count
+    s.puff(85000, 3000, 0, 0);
+    // Wake just before the boundary (the device is in deep sleep by then) and puff across it
+    s.press(PHASE1_END_MS - 3000);
+    s.puff(PHASE1_END_MS - 500, 2000);
+    s.press(PHASE1_END_MS + 60000);
+    s.puff(PHASE1_END_MS + 61000, 1500);
+    s.expectPuffs = 4;
+    s.expectPhase = 2;
+}
+
+// MAX_PUFFS puffs lock the coil for the rest of the phase; the next phase unlocks it
+static void buildLockout(Script& s, uint32_t, uint32_t) {
+    s.sync(SYNC_MS, START_SEC);
+    uint64_t t = 5000;
+    for (uint32_t i = 0; i < MAX_PUFFS + 3; ++i, t += 5000) s.puff(t, 1500);
+    s.press(PHASE1_END_MS + 30000);
+    s.puff(PHASE1_END_MS + 31000, 1500);
+    s.puff(PHASE1_END_MS + 36000, 1500);
+    s.expectPuffs = MAX_PUFFS + 2;
+    s.expectBlocked = 3;
+    s.expectPhase = 2;
+}
+
+// Deep sleep between sessions: button wakes, timer wakes at phase boundaries, a power cycle
+static void buildSleep(Script& s, uint32_t, uint32_t) {
+    s.sync(SYNC_MS, START_SEC);
+    s.puff(5000, 1500);
+    // Asleep after the advertising timeout; a button wake ten minutes later
+    s.press(10 * 60000);
+    s.puff(10 * 60000 + 800, 2000, 2);
+    // Heat edges alone do not wake deep sleep; the button does
+    s.puff(20 * 60000, 1500);
+    s.press(25 * 60000);
+    s.puff(25 * 60000 + 500, 1500);
+    // Across three phase boundaries (timer wakes), then a power cycle while asleep
+    uint64_t later = PHASE1_END_MS + 2 * PHASE_MS + 120000;
+    s.action(later, EV_REBOOT);
+    s.sync(later + 5000, START_SEC + (uint32_t)(later / 1000));
+    s.puff(later + 10000, 1500);
+    s.expectPuffs = 4;
+}
+
+// Random sessions: bounce, pulse periods across the window, short puffs, overlaps, syncs and
+// idle power cycles
+static void buildSoak(Script& s, uint32_t seed, uint32_t puffs) {
+    Rng rng(seed);
+    s.sync(SYNC_MS, START_SEC);
+    uint64_t t = 5000;
+    for (uint32_t i = 0; i < puffs; ++i) {
+        // ~30 puffs an hour, past the phase allowance, with the odd long break
+        uint32_t gap = rng.range(0, 39) != 0 ? rng.range(3000, 40000) : rng.range(600000, 2 * 3600 * 1000);
+        t += gap;
+        if (gap > 2000) s.press(t - 1000);
+        uint32_t held = rng.range(0, 9) == 0 ? rng.range(100, 900) : rng.range(800, 4000);
+        s.puff(t, held, (uint8_t)rng.range(0, 4), rng.range(0, 4) == 0 ? rng.range(1, DEBOUNCE_MS - 1) : PULSE_MS);
+        t += held + 10;
+        if (rng.range(0, 9) == 0) { s.puff(t + rng.range(1, DEBOUNCE_MS - 1), rng.range(300, 2000)); t += 2500; }
+        if (rng.range(0, 24) == 0) { s.press(t + 3000); s.sync(t + 3500, START_SEC + (uint32_t)((t + 3500) / 1000)); t += 5000; }
+        if (rng.range(0, 39) == 0) { t += 5000; s.action(t, EV_REBOOT); }
+    }
+}
+
+// ISSUES.md: fresh start, puffs before any sync, a power cycle in phase 0, then the first sync
+// and another power cycle. Phase 0 must keep its start across the first reboot and hand over
+// to phase 1 at the sync, which must survive the second.
+static void buildPhase0(Script& s, uint32_t, uint32_t) {
+    for (uint8_t i = 0; i < 3; ++i) s.puff(5000 + i * 5000ULL, 1500);
+    s.action(40000, EV_REBOOT);
+    s.puff(45000, 1500);
+    s.sync(60000, START_SEC);
+    s.puff(65000, 1500);
+    s.action(90000, EV_REBOOT);
+    s.puff(95000, 1500);
+    s.expectPuffs = 6;
+    s.expectPhase = 1;
+}
+
+struct Scenario {
+    const char* name;
+    void (*build)(Script&, uint32_t seed, uint32_t puffs);
+};
+
+static const Scenario SCENARIOS[] = {
+    {"bounce", buildBounce},
+    {"overlap", buildOverlap},
+    {"boundary", buildBoundary},
+    {"lockout", buildLockout},
+    {"sleep", buildSleep},
+    {"soak", buildSoak},
+    {"phase0", buildPhase0},
+};
+
+static bool loadTrace(const char* path, Script& s) {
+    FILE* f = fopen(path, "r");
+    if (!f) { fprintf(stderr, "cannot open %s\n", path); return false; }
+    char line[128];
+    unsigned lineNo = 0;
+    bool ok = true;
+    while (ok && fgets(line, sizeof(line), f)) {
+        lineNo++;
+        char* hash = strchr(line, '#');
+        if (hash) *hash = '\0';
+        unsigned long long at;
+        char kind[16];
+        unsigned long value = 0;
+        int n = sscanf(line, "%llu %15s %lu", &at, kind, &value);
+        if (n <= 0) continue;
+        if (n >= 2 && !strcmp(kind, "heat") && n == 3) s.edge(at, HEAT_PIN, value ? 1 : 0);
+        else if (n >= 2 && !strcmp(kind, "button") && n == 3) s.edge(at, BUTTON_PIN, value ? 1 : 0);
+        else if (n == 3 && !strcmp(kind, "ntp")) s.action(at, EV_NTP, (uint32_t)value);
+        else if (n == 2 && !strcmp(kind, "connect")) s.action(at, EV_CONNECT);
+        else if (n == 2 && !strcmp(kind, "disconnect")) s.action(at, EV_DISCONNECT);
+        else if (n == 2 && !strcmp(kind, "reboot")) s.action(at, EV_REBOOT);
+        else { fprintf(stderr, "%s:%u: cannot parse event\n", path, lineNo); ok = false; }
+    }
+    fclose(f);
+    return ok;
+}
+
+// -----------------------------------------------------------------------------
+// Simulation
+// -----------------------------------------------------------------------------
+
+static App s_app;
+static bool s_verbose = false;
+
+// Runs whenever the firmware blocks, so each line is stamped with the time it was logged
+static void drainLogs() {
+    char line[LogBuffer::lineCapacity()];
+    while (LogBuffer::instance().pop(line, sizeof(line)) > 0) {
+        if (s_verbose) printf("[%10.3f] %s\n", host_now_ms() / 1000.0, line);
+    }
+}
+
+struct Snapshot {
+    int phaseIndex;
+    uint32_t phaseStartSec;
+    int maxPuffs;
+    int puffsTaken;
+    int puffNumber;
+    uint32_t puffSec;
+    unsigned long puffMs;
+    int state;
+    uint32_t atSec;             // wall clock when captured (not compared)
+};
+
+// The lock lifts for good once the last phase of the program has run its time
+static bool programOver(const Snapshot& s) {
+    const PhaseSchedule& program = PhaseSchedule::program();
+    return !program.hasPhase(s.phaseIndex + 1) && s.atSec >= s.phaseStartSec
+           && s.atSec - s.phaseStartSec >= program.phaseAt(s.phaseIndex).phaseDuration;
+}
+
+static Snapshot capture() {
+    StateMachine& sm = StateMachine::instance();
+    PhaseModel ph = sm.currentPhase();
+    PuffModel pf = sm.currentPuff();
+    return Snapshot{ph.phaseIndex, ph.phaseStartSec, ph.maxPuffs, ph.puffsTaken, pf.puffNumber, pf.timestampSec, pf.puffDuration, (int)sm.getCurrentState(),
+                    Timebase::instance().epochSec()};
+}
+
+class Simulation {
+public:
+    explicit Simulation(Script& s) : script(s) {}
+
+    bool run();
+
+private:
+    Script& script;
+    bool failed = false;
+    bool hasPending = false;         // a reset happened; compare the booted state with this one
+    const char* pendingWhat = "";
+    Snapshot pending{};
+    uint32_t loops = 0;
+    uint32_t loopsThisBoot = 0;
+    uint32_t boots = 0;
+    uint32_t deepSleeps = 0;
+    uint32_t timerWakes = 0;
+    uint32_t buttonWakes = 0;
+    uint32_t powerCycles = 0;
+
+    void fail(const char* fmt, ...) __attribute__((format(printf, 2, 3)));
+    void compare(const char* what, const Snapshot& before, const Snapshot& after);
+    void boot(esp_sleep_wakeup_cause_t cause);
+    void powerCycle();
+    bool sleepThrough(const HostDeepSleep& sleep, esp_sleep_wakeup_cause_t& cause);
+    void checkLive();
+    void checkAllocs();
+    void checkEnd();
+};
+
+void Simulation::fail(const char* fmt, ...) {
+    drainLogs();
+    char msg[256];
+    va_list ap;
+    va_start(ap, fmt);
+    vsnprintf(msg, sizeof(msg), fmt, ap);
+    va_end(ap);
+    fprintf(stderr, "FAIL [%llu ms]: %s\n", (unsigned long long)host_now_ms(), msg);
+    failed = true;
+}
+
+void Simulation::compare(const char* what, const Snapshot& b, const Snapshot& a) {
+    // Past the program, storage says "over the limit" and the first loop lifts the lock again
+    if (b.phaseIndex == a.phaseIndex && b.phaseStartSec == a.phaseStartSec && b.maxPuffs == a.maxPuffs && b.puffsTaken == a.puffsTaken
+        && b.puffNumber == a.puffNumber && b.puffSec == a.puffSec && b.puffMs == a.puffMs
+        && (b.state == a.state || programOver(b))) return;
+    fail("state changed across %s: phase %d start %u max %d taken %d, puff %d at %u (%lu ms), state %d"
+         " -> phase %d start %u max %d taken %d, puff %d at %u (%lu ms), state %d", what,
+         b.phaseIndex, (unsigned)b.phaseStartSec, b.maxPuffs, b.puffsTaken, b.puffNumber, (unsigned)b.puffSec, b.puffMs, b.state,
+         a.phaseIndex, (unsigned)a.phaseStartSec, a.maxPuffs, a.puffsTaken, a.puffNumber, (unsigned)a.puffSec, a.puffMs, a.state);
+}
+
+void Simulation::boot(esp_sleep_wakeup_cause_t cause) {
+    boots++;
+    loopsThisBoot = 0;
+    host_set_wakeup_cause(cause);
+    // Power-on: RTC memory is lost with the wall clock, which starts again from 0
+    if (cause == ESP_SLEEP_WAKEUP_UNDEFINED) {
+        host_rtc_reset();
+        Timebase::instance().setEpoch(0);
+    }
+    // Any reset loses RAM: persistence reloads from NVS, rollups from the snapshot or storage
+    if (boots > 1) {
+        PersistenceManager::hostReset();
+        Rollups::instance().reset();
+    }
+    // What the StateMachine constructor does on the device, before setup() first reaches it
+    // (the first reference constructs it, which boots)
+    if (boots == 1) StateMachine::instance();
+    else StateMachine::instance().boot();
+    if (hasPending) {
+        hasPending = false;
+        compare(pendingWhat, pending, capture());
+    }
+    s_app.setup();
+    drainLogs();
+}
+
+void Simulation::powerCycle() {
+    powerCycles++;
+    pending = capture();
+    pendingWhat = "power cycle (reconstructFromStorage)";
+    hasPending = true;
+    if (BLEManager::instance().isActive()) BLEManager::instance().cleanupService();
+    host_detach_all();
+    drainLogs();
+}
+
+// Hold the device in deep sleep until a wake source fires; false if nothing ever wakes it
+bool Simulation::sleepThrough(const HostDeepSleep& sleep, esp_sleep_wakeup_cause_t& cause) {
+    deepSleeps++;
+    pending = capture();
+    pendingWhat = "deep sleep (RTC resume)";
+    hasPending = true;
+    if (script.exhausted()) return false;
+    uint64_t deadline = sleep.timerUs ? host_now_ms() + (sleep.timerUs + 999) / 1000 : UINT64_MAX;
+    try {
+        for (;;) {
+            bool gpioWake = false;
+            for (uint8_t pin = 0; pin < 64; ++pin) {
+                if ((sleep.gpioMask >> pin) & 1ULL) gpioWake |= (host_pin_level(pin) != 0) == sleep.gpioHigh;
+            }
+            if (gpioWake) { cause = ESP_SLEEP_WAKEUP_GPIO; buttonWakes++; return true; }
+            HostEdge e;
+            uint64_t nextAt = script.peek(e) ? e.atMs : UINT64_MAX;
+            if (deadline <= nextAt) {
+                if (deadline == UINT64_MAX) return false;
+                host_advance_ms(deadline - host_now_ms());
+                cause = ESP_SLEEP_WAKEUP_TIMER;
+                timerWakes++;
+                return true;
+            }
+            host_advance_ms(nextAt - host_now_ms());
+        }
+    } catch (const HostPowerCycle&) {
+        powerCycle();
+        cause = ESP_SLEEP_WAKEUP_UNDEFINED;
+        return true;
+    }
+}
+
+void Simulation::checkLive() {
+    Snapshot s = capture();
+    if (s.puffsTaken > s.maxPuffs && !programOver(s)) fail("phase %d has %d puffs, max %d", s.phaseIndex, s.puffsTaken, s.maxPuffs);
+    bool locked = host_pin_level(COIL_CTRL_PIN) != 0;
+    if (locked != (s.state == LOCKDOWN)) fail("coil %s in state %d", locked ? "locked" : "unlocked", s.state);
+    uint32_t stored = PersistenceManager::instance().getCursor(PUFF_CH).totalRecords;
+    if (stored != (uint32_t)s.puffNumber) fail("last puff %d but %u puffs stored", s.puffNumber, (unsigned)stored);
+}
+
+void Simulation::checkAllocs() {
+    AllocTracker& tracker = AllocTracker::instance();
+    if (loopsThisBoot <= WARMUP_LOOPS || tracker.totalAllocs() == 0) return;
+    char modules[128] = "";
+    size_t len = 0;
+    for (uint8_t m = 0; m < ALLOC_MODULE_COUNT; ++m) {
+        AllocTracker::Stats st = tracker.stats((AllocModule)m);
+        if (m != ALLOC_HOST && st.allocs && len < sizeof(modules)) {
+            len += (size_t)snprintf(modules + len, sizeof(modules) - len, " %s=%u", MODULE_NAMES[m], (unsigned)st.allocs);
+        }
+    }
+    fail("loop iteration %u allocated:%s", (unsigned)loops, modules);
+}
+
+void Simulation::checkEnd() {
+    // The final state must also survive a power cycle
+    powerCycle();
+    host_set_input(nullptr);
+    boot(ESP_SLEEP_WAKEUP_UNDEFINED);
+
+    PersistenceManager& pm = PersistenceManager::instance();
+    uint32_t prevNumber = 0, prevSec = 0, count = 0;
+    bool ok = true;
+    pm.forEachPuff([&](const PersistenceManager::PuffRecord& r) {
+        count++;
+        if ((prevNumber && r.puffNumber != prevNumber + 1) || r.tSec < prevSec || r.durationMs < MIN_PUFF_DURATION_MILLISECONDS) {
+            fail("stored puff %u (at %u, %u ms) follows puff %u at %u", (unsigned)r.puffNumber, (unsigned)r.tSec,
+                 (unsigned)r.durationMs, (unsigned)prevNumber, (unsigned)prevSec);
+            ok = false;
+            return false;
+        }
+        prevNumber = r.puffNumber;
+        prevSec = r.tSec;
+        return true;
+    });
+    Snapshot s = capture();
+    if (ok && script.expectPuffs >= 0 && (int32_t)pm.getCursor(PUFF_CH).totalRecords != script.expectPuffs) {
+        fail("%u puffs stored, expected %d", (unsigned)pm.getCursor(PUFF_CH).totalRecords, (int)script.expectPuffs);
+    }
+    if (script.expectBlocked >= 0 && (int32_t)script.blocked != script.expectBlocked) {
+        fail("%u puffs blocked, expected %d", (unsigned)script.blocked, (int)script.expectBlocked);
+    }
+    if (script.expectPhase >= 0 && s.phaseIndex != script.expectPhase) fail("in phase %d, expected %d", s.phaseIndex, (int)script.expectPhase);
+}
+
+bool Simulation::run() {
+    nvs_sim_reset(NVS_PARTITION_PAGES);
+    host_set_wall_base(0);
+    host_set_input(&script);
+    host_set_idle_hook(drainLogs);
+    esp_sleep_wakeup_cause_t cause = ESP_SLEEP_WAKEUP_UNDEFINED;
+    bool awake = false;
+    auto started = std::chrono::steady_clock::now();
+
+    while (!failed) {
+        try {
+            if (!awake) {
+                boot(cause);
+                awake = true;
+            }
+            if (script.exhausted() && host_now_ms() > script.endMs() + SETTLE_MS) break;
+            AllocTracker::instance().reset();
+            s_app.loop();
+            loops++;
+            loopsThisBoot++;
+            checkAllocs();
+            checkLive();
+            drainLogs();
+        } catch (const HostDeepSleep& sleep) {
+            awake = false;
+            drainLogs();
+            if (!sleepThrough(sleep, cause)) break;
+        } catch (const HostPowerCycle&) {
+            awake = false;
+            powerCycle();
+            cause = ESP_SLEEP_WAKEUP_UNDEFINED;
+        }
+    }
+    if (!failed) checkEnd();
+
+    double hostSec = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+    uint64_t events = host_edges_applied() + loops;
+    PhaseModel ph = StateMachine::instance().currentPhase();
+    printf("%s %u puffs stored, %u blocked, phase %d (%d/%d); %u boots: %u button, %u timer wakes, %u power cycles, %u deep sleeps\n",
+           failed ? "FAIL:" : "OK:", (unsigned)PersistenceManager::instance().getCursor(PUFF_CH).totalRecords, (unsigned)script.blocked,
+           ph.phaseIndex, ph.puffsTaken, ph.maxPuffs, (unsigned)boots, (unsigned)buttonWakes, (unsigned)timerWakes,
+           (unsigned)powerCycles, (unsigned)deepSleeps);
+    printf("    %llu edges and actions (%u skipped), %u ISR calls, %u loop iterations over %.1f s simulated in %.1f ms: %.0f events/s\n",
+           (unsigned long long)host_edges_applied(), (unsigned)script.skipped, (unsigned)host_isr_calls(), (unsigned)loops,
+           host_now_ms() / 1000.0, hostSec * 1000.0, hostSec > 0 ? events / hostSec : 0.0);
+    return !failed;
+}
+
+// -----------------------------------------------------------------------------
+// Entry Point
+// -----------------------------------------------------------------------------
+
+// Each scenario runs in its own process so every singleton and RTC variable starts fresh
+static bool runIsolated(const Scenario& sc, uint32_t seed, uint32_t puffs) {
+    printf("[%s] ", sc.name);
+    fflush(stdout);
+    pid_t pid = fork();
+    if (pid == 0) {
+        Script script;
+        sc.build(script, seed, puffs);
+        script.finish();
+        bool ok = Simulation(script).run();
+        fflush(stdout);
+        _exit(ok ? 0 : 1);
+    }
+    int status = 0;
+    if (pid < 0 || waitpid(pid, &status, 0) < 0) return false;
+    return WIFEXITED(status) && WEXITSTATUS(status) == 0;
+}
+
+int main(int argc, char** argv) {
+    const char* scenario = "all";
+    const char* trace = nullptr;
+    uint32_t seed = 1;
+    uint32_t puffs = 500;
+    for (int i = 1; i < argc; ++i) {
+        if (!strcmp(argv[i], "--scenario") && i + 1 < argc) scenario = argv[++i];
+        else if (!strcmp(argv[i], "--trace") && i + 1 < argc) trace = argv[++i];
+        else if (!strcmp(argv[i], "--seed") && i + 1 < argc) seed = (uint32_t)strtoul(argv[++i], nullptr, 10);
+        else if (!strcmp(argv[i], "--puffs") && i + 1 < argc) puffs = (uint32_t)strtoul(argv[++i], nullptr, 10);
+        else if (!strcmp(argv[i], "--verbose")) s_verbose = true;
+        else {
+            fprintf(stderr, "usage: %s [--scenario NAME|all] [--trace FILE] [--seed N] [--puffs N] [--verbose]\n", argv[0]);
+            return 2;
+        }
+    }
+    if (!AllocTracker::enabled()) {
+        fprintf(stderr, "sim must be built with -DALLOC_TRACKING=1 (use sim.sh)\n");
+        return 2;
+    }
+
+    if (trace) {
+        Script script;
+        if (!loadTrace(trace, script)) return 2;
+        script.finish();
+        printf("[%s] ", trace);
+        return Simulation(script).run() ? 0 : 1;
+    }
+    bool found = false, ok = true;
+    for (const Scenario& sc : SCENARIOS) {
+        if (strcmp(scenario, "all") != 0 && strcmp(scenario, sc.name) != 0) continue;
+        found = true;
+        ok &= runIsolated(sc, seed, puffs);
+    }
+    if (!found) {
+        fprintf(stderr, "unknown scenario %s\n", scenario);
+        return 2;
+    }
+    return ok ? 0 : 1;
+}
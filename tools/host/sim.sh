@@ -0,0 +1,14 @@
+#!/usr/bin/env bash
+# Build and run the deterministic firmware simulation on the host (virtual clock, scripted pins).
+# Usage: tools/host/sim.sh [--scenario NAME|all] [--trace FILE] [--seed N] [--puffs N] [--verbose]
+#        (extra compiler flags via CXXFLAGS, e.g. CXXFLAGS=-DPHASE_DURATION_SECONDS=180)
+set -euo pipefail
+root="$(cd "$(dirname "$0")/../.." && pwd)"
+out="${OUT:-/tmp/vetra_sim}"
+"${CXX:-g++}" -std=c++17 -O2 -DLOG_LEVEL=2 -DALLOC_TRACKING=1 -DHOST_SIM ${CXXFLAGS:-} \
+    -I"$root/tools/host/include" -I"$root/lib/Logger" -I"$root/lib/StateMachine" -I"$root/lib/Utils" -I"$root/lib/BLE" -I"$root/src" \
+    "$root/tools/host/sim.cpp" "$root/tools/host/nvs_sim.cpp" "$root/tools/host/host_stubs.cpp" "$root/tools/host/ble_host.cpp" \
+    "$root/src/App.cpp" "$root/src/Device.cpp" "$root"/lib/StateMachine/*.cpp "$root"/lib/BLE/*.cpp "$root"/lib/Utils/*.cpp "$root"/lib/Logger/*.cpp \
+    -Wl,--wrap=malloc -Wl,--wrap=free -Wl,--wrap=calloc -Wl,--wrap=realloc -Wl,--wrap=gettimeofday -Wl,--wrap=settimeofday \
+    -o "$out"
+exec "$out" "$@"
@@ -0,0 +1,144 @@
+/**
+ * @file wear_replay.cpp
+ * @brief Replays a synthetic period of usage through PersistenceManager against the host NVS model.
+ *
+ * Mirrors the write pattern of the firmware: each puff appends a puff record, folds into the
+ * phase/day rollups and rewrites the phase's puffsTaken, a checkpoint follows every CHECKPOINT_INTERVAL puffs and every phase
+ * start, and each deep sleep records the epoch and compacts acknowledged history. With
+ * --syncs-per-day, a client acknowledges every stored puff at that rate. Prints the firmware's own wear estimate next to
+ * the page-level figures of the model so storage layouts can be compared before shipping.
+ * The replay stops early (exit code 1) if the partition runs out of reclaimable pages.
+ *
+ * Usage: wear_replay [--days N] [--puffs-per-day N] [--phase-hours N] [--sleeps-per-day N] [--syncs-per-day N] [--pages N]
+ *
+ * @author Vetra Firmware Team
+ * @copyright Copyright (c) 2025 Vetra
+ */
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include "PersistenceManager.h"
+#include "Rollups.h"
+#include "nvs_sim.h"
+
+void host_advance_ms(uint64_t ms);
+
+struct ReplayConfig {
+    uint32_t days = 365;
+    uint32_t puffsPerDay = 150;
+    uint32_t phaseHours = 24;
+    uint32_t sleepsPerDay = 40;
+    uint32_t syncsPerDay = 0;
+    uint32_t pages = NVS_PARTITION_PAGES;
+};
+
+static bool parseArgs(int argc, char** argv, ReplayConfig& cfg) {
+    for (int i = 1; i + 1 < argc; i += 2) {
+        uint32_t v = (uint32_t)strtoul(argv[i + 1], nullptr, 10);
+        if (!strcmp(argv[i], "--days")) cfg.days = v;
+        else if (!strcmp(argv[i], "--puffs-per-day")) cfg.puffsPerDay = v;
+        else if (!strcmp(argv[i], "--phase-hours")) cfg.phaseHours = v;
+        else if (!strcmp(argv[i], "--sleeps-per-day")) cfg.sleepsPerDay = v;
+        else if (!strcmp(argv[i], "--syncs-per-day")) cfg.syncsPerDay = v;
+        else if (!strcmp(argv[i], "--pages")) cfg.pages = v;
+        else return false;
+    }
+    if (argc % 2 == 0) return false;
+    return cfg.puffsPerDay > 0 && cfg.phaseHours > 0 && cfg.pages >= 2;
+}
+
+static void saveCheckpoint(PersistenceManager& pm, const PhaseModel& phase) {
+    PersistenceManager::CheckpointRecord cp{};
+    cp.phaseIndex = (uint16_t)phase.phaseIndex;
+    cp.puffRecordsCovered = pm.getCursor(PUFF_CH).totalRecords;
+    cp.phaseRecordsCovered = pm.getCursor(PHASE_CH).totalRecords;
+    cp.rollupRecordsCovered = pm.getCursor(ROLLUP_CH).totalRecords;
+    pm.saveCheckpoint(cp);
+}
+
+int main(int argc, char** argv) {
+    ReplayConfig cfg;
+    if (!parseArgs(argc, argv, cfg)) {
+        fprintf(stderr, "usage: %s [--days N] [--puffs-per-day N] [--phase-hours N] [--sleeps-per-day N] [--syncs-per-day N] [--pages N]\n", argv[0]);
+        return 2;
+    }
+
+    nvs_sim_reset(cfg.pages);
+    PersistenceManager& pm = PersistenceManager::instance();
+    pm.init();
+    pm.resetWearStats();
+
+    const uint32_t start = 1735689600; // 2025-01-01T00:00:00Z
+    const uint32_t phaseSec = cfg.phaseHours * 3600;
+    const uint32_t puffGap = 86400 / cfg.puffsPerDay;
+    const uint32_t sleepGap = cfg.sleepsPerDay ? 86400 / cfg.sleepsPerDay : UINT32_MAX;
+    const uint32_t syncGap = cfg.syncsPerDay ? 86400 / cfg.syncsPerDay : UINT32_MAX;
+
+    PhaseModel phase{0, phaseSec, start, MAX_PUFFS, 0};
+    pm.appendPhaseStart(phase);
+    uint32_t puffNumber = 0;
+    uint32_t nextSleep = start + sleepGap;
+    uint32_t nextSync = start + syncGap;
+    uint32_t compacted = 0;
+    uint32_t fullOnDay = 0;
+
+    for (uint32_t t = start; t < start + cfg.days * 86400; t += puffGap) {
+        while (t >= phase.phaseStartSec + phaseSec) {
+            phase.phaseIndex++;
+            phase.phaseStartSec += phaseSec;
+            phase.puffsTaken = 0;
+            pm.appendPhaseStart(phase);
+            saveCheckpoint(pm, phase);
+        }
+        while (t >= nextSync) {
+            pm.acknowledgePuffs(puffNumber);
+            nextSync += syncGap;
+        }
+        while (t >= nextSleep) {
+            pm.recordEpoch(nextSleep);
+            compacted += pm.compact();
+            nextSleep += sleepGap;
+        }
+        PuffModel puff{(int)(++puffNumber), t, 1500, phase.phaseIndex};
+        pm.appendPuff(puff);
+        Rollups::instance().onPuff(t, 1500, (uint16_t)phase.phaseIndex);
+        phase.puffsTaken++;
+        pm.updateCurrentPhasePuffsTaken((uint16_t)phase.phaseIndex, (uint16_t)phase.puffsTaken);
+        if (puffNumber % CHECKPOINT_INTERVAL == 0) saveCheckpoint(pm, phase);
+        host_advance_ms(puffGap * 1000ULL);
+        if (nvs_sim_stats().failedWrites) { fullOnDay = (t - start) / 86400 + 1; break; }
+    }
+
+    PersistenceManager::WearStats w = pm.getWearStats();
+    NvsSimStats sim = nvs_sim_stats();
+    uint64_t physical = sim.entriesRequested + sim.entriesRelocated;
+    double spanDays = fullOnDay ? (double)fullOnDay : (cfg.days ? (double)cfg.days : 1.0);
+
+    printf("Replay: %u days, %u puffs/day, phase every %u h, %u sleeps/day, %u syncs/day, %u pages\n",
+           cfg.days, cfg.puffsPerDay, cfg.phaseHours, cfg.sleepsPerDay, cfg.syncsPerDay, sim.pages);
+    printf("\nFirmware estimate (PersistenceManager::getWearStats)\n");
+    printf("  puffs                 %10u\n", w.puffs);
+    printf("  logical bytes         %10u\n", w.logicalBytes);
+    printf("  nvs bytes             %10u  (WA %.2fx)\n", w.nvsBytes, w.logicalBytes ? (double)w.nvsBytes / w.logicalBytes : 0.0);
+    printf("  entries written       %10u  (%.2f / puff)\n", w.entriesWritten, w.puffs ? (double)w.entriesWritten / w.puffs : 0.0);
+    printf("  page erases (est.)    %10u\n", w.pageErasesEst);
+    printf("  projected lifetime    %10u days\n", pm.projectLifetimeDays());
+    printf("  puff blocks compacted %10u\n", compacted);
+    printf("\nNVS model (nvs_sim)\n");
+    printf("  entries requested     %10llu\n", (unsigned long long)sim.entriesRequested);
+    printf("  entries relocated     %10llu  (GC)\n", (unsigned long long)sim.entriesRelocated);
+    printf("  page erases           %10llu  (per page min %u / max %u)\n",
+           (unsigned long long)sim.pageErases, sim.minPageErases, sim.maxPageErases);
+    printf("  live entries          %10u / %u\n", sim.liveEntries, sim.pages * NVS_ENTRIES_PER_PAGE);
+    if (sim.pageErases) {
+        double erasesPerDay = (double)sim.maxPageErases / spanDays;
+        printf("  projected lifetime    %10.0f days (hottest page)\n", FLASH_ENDURANCE_CYCLES / erasesPerDay);
+    }
+    printf("  physical entries/puff %10.2f\n", w.puffs ? (double)physical / w.puffs : 0.0);
+    if (sim.failedWrites) {
+        printf("\nPartition full on day %u; replay stopped (figures above cover days 1-%u)\n", fullOnDay, fullOnDay);
+        return 1;
+    }
+    return 0;
+}
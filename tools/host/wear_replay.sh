@@ -0,0 +1,13 @@
+#!/usr/bin/env bash
+# Build and run the flash wear replay on the host.
+# Usage: tools/host/wear_replay.sh [replay args]   (extra compiler flags via CXXFLAGS, e.g. -DNVS_PARTITION_PAGES=6)
+set -euo pipefail
+root="$(cd "$(dirname "$0")/../.." && pwd)"
+out="${OUT:-/tmp/vetra_wear_replay}"
+"${CXX:-g++}" -std=c++17 -O2 -DLOG_LEVEL=0 ${CXXFLAGS:-} \
+    -I"$root/tools/host/include" -I"$root/lib/Logger" -I"$root/lib/StateMachine" -I"$root/lib/Utils" \
+    "$root/tools/host/wear_replay.cpp" "$root/tools/host/nvs_sim.cpp" "$root/tools/host/host_stubs.cpp" \
+    "$root/lib/Utils/PersistenceManager.cpp" "$root/lib/Utils/RecordChannel.cpp" "$root/lib/Utils/Rollups.cpp" "$root/lib/Utils/Counters.cpp" "$root/lib/Utils/Metrics.cpp" \
+    "$root/lib/Utils/BootProfiler.cpp" "$root/lib/Logger/Logger.cpp" "$root/lib/Logger/LogBuffer.cpp" \
+    -o "$out"
+exec "$out" "$@"
@@ -0,0 +1,90 @@
+#!/usr/bin/env python3
+"""Pretty-print latency histograms read from the Vetra metrics characteristic.
+
+Usage:
+    metrics.py <hex>             # value as copied from a BLE client (spaces/dashes ok)
+    metrics.py --file dump.bin   # raw bytes
+    ... | metrics.py             # hex on stdin
+
+Write 0x01 to the same characteristic to reset the histograms.
+
+Layout (little-endian, see lib/Utils/Metrics.h):
+    [format(1)][metricCount(1)][bucketCount(1)]
+    per metric: [count(4)][maxUs(4)][p50Us(4)][p99Us(4)] + bucketCount x [bucket(4)]
+Bucket 0 is [0, 8) us, bucket i is [2^(i+2), 2^(i+3)) us, the last bucket is open-ended.
+"""
+
+import argparse
+import struct
+import sys
+
+METRICS = [
+    "ISR -> handler",
+    "handle_state_falling",
+    "nvs_commit",
+    "loop iteration",
+    "Puffs request -> notify",
+    "Phases request -> notify",
+]
+
+FIRST_BUCKET_LOG2 = 3
+
+
+def parse(data):
+    if len(data) < 3:
+        raise ValueError("payload too short")
+    fmt, metric_count, bucket_count = data[0], data[1], data[2]
+    if fmt != 1:
+        raise ValueError("unsupported format version %d" % fmt)
+    out = []
+    idx = 3
+    for _ in range(metric_count):
+        count, max_us, p50, p99 = struct.unpack_from("<IIII", data, idx)
+        idx += 16
+        buckets = list(struct.unpack_from("<%dI" % bucket_count, data, idx))
+        idx += 4 * bucket_count
+        out.append({"count": count, "max": max_us, "p50": p50, "p99": p99, "buckets": buckets})
+    return out
+
+
+def bucket_label(i, n):
+    if i == 0:
+        return "< %d us" % (1 << FIRST_BUCKET_LOG2)
+    lo = 1 << (i + FIRST_BUCKET_LOG2 - 1)
+    if i == n - 1:
+        return ">= %d us" % lo
+    return "%d-%d us" % (lo, (1 << (i + FIRST_BUCKET_LOG2)) - 1)
+
+
+def metric_name(i):
+    return METRICS[i] if i < len(METRICS) else "metric %d" % i
+
+
+def print_metrics(metrics, show_buckets):
+    print("%-26s %8s %10s %10s %10s" % ("metric", "count", "p50 (us)", "p99 (us)", "max (us)"))
+    for i, m in enumerate(metrics):
+        print("%-26s %8d %10d %10d %10d" % (metric_name(i), m["count"], m["p50"], m["p99"], m["max"]))
+        if show_buckets and m["count"]:
+            n = len(m["buckets"])
+            for b, c in enumerate(m["buckets"]):
+                if c:
+                    print("    %-18s %8d" % (bucket_label(b, n), c))
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    ap.add_argument("hex", nargs="?", help="characteristic value as hex")
+    ap.add_argument("--file", help="read raw bytes from file")
+    ap.add_argument("--buckets", action="store_true", help="print non-empty buckets")
+    args = ap.parse_args()
+    if args.file:
+        with open(args.file, "rb") as f:
+            data = f.read()
+    else:
+        text = args.hex if args.hex else sys.stdin.read()
+        data = bytes.fromhex("".join(c for c in text if c in "0123456789abcdefABCDEF"))
+    print_metrics(parse(data), args.buckets)
+
+
+if __name__ == "__main__":
+    main()
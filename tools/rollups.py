@@ -0,0 +1,77 @@
+#!/usr/bin/env python3
+"""Pretty-print per-phase / per-day rollups read from the Vetra rollups characteristic.
+
+Usage:
+    rollups.py <hex>             # value as copied from a BLE client (spaces/dashes ok)
+    rollups.py --file dump.bin   # raw bytes
+    ... | rollups.py             # hex on stdin
+    rollups.py --query day 0 0   # print the write value for a query (kind, fromKey, maxCount)
+
+Layout (little-endian, see lib/Utils/Rollups.h):
+    query write: [0x10][kind(1)][fromKey(4)][maxCount(1)]   kind 0 = phase, 1 = UTC day
+    read:        [format(1)][count(1)] + count x
+                 [kind(1)][key(4)][count(2)][sumMs(4)][minMs(2)][maxMs(2)][firstSec(4)][lastSec(4)]
+"""
+
+import argparse
+import datetime
+import struct
+import sys
+
+KINDS = ["phase", "day"]
+ENTRY = "<BIHIHHII"
+
+
+def parse(data):
+    if len(data) < 2:
+        raise ValueError("payload too short")
+    fmt, count = data[0], data[1]
+    if fmt != 1:
+        raise ValueError("unsupported format version %d" % fmt)
+    size = struct.calcsize(ENTRY)
+    rollups = []
+    for i in range(count):
+        kind, key, n, total, lo, hi, first, last = struct.unpack_from(ENTRY, data, 2 + i * size)
+        rollups.append({"kind": kind, "key": key, "count": n, "sum": total,
+                        "min": lo, "max": hi, "first": first, "last": last})
+    return rollups
+
+
+def key_label(r):
+    if r["kind"] == 1:
+        return (datetime.datetime(1970, 1, 1) + datetime.timedelta(days=r["key"])).strftime("%Y-%m-%d")
+    return "phase %d" % r["key"]
+
+
+def print_rollups(rollups):
+    if not rollups:
+        print("No rollups.")
+        return
+    print("  %-12s %6s %10s %8s %8s %8s %10s" % ("bucket", "puffs", "total ms", "min", "avg", "max", "span s"))
+    for r in rollups:
+        avg = r["sum"] // r["count"] if r["count"] else 0
+        print("  %-12s %6d %10d %8d %8d %8d %10d" % (
+            key_label(r), r["count"], r["sum"], r["min"], avg, r["max"], r["last"] - r["first"]))
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    ap.add_argument("hex", nargs="?", help="characteristic value as hex")
+    ap.add_argument("--file", help="read raw bytes from file")
+    ap.add_argument("--query", nargs=3, metavar=("KIND", "FROM", "MAX"), help="encode a query write instead")
+    args = ap.parse_args()
+    if args.query:
+        kind, start, count = args.query
+        print(struct.pack("<BBIB", 0x10, KINDS.index(kind), int(start), int(count)).hex())
+        return
+    if args.file:
+        with open(args.file, "rb") as f:
+            data = f.read()
+    else:
+        text = args.hex if args.hex else sys.stdin.read()
+        data = bytes.fromhex("".join(c for c in text if c in "0123456789abcdefABCDEF"))
+    print_rollups(parse(data))
+
+
+if __name__ == "__main__":
+    main()